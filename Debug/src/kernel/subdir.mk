@@ -4,80 +4,128 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../src/kernel/async.c \
+../src/kernel/batch.c \
+../src/kernel/bench.c \
+../src/kernel/bloat.c \
 ../src/kernel/bstworst.c \
+../src/kernel/budget.c \
 ../src/kernel/change.c \
 ../src/kernel/ckpoint.c \
 ../src/kernel/crossovr.c \
+../src/kernel/dag.c \
 ../src/kernel/ephem.c \
 ../src/kernel/eval.c \
 ../src/kernel/event.c \
 ../src/kernel/exch.c \
+../src/kernel/fcache.c \
 ../src/kernel/fitness.c \
 ../src/kernel/genspace.c \
 ../src/kernel/gp.c \
 ../src/kernel/individ.c \
+../src/kernel/jit.c \
+../src/kernel/lexicase.c \
 ../src/kernel/main.c \
 ../src/kernel/memory.c \
 ../src/kernel/mutate.c \
 ../src/kernel/output.c \
 ../src/kernel/params.c \
+../src/kernel/pareto.c \
 ../src/kernel/populate.c \
 ../src/kernel/pretty.c \
+../src/kernel/prof.c \
 ../src/kernel/random.c \
+../src/kernel/record.c \
 ../src/kernel/reproduc.c \
+../src/kernel/sched.c \
 ../src/kernel/select.c \
+../src/kernel/simplify.c \
+../src/kernel/stream.c \
+../src/kernel/tile.c \
 ../src/kernel/tournmnt.c \
 ../src/kernel/tree.c 
 
 OBJS += \
+./src/kernel/async.o \
+./src/kernel/batch.o \
+./src/kernel/bench.o \
+./src/kernel/bloat.o \
 ./src/kernel/bstworst.o \
+./src/kernel/budget.o \
 ./src/kernel/change.o \
 ./src/kernel/ckpoint.o \
 ./src/kernel/crossovr.o \
+./src/kernel/dag.o \
 ./src/kernel/ephem.o \
 ./src/kernel/eval.o \
 ./src/kernel/event.o \
 ./src/kernel/exch.o \
+./src/kernel/fcache.o \
 ./src/kernel/fitness.o \
 ./src/kernel/genspace.o \
 ./src/kernel/gp.o \
 ./src/kernel/individ.o \
+./src/kernel/jit.o \
+./src/kernel/lexicase.o \
 ./src/kernel/main.o \
 ./src/kernel/memory.o \
 ./src/kernel/mutate.o \
 ./src/kernel/output.o \
 ./src/kernel/params.o \
+./src/kernel/pareto.o \
 ./src/kernel/populate.o \
 ./src/kernel/pretty.o \
+./src/kernel/prof.o \
 ./src/kernel/random.o \
+./src/kernel/record.o \
 ./src/kernel/reproduc.o \
+./src/kernel/sched.o \
 ./src/kernel/select.o \
+./src/kernel/simplify.o \
+./src/kernel/stream.o \
+./src/kernel/tile.o \
 ./src/kernel/tournmnt.o \
 ./src/kernel/tree.o 
 
 C_DEPS += \
+./src/kernel/async.d \
+./src/kernel/batch.d \
+./src/kernel/bench.d \
+./src/kernel/bloat.d \
 ./src/kernel/bstworst.d \
+./src/kernel/budget.d \
 ./src/kernel/change.d \
 ./src/kernel/ckpoint.d \
 ./src/kernel/crossovr.d \
+./src/kernel/dag.d \
 ./src/kernel/ephem.d \
 ./src/kernel/eval.d \
 ./src/kernel/event.d \
 ./src/kernel/exch.d \
+./src/kernel/fcache.d \
 ./src/kernel/fitness.d \
 ./src/kernel/genspace.d \
 ./src/kernel/gp.d \
 ./src/kernel/individ.d \
+./src/kernel/jit.d \
+./src/kernel/lexicase.d \
 ./src/kernel/main.d \
 ./src/kernel/memory.d \
 ./src/kernel/mutate.d \
 ./src/kernel/output.d \
 ./src/kernel/params.d \
+./src/kernel/pareto.d \
 ./src/kernel/populate.d \
 ./src/kernel/pretty.d \
+./src/kernel/prof.d \
 ./src/kernel/random.d \
+./src/kernel/record.d \
 ./src/kernel/reproduc.d \
+./src/kernel/sched.d \
 ./src/kernel/select.d \
+./src/kernel/simplify.d \
+./src/kernel/stream.d \
+./src/kernel/tile.d \
 ./src/kernel/tournmnt.d \
 ./src/kernel/tree.d 
 
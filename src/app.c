@@ -31,10 +31,16 @@
 
 #include "kernel/lilgp.h"
 
-globaldata g;
-
  int fitness_cases = -1;
- double *app_fitness_cases[3];
+
+/* the fitness cases, stored by feature:  app_input[i] is the column of
+ input i's values, one per case, and app_target the values wanted.  the
+ columns are contiguous, in one block. */
+int app_inputs = 0;
+static char **app_input_name;
+static DATATYPE *app_data = NULL;
+DATATYPE **app_input = NULL;
+DATATYPE *app_target = NULL;
 static int *app_fitness_importance;
 static double value_cutoff;
 multipop *mpop;
@@ -42,8 +48,8 @@ int startgen;
 event start, end, diff;
 event eval, breed;
 int startfromcheckpoint;
-int population_No = 0;
-int generation_No = 0;
+THREAD_LOCAL int population_No = 0;
+THREAD_LOCAL int generation_No = 0;
 int populationSIZE = 1;
 float current_top = 1000;
 int generationSIZE = 1;
@@ -59,6 +65,8 @@ int best_ending = 1;
 //static int change_counter=0;
 
 void init() {
+	static int previous_generations;
+	int i;
 	populationSIZE = atoi(get_parameter("pop_size"));
 	generationSIZE = atoi(get_parameter("max_generations"));
 	best_starting = atoi(get_parameter("fn_start"));
@@ -71,6 +79,18 @@ void init() {
 		best_ending = 1;
 	}
 	printf("%d : %d", populationSIZE, generationSIZE);
+
+	/* a later run of a batch starts afresh. */
+	if (error_array != NULL) {
+		for (i = 0; i < previous_generations; i++)
+			free(error_array[i]);
+		free(error_array);
+		free(optimal_in_generation);
+		free(optimal_index_in_generation);
+	}
+	previous_generations = generationSIZE;
+	same_optimal_count = 1;
+
 	error_array = malloc(generationSIZE * sizeof(float *));
 	optimal_in_generation = malloc(generationSIZE * sizeof(float));
 	optimal_index_in_generation = malloc(generationSIZE * sizeof(int));
@@ -80,94 +100,293 @@ void init() {
 	//memset(optimal_in_generation,-1,generationSIZE*sizeof(float));
 	optimal_in_generation[0] = 1000;
 	//
-	int i;
 	for (i = 0; i < generationSIZE; i++) {
 		error_array[i] = malloc(populationSIZE * sizeof(float));
 		memset(error_array[i], 0.0f, populationSIZE * sizeof(float));
 
 	}
 }
+
+/* open_datafile()
+ *
+ * open the text data file and read its header line:  the number of
+ * cases, then optionally the names of the inputs (one input, "X", if
+ * none are given).  each line after it is a case:  its inputs, then
+ * the target.
+ */
+static FILE *open_datafile(void) {
+	char *param;
+	char name[256];
+	FILE *in_file;
+	int c, n;
+
+	param = get_parameter("app.datafile");
+	if (param == NULL)
+		param = "500_XSquare.csv";
+	in_file = fopen(param, "r");
+	if (in_file == NULL)
+		error( E_FATAL_ERROR, "can't open data file \"%s\".", param);
+	if (fscanf(in_file, "%d", &fitness_cases) != 1 || fitness_cases < 0)
+		error( E_FATAL_ERROR, "data file \"%s\" has a bad header.", param);
+
+	n = 0;
+	while (1) {
+		do
+			c = getc(in_file);
+		while (c == ' ' || c == '\t' || c == ',' || c == '\r');
+		if (c == '\n' || c == EOF)
+			break;
+		ungetc(c, in_file);
+		if (fscanf(in_file, "%255[^ \t,\r\n]", name) != 1)
+			break;
+		if (app_inputs == 0) {
+			app_input_name = (char **) REALLOC(app_input_name,
+					(n + 1) * sizeof(char *));
+			app_input_name[n] = (char *) MALLOC(strlen(name) + 1);
+			strcpy(app_input_name[n], name);
+		}
+		++n;
+	}
+	if (app_inputs == 0)
+		app_inputs = n;
+	else if (n != app_inputs && !(n == 0 && app_inputs == 1))
+		error( E_FATAL_ERROR, "data file \"%s\" has changed.", param);
+	return in_file;
+}
+
+/* find_inputs()
+ *
+ * how many inputs the cases have, and their names.  this is needed to
+ * build the function set, which happens before the cases are read (and
+ * when restarting, before they are read from the checkpoint).
+ */
+static void find_inputs(void) {
+	char *param;
+	char name[32];
+	int i;
+
+	param = get_parameter("eval.engine");
+	if (param != NULL && strcmp(param, "stream") == 0)
+		app_inputs = stream_file_inputs();
+	else if (get_parameter("app.synthetic_cases") != NULL)
+		app_inputs = 1;
+	else
+		fclose(open_datafile());
+
+	if (app_input_name == NULL) {
+		if (app_inputs == 0)
+			app_inputs = 1;
+		app_input_name = (char **) MALLOC(app_inputs * sizeof(char *));
+		for (i = 0; i < app_inputs; ++i) {
+			if (app_inputs == 1)
+				strcpy(name, "X");
+			else
+				sprintf(name, "X%d", i);
+			app_input_name[i] = (char *) MALLOC(strlen(name) + 1);
+			strcpy(app_input_name[i], name);
+		}
+	}
+}
+
+/* alloc_cases()
+ *
+ * make room for fitness_cases cases, stored by feature.
+ */
+static void alloc_cases(void) {
+	int i;
+
+	app_data = (DATATYPE *) MALLOC(
+			(size_t) (app_inputs + 1) * fitness_cases * sizeof(DATATYPE));
+	app_input = (DATATYPE **) MALLOC(app_inputs * sizeof(DATATYPE *));
+	for (i = 0; i < app_inputs; ++i)
+		app_input[i] = app_data + (size_t) i * fitness_cases;
+	app_target = app_data + (size_t) app_inputs * fitness_cases;
+}
+
 int app_build_function_sets(void) {
 	function_set fset;
 	int tree_map;
 	char *tree_name;
-	function sets[10] = { { f_multiply, NULL, NULL, 2, "*", FUNC_DATA, -1, 0 },
-			{ f_protdivide, NULL, NULL, 2, "/", FUNC_DATA, -1, 0 }, { f_add,
-			NULL, NULL, 2, "+", FUNC_DATA, -1, 0 }, { f_subtract, NULL,
-			NULL, 2, "-", FUNC_DATA, -1, 0 }, { f_sin, NULL, NULL, 1, "sin",
-			FUNC_DATA, -1, 0 }, { f_cos, NULL, NULL, 1, "cos",
-			FUNC_DATA, -1, 0 }, { f_exp, NULL, NULL, 1, "exp",
-			FUNC_DATA, -1, 0 }, { f_rlog, NULL, NULL, 1, "rlog",
-			FUNC_DATA, -1, 0 }, { f_indepvar, NULL, NULL, 0, "X",
-			TERM_NORM, -1, 0 }, { NULL, f_erc_gen, f_erc_print, 0, "R",
-			TERM_ERC, -1, 0 } };
+	function *sets;
+	int i, n, ret;
+	/* the last two fields tell the jit which functions are primitives
+	 it can emit inline, and which input each input terminal is. */
+	function funcs[8] = { { f_multiply, NULL, NULL, 2, "*", FUNC_DATA, -1, 0,
+			PRIM_MUL, 0 }, { f_protdivide, NULL, NULL, 2, "/", FUNC_DATA,
+			-1, 0, PROTDIVIDE_PRIM, 0 }, { f_add, NULL, NULL, 2, "+",
+			FUNC_DATA, -1, 0, PRIM_ADD, 0 }, { f_subtract, NULL, NULL, 2,
+			"-", FUNC_DATA, -1, 0, PRIM_SUB, 0 }, { f_sin, NULL, NULL, 1,
+			"sin", FUNC_DATA, -1, 0, PRIM_SIN, 0 }, { f_cos, NULL, NULL, 1,
+			"cos", FUNC_DATA, -1, 0, PRIM_COS, 0 }, { f_exp, NULL, NULL, 1,
+			"exp", FUNC_DATA, -1, 0, PRIM_EXP, 0 }, { f_rlog, NULL, NULL, 1,
+			"rlog", FUNC_DATA, -1, 0, PRIM_RLOG, 0 } };
+	function erc = { NULL, f_erc_gen, f_erc_print, 0, "R", TERM_ERC, -1, 0,
+			PRIM_NONE, 0 };
+
+	/* one terminal per input.  the evaluator reads them from the
+	 current case's inputs, so they have no code. */
+	if (app_inputs == 0)
+		find_inputs();
+	sets = (function *) MALLOC((8 + app_inputs + 1) * sizeof(function));
+	memcpy(sets, funcs, sizeof(funcs));
+	n = 8;
+	for (i = 0; i < app_inputs; ++i, ++n) {
+		memset(sets + n, 0, sizeof(function));
+		sets[n].arity = 0;
+		sets[n].string = app_input_name[i];
+		sets[n].type = TERM_NORM;
+		sets[n].evaltree = -1;
+		sets[n].prim = PRIM_INPUT;
+		sets[n].input = i;
+	}
 
 	binary_parameter("app.use_ercs", 1);
 	if (atoi(get_parameter("app.use_ercs")))
-		fset.size = 10;
-	else
-		fset.size = 9;
+		sets[n++] = erc;
+	fset.size = n;
 	fset.cset = sets;
 
 	tree_map = 0;
 	tree_name = "TREE";
 
-	return function_sets_init(&fset, 1, &tree_map, &tree_name, 1);
+	ret = function_sets_init(&fset, 1, &tree_map, &tree_name, 1);
+	FREE(sets);
+	return ret;
 }
 
 void app_eval_fitness(individual *ind) {
 
-	int i;
-	double v, dv;
-	double disp;
-	float error = 0.0f;
+	int i, j;
+	double v;
+	DATATYPE row[app_inputs];
+	jit_function fn = NULL;
+	lnode *prog;
 	set_current_individual(ind);
-	ind->r_fitness = 0.0;
-	ind->hits = 0;
+	set_input_row(row);
+	app_begin_cases(ind);
+
+	prog = simplify_tree(ind->tr[0].data, 0);
+	if (jit_wanted(fitness_cases))
+		fn = jit_compile(prog, 0);
 
 	for (i = 0; i < fitness_cases; ++i) {
 		//	if (app_fitness_importance[i] <= current_max_importance&&app_fitness_importance[i] !=0) {
-		g.x = app_fitness_cases[0][i];
-		v = evaluate_tree(ind->tr[0].data, 0);
-		dv = app_fitness_cases[1][i];
-		disp = fabs(dv - v);
-		error += disp;
-		if (disp < value_cutoff) {
-			ind->r_fitness += disp;
-			if (disp <= 0.01)
-				++ind->hits;
-		} else {
-			ind->r_fitness += value_cutoff;
-		}
+		for (j = 0; j < app_inputs; ++j)
+			row[j] = app_input[j][i];
+		if (fn)
+			v = fn(row);
+		else
+			v = evaluate_tree(prog, 0);
+		app_score_case(ind, i, v);
 		//}
 	}
-	error = error / fitness_cases;
-	//error = error/
-	//  error_array[(generation_No*50)+population] = error;
+	app_end_cases(ind);
+}
+
+/* the scoring half of app_eval_fitness(), also called directly by
+ evaluation engines that compute the tree's value for many cases at
+ once.  the mean error is accumulated in error_array as it goes. */
+
+void app_begin_cases(individual *ind) {
+	ind->r_fitness = 0.0;
+	ind->hits = 0;
+	error_array[generation_No][population_No] = 0.0f;
+}
+
+void app_score_case(individual *ind, int c, DATATYPE v) {
+	double dv, disp;
+
+	dv = cases.target[c];
+	disp = fabs(dv - v);
+	error_array[generation_No][population_No] += disp;
+	if (disp < value_cutoff) {
+		ind->r_fitness += disp;
+		case_error(ind, c, disp);
+		if (disp <= 0.01)
+			++ind->hits;
+	} else {
+		ind->r_fitness += value_cutoff;
+		case_error(ind, c, value_cutoff);
+	}
+}
+
+/* record an individual's mean error, and the generation's best. */
+static void note_error(float error) {
 	error_array[generation_No][population_No] = error;
 
-	if (optimal_in_generation[generation_No] > error) {
+	/* evaluation threads share the per-generation optimum.  ties go to
+	 the lowest index, as they would evaluating in order. */
+	async_lock();
+	if (optimal_in_generation[generation_No] > error
+			|| (optimal_in_generation[generation_No] == error
+					&& optimal_index_in_generation[generation_No]
+							> population_No)) {
 		optimal_in_generation[generation_No] = error;
 		optimal_index_in_generation[generation_No] = population_No;
 	}
+	async_unlock();
+}
+
+void app_end_cases(individual *ind) {
+	float error;
+
+	error = error_array[generation_No][population_No] / fitness_cases;
+	//error = error/
+	//  error_array[(generation_No*50)+population] = error;
+	note_error(error);
 	ind->s_fitness = ind->r_fitness;
 	ind->a_fitness = 1 / (1 + ind->s_fitness);
 	ind->evald = EVAL_CACHE_VALID;
 
 }
 
+/* the fitness cache keeps the mean error with each fitness. */
+
+double app_cache_extra(individual *ind) {
+	return error_array[generation_No][population_No];
+}
+
+void app_cache_hit(individual *ind, double extra) {
+	note_error((float) extra);
+}
+
 int app_end_of_evaluation(int gen, multipop *mpop, int newbest,
 		popstats *gen_stats, popstats *run_stats) {
-	int i;
+	int i, j;
 	double v;
+	DATATYPE row[app_inputs];
+	jit_function fn = NULL;
+	lnode *prog;
 
 	if (newbest) {
 		output_stream_open( OUT_USER);
 
-		for (i = (best_starting * 100); i <= (100 * best_ending); ++i) {
-			g.x = (double) i * .01;
-			v = evaluate_tree(run_stats[0].best[0]->ind->tr[0].data, 0);
-			oprintf( OUT_USER, 50, "%lf %lf\n", g.x, v);
+		prog = simplify_tree(run_stats[0].best[0]->ind->tr[0].data, 0);
+		set_input_row(row);
+		if (app_inputs == 1) {
+			/* one input:  sample the best individual over a range of X. */
+			if (jit_wanted(100 * (best_ending - best_starting) + 1))
+				fn = jit_compile(prog, 0);
+
+			for (i = (best_starting * 100); i <= (100 * best_ending); ++i) {
+				row[0] = (double) i * .01;
+				if (fn)
+					v = fn(row);
+				else
+					v = evaluate_tree(prog, 0);
+				oprintf( OUT_USER, 50, "%lf %lf\n", row[0], v);
+			}
+		} else if (app_input != NULL) {
+			/* otherwise write its value on each case, after the case's
+			 inputs and target. */
+			for (i = 0; i < fitness_cases; ++i) {
+				for (j = 0; j < app_inputs; ++j) {
+					row[j] = app_input[j][i];
+					oprintf( OUT_USER, 50, "%lf ", row[j]);
+				}
+				v = evaluate_tree(prog, 0);
+				oprintf( OUT_USER, 50, "%lf %lf\n", app_target[i], v);
+			}
 		}
 
 		output_stream_close( OUT_USER);
@@ -212,11 +431,17 @@ int checkImportance(double x) {
 }
 
 int app_initialize(int startfromcheckpoint) {
-	int i;
+	int i, j;
 	double x, y;
 	char *param;
 	init();
-	if (!startfromcheckpoint) {
+	if (eval_engine == EVAL_ENGINE_STREAM) {
+		/* the streaming engine reads the cases from its dataset a
+		 chunk at a time. */
+		fitness_cases = stream_rows();
+	} else if (app_input != NULL && !startfromcheckpoint) {
+		/* a later run of a batch:  the cases are already loaded. */
+	} else if (!startfromcheckpoint) {
 		oprintf( OUT_PRG, 50, "not starting from checkpoint file.\n");
 
 		param = get_parameter("app.fitness_cases");
@@ -228,21 +453,40 @@ int app_initialize(int startfromcheckpoint) {
 				error( E_FATAL_ERROR,
 						"invalid value for \"app.fitness_cases\".");
 		}
-		FILE *in_file = fopen("500_XSquare.csv", "r");
-		fscanf(in_file, "%d", &fitness_cases);
-		app_fitness_cases[0] = (double *) MALLOC(
-				fitness_cases * sizeof(double));
-		app_fitness_cases[1] = (double *) MALLOC(
-				fitness_cases * sizeof(double));
-		app_fitness_importance = (int *) MALLOC(fitness_cases * sizeof(int));
-		//Asim Code
-		float x, y;
-		for (i = 0; i < fitness_cases; ++i) {
-			fscanf(in_file, "%f", &x);
-			fscanf(in_file, "%f", &y);
-			app_fitness_cases[0][i] = x;
-			app_fitness_cases[1][i] = y;
-			//app_fitness_importance[i] = checkImportance(x);
+		/* app.synthetic_cases generates a dataset of the given size in
+		 place of the data file, for benchmarking. */
+		param = get_parameter("app.synthetic_cases");
+		if (param != NULL) {
+			fitness_cases = atoi(param);
+			if (fitness_cases <= 0)
+				error( E_FATAL_ERROR,
+						"invalid value for \"app.synthetic_cases\".");
+			alloc_cases();
+			app_fitness_importance = (int *) MALLOC(
+					fitness_cases * sizeof(int));
+			for (i = 0; i < fitness_cases; ++i) {
+				x = (random_double() * 2.0) - 1.0;
+				y = x * x * x * x + x * x * x + x * x + x;
+				app_input[0][i] = x;
+				app_target[i] = y;
+			}
+		} else {
+			FILE *in_file = open_datafile();
+			alloc_cases();
+			app_fitness_importance = (int *) MALLOC(
+					fitness_cases * sizeof(int));
+			//Asim Code
+			float fx;
+			for (i = 0; i < fitness_cases; ++i) {
+				for (j = 0; j <= app_inputs; ++j) {
+					if (fscanf(in_file, " %f%*[ \t,]", &fx) < 1)
+						error( E_FATAL_ERROR,
+								"data file ends at case %d.", i);
+					app_data[(size_t) j * fitness_cases + i] = fx;
+				}
+				//app_fitness_importance[i] = checkImportance(x);
+			}
+			fclose(in_file);
 		}
 		/*oprintf( OUT_PRG, 50, "%d fitness cases:\n", fitness_cases);
 		 for (i = 0; i < fitness_cases; ++i) {
@@ -251,8 +495,8 @@ int app_initialize(int startfromcheckpoint) {
 		 // change this line to modify the goal function.
 		 y = x * x * x * x + x * x * x + x * x + x;
 
-		 app_fitness_cases[0][i] = x;
-		 app_fitness_cases[1][i] = y;
+		 app_input[0][i] = x;
+		 app_target[i] = y;
 
 		 // oprintf( OUT_PRG, 50, "    x = %12.5lf, y = %12.5lf\n", x, y);
 		 }*/
@@ -266,6 +510,8 @@ int app_initialize(int startfromcheckpoint) {
 	else
 		value_cutoff = strtod(param, NULL);
 
+	register_caseset(fitness_cases, app_inputs, app_input, app_target);
+
 	return 0;
 }
 
@@ -274,9 +520,8 @@ void app_uninitialize(void) {
 	free(optimal_index_in_generation);
 	free(optimal_in_generation);
 	free(app_fitness_importance);
-	free(app_fitness_cases);
-	//free(app_fitness_cases[1]);
-	//free(app_fitness_cases[2]);
+	FREE(app_data);
+	FREE(app_input);
 	//int i = 0;
 	//for (; i < generationSIZE; i++) {
 	free(error_array);
@@ -284,32 +529,45 @@ void app_uninitialize(void) {
 
 }
 
+/* the cases are saved with the population, one line each:  the
+ inputs and then the target in hex, then readably.  streamed cases stay
+ in their dataset. */
+
 void app_write_checkpoint(FILE *f) {
-	int i;
-	fprintf(f, "fitness-cases: %d\n", fitness_cases);
-	for (i = 0; i < fitness_cases; ++i) {
-		write_hex_block(app_fitness_cases[0] + i, sizeof(double), f);
-		fputc(' ', f);
-		write_hex_block(app_fitness_cases[1] + i, sizeof(double), f);
-		fprintf(f, " %.5lf %.5lf\n", app_fitness_cases[0][i],
-				app_fitness_cases[1][i]);
+	int i, j, n;
+
+	n = app_input ? fitness_cases : 0;
+	fprintf(f, "fitness-cases: %d inputs: %d\n", n, app_inputs);
+	for (i = 0; i < n; ++i) {
+		for (j = 0; j <= app_inputs; ++j) {
+			write_hex_block(app_data + (size_t) j * fitness_cases + i,
+					sizeof(double), f);
+			fputc(' ', f);
+		}
+		for (j = 0; j <= app_inputs; ++j)
+			fprintf(f, " %.5lf", app_data[(size_t) j * fitness_cases + i]);
+		fputc('\n', f);
 	}
 }
 
 void app_read_checkpoint(FILE *f) {
-	int i;
+	int i, j, inputs;
 
-	fscanf(f, "%*s %d\n", &fitness_cases);
-
-	app_fitness_cases[0] = (double *) MALLOC(fitness_cases * sizeof(double));
-	app_fitness_cases[1] = (double *) MALLOC(fitness_cases * sizeof(double));
+	inputs = 1;
+	fscanf(f, "%*s %d inputs: %d\n", &fitness_cases, &inputs);
+	if (inputs != app_inputs)
+		error( E_FATAL_ERROR, "checkpoint has %d inputs, not %d.", inputs,
+				app_inputs);
+	if (fitness_cases == 0)
+		return;
 
+	alloc_cases();
 	for (i = 0; i < fitness_cases; ++i) {
-		read_hex_block(app_fitness_cases[0] + i, sizeof(double), f);
-		fgetc(f);
-		read_hex_block(app_fitness_cases[1] + i, sizeof(double), f);
-		fscanf(f, " %*f %*f\n");
-		fprintf( stderr, "%.5lf %.5lf\n", app_fitness_cases[0][i],
-				app_fitness_cases[1][i]);
+		for (j = 0; j <= app_inputs; ++j) {
+			read_hex_block(app_data + (size_t) j * fitness_cases + i,
+					sizeof(double), f);
+			fgetc(f);
+		}
+		fscanf(f, "%*[^\n]\n");
 	}
 }
@@ -32,16 +32,13 @@
 #include "kernel/types.h"
 void app_eval_fitness(individual *ind);
 /*void app_eval_fitness ( individual *ind,int generation_No );*/
-typedef struct
-{
-     double x;
-} globaldata;
 int fitness_cases ;
 int termination_override;
 
-double *app_fitness_cases[3];
+extern int app_inputs;
+extern DATATYPE **app_input;
+extern DATATYPE *app_target;
 extern float current_top ;
-extern globaldata g;
 extern float **error_array ;
 extern multipop *mpop;
 extern int startgen;
@@ -55,7 +52,7 @@ extern int populationSIZE;
 extern int generationSIZE;
 extern int best_starting;
 extern int best_ending;
-extern int population_No ;
-extern int generation_No ;
+extern THREAD_LOCAL int population_No ;
+extern THREAD_LOCAL int generation_No ;
 
 #endif
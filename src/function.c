@@ -94,11 +94,6 @@ DATATYPE f_rlog ( int tree, farg *args )
           return log ( fabs ( args[0].d ) );
 }
 
-DATATYPE f_indepvar ( int tree, farg *args )
-{
-     return g.x;
-}
-
 void f_erc_gen ( DATATYPE *r )
 {
      *r = (random_double()*2.0) - 1.0;
@@ -30,6 +30,14 @@
 
 #include "kernel/lilgp.h"
 
+#ifdef TOLERANCE_ZERO
+/* f_protdivide() doesn't divide at all in this case, so it can't be
+   compiled as the jit's protected division. */
+#define PROTDIVIDE_PRIM  PRIM_NONE
+#else
+#define PROTDIVIDE_PRIM  PRIM_PDIV
+#endif
+
 DATATYPE f_multiply ( int tree, farg *args );
 DATATYPE f_protdivide ( int tree, farg *args );
 DATATYPE f_add ( int tree, farg *args );
@@ -38,7 +46,6 @@ DATATYPE f_sin ( int tree, farg *args );
 DATATYPE f_cos ( int tree, farg *args );
 DATATYPE f_exp ( int tree, farg *args );
 DATATYPE f_rlog ( int tree, farg *args );
-DATATYPE f_indepvar ( int tree, farg *args );
 
 void f_erc_gen ( DATATYPE * );
 char *f_erc_print ( DATATYPE );
@@ -0,0 +1,497 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+#include "lilgp.h"
+
+#ifdef THREADS_AVAILABLE
+#include <pthread.h>
+#endif
+
+/* asynchronous evaluation.
+ *
+ * in a steady-state run with "async.workers" set, offspring are not
+ * evaluated by the breeding loop.  they are queued for a pool of
+ * evaluation threads, and the breeding loop carries on making more;
+ * each one moves into the population (over the slot reserved for it
+ * when it was made) whenever it is done.  nothing waits for the slowest
+ * individual of a generation -- offspring still in flight at the end of
+ * a generation simply move in during the next one.
+ *
+ * only the main thread breeds, replaces individuals, collects ERCs and
+ * writes statistics.  the evaluation threads see the trees they are
+ * given and their own simplify/jit buffers; the ERC pool and the
+ * application's shared per-generation results are guarded by
+ * async_lock().  the main thread holds a reference to the ERCs of every
+ * queued offspring, so a collection can't take them.
+ */
+
+/* nonzero while the evaluation threads exist. */
+static int running = 0;
+
+/* how many threads besides the main one may be evaluating, here or in
+   the evaluation scheduler. */
+int eval_threads = 0;
+
+static int workers = 0;
+static async_job *jobs;
+static int job_count;
+
+/* unused jobs (touched only by the main thread). */
+static int *free_jobs;
+static int free_count;
+
+/* slots with an offspring on the way, for each subpopulation. */
+static char **busy;
+static int busy_count;
+
+/* each thread's share of the profile, and what they have handed over
+   (under queue_mutex) for async_collect() to add in. */
+static profshare **shares;
+static profshare *pending;
+static int share_count;
+
+/* statistics. */
+static int used_workers = 0;
+static long async_evaluated = 0;
+static long async_discarded = 0;
+static long async_waits = 0;
+static long async_collisions = 0;
+
+#ifdef THREADS_AVAILABLE
+
+static pthread_t *threads;
+
+static pthread_mutex_t kernel_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* the queue of offspring to evaluate (oldest first), and the stack of
+   finished ones, linked through the jobs' next fields. */
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+static int todo_head, todo_tail;
+static int done_head;
+static int quit;
+
+#endif
+
+/* async_lock()
+ *
+ * guards state shared with the evaluation threads.  does nothing when
+ * there are none.
+ */
+
+void async_lock ( void )
+{
+#ifdef THREADS_AVAILABLE
+     if ( eval_threads )
+          pthread_mutex_lock ( &kernel_mutex );
+#endif
+}
+
+/* async_unlock()
+ *
+ * the other half of async_lock().
+ */
+
+void async_unlock ( void )
+{
+#ifdef THREADS_AVAILABLE
+     if ( eval_threads )
+          pthread_mutex_unlock ( &kernel_mutex );
+#endif
+}
+
+/* async_running()
+ *
+ * nonzero if offspring are being evaluated by threads.
+ */
+
+int async_running ( void )
+{
+     return running;
+}
+
+/* async_room()
+ *
+ * the number of offspring that can be queued without waiting.
+ */
+
+int async_room ( void )
+{
+     return free_count;
+}
+
+/* async_free_slot()
+ *
+ * returns the slot chosen for replacement if no offspring is on the way
+ * to it, or else the next one that is free.
+ */
+
+int async_free_slot ( int sub, int slot, int size )
+{
+     int i;
+
+     if ( !busy[sub][slot] )
+          return slot;
+
+     ++async_collisions;
+     for ( i = 1; i < size; ++i )
+          if ( !busy[sub][(slot+i)%size] )
+               return (slot+i)%size;
+
+     error ( E_FATAL_ERROR, "no free slot for an offspring." );
+     return -1;
+}
+
+#ifdef THREADS_AVAILABLE
+
+/* worker()
+ *
+ * the evaluation threads:  take an offspring off the queue, evaluate it
+ * under the slot and generation it was made for, and put it on the
+ * finished stack.
+ */
+
+static void *worker ( void *arg )
+{
+     profshare *mine = shares[(int)(intptr_t)arg];
+     async_job *job;
+     uint64_t s;
+
+     prof_share_use ( mine );
+     pthread_mutex_lock ( &queue_mutex );
+     while ( 1 )
+     {
+          while ( todo_head == -1 && !quit )
+               pthread_cond_wait ( &work_cond, &queue_mutex );
+          if ( quit )
+               break;
+
+          job = jobs+todo_head;
+          todo_head = job->next;
+          pthread_mutex_unlock ( &queue_mutex );
+
+          population_No = job->slot;
+          generation_No = job->gen;
+          if ( prof_enabled )
+          {
+               s = prof_now();
+               app_eval_fitness ( &job->ind );
+               prof_eval_sample ( prof_now() - s );
+          }
+          else
+               app_eval_fitness ( &job->ind );
+          fitcache_store ( &job->ind );
+
+          pthread_mutex_lock ( &queue_mutex );
+          if ( prof_enabled )
+               prof_share_add ( pending, mine );
+          job->next = done_head;
+          done_head = job-jobs;
+          pthread_cond_signal ( &done_cond );
+     }
+     pthread_mutex_unlock ( &queue_mutex );
+
+     free_simplify_thread();
+     free_jit();
+     return NULL;
+}
+
+#endif
+
+/* async_submit()
+ *
+ * queue an offspring to replace the given slot.  its trees (and the ERC
+ * references they hold) go with it.
+ */
+
+void async_submit ( individual *k, int sub, int slot )
+{
+#ifdef THREADS_AVAILABLE
+     async_job *job = jobs+free_jobs[--free_count];
+     tree *tr;
+     void *errors;
+     int j;
+
+     for ( j = 0; j < tree_count; ++j )
+     {
+          job->ind.tr[j] = k->tr[j];
+          k->tr[j].data = NULL;
+     }
+     tr = job->ind.tr;
+     errors = job->ind.errors;
+     job->ind = *k;
+     job->ind.tr = tr;
+     job->ind.errors = errors;
+     job->sub = sub;
+     job->slot = slot;
+     job->gen = generation_No;
+     busy[sub][slot] = 1;
+
+     pthread_mutex_lock ( &queue_mutex );
+     job->next = -1;
+     if ( todo_head == -1 )
+          todo_head = job-jobs;
+     else
+          jobs[todo_tail].next = job-jobs;
+     todo_tail = job-jobs;
+     pthread_cond_signal ( &work_cond );
+     pthread_mutex_unlock ( &queue_mutex );
+#endif
+}
+
+/* async_collect()
+ *
+ * returns a finished offspring, or NULL if there are none.  if wait is
+ * set, waits for one instead.  hand the job back with async_release()
+ * once its trees have been moved out.
+ */
+
+async_job *async_collect ( int wait )
+{
+     async_job *job = NULL;
+#ifdef THREADS_AVAILABLE
+     pthread_mutex_lock ( &queue_mutex );
+     if ( wait && done_head == -1 )
+     {
+          ++async_waits;
+          while ( done_head == -1 )
+               pthread_cond_wait ( &done_cond, &queue_mutex );
+     }
+     if ( done_head != -1 )
+     {
+          job = jobs+done_head;
+          done_head = job->next;
+     }
+     if ( prof_enabled )
+          prof_share_merge ( pending );
+     pthread_mutex_unlock ( &queue_mutex );
+#endif
+     return job;
+}
+
+/* async_release()
+ *
+ * return a job to the free list, and free its slot.
+ */
+
+void async_release ( async_job *job )
+{
+     busy[job->sub][job->slot] = 0;
+     free_jobs[free_count++] = job-jobs;
+     ++async_evaluated;
+}
+
+/* async_begin()
+ *
+ * start the evaluation threads, if "async.workers" asks for them.  each
+ * may have two offspring queued, but never as many as a subpopulation
+ * has individuals.
+ */
+
+void async_begin ( multipop *mpop )
+{
+     char *param = get_parameter ( "async.workers" );
+     int i, j;
+     int n;
+
+     workers = param ? atoi ( param ) : 0;
+     if ( workers <= 0 )
+     {
+          workers = 0;
+          return;
+     }
+     
+#ifdef THREADS_AVAILABLE
+     /* ADF evaluation passes arguments through tree_map, which the
+	threads would share. */
+     for ( i = 0; i < fset_count; ++i )
+          for ( j = 0; j < fset[i].size; ++j )
+               if ( fset[i].cset[j].type == EVAL_DATA ||
+                    fset[i].cset[j].type == EVAL_EXPR ||
+                    fset[i].cset[j].type == EVAL_TERM )
+               {
+                    error ( E_WARNING, "async.workers can't be used with evaluation tokens; evaluating in the main thread." );
+                    workers = 0;
+                    return;
+               }
+
+     job_count = 2 * workers;
+     for ( i = 0; i < mpop->size; ++i )
+          if ( job_count >= mpop->pop[i]->size )
+               job_count = mpop->pop[i]->size - 1;
+     if ( job_count < 2 )
+     {
+          error ( E_WARNING, "subpopulations too small for async.workers; evaluating in the main thread." );
+          workers = 0;
+          return;
+     }
+
+     jobs = (async_job *)MALLOC ( job_count * sizeof ( async_job ) );
+     free_jobs = (int *)MALLOC ( job_count * sizeof ( int ) );
+     for ( i = 0; i < job_count; ++i )
+     {
+          jobs[i].ind.tr = (tree *)MALLOC ( tree_count * sizeof ( tree ) );
+          jobs[i].ind.errors = alloc_case_errors();
+          for ( j = 0; j < tree_count; ++j )
+               jobs[i].ind.tr[j].data = NULL;
+          free_jobs[i] = job_count-1-i;
+     }
+     free_count = job_count;
+
+     busy_count = mpop->size;
+     busy = (char **)MALLOC ( busy_count * sizeof ( char * ) );
+     for ( i = 0; i < busy_count; ++i )
+     {
+          busy[i] = (char *)MALLOC ( mpop->pop[i]->size );
+          memset ( busy[i], 0, mpop->pop[i]->size );
+     }
+
+     share_count = workers;
+     shares = (profshare **)MALLOC ( share_count * sizeof ( profshare * ) );
+     for ( i = 0; i < share_count; ++i )
+          shares[i] = prof_share_new();
+     pending = prof_share_new();
+
+     todo_head = todo_tail = done_head = -1;
+     quit = 0;
+
+     /* the folded-constant function must be registered before any
+	thread simplifies. */
+     simplify_register();
+     
+     running = 1;
+     eval_threads += workers;
+     threads = (pthread_t *)MALLOC ( workers * sizeof ( pthread_t ) );
+     for ( n = 0; n < workers; ++n )
+          if ( pthread_create ( threads+n, NULL, worker, (void *)(intptr_t)n ) )
+               break;
+     eval_threads -= workers - n;
+     if ( n == 0 )
+     {
+          error ( E_WARNING, "can't start evaluation threads; evaluating in the main thread." );
+          workers = 0;
+          async_end();
+          return;
+     }
+     workers = n;
+     if ( workers > used_workers )
+          used_workers = workers;
+     oprintf ( OUT_SYS, 30, "    %d evaluation threads.\n", workers );
+#else
+     error ( E_WARNING, "no threads on this platform; evaluating in the main thread." );
+     workers = 0;
+#endif
+}
+
+/* discard()
+ *
+ * drop the offspring in a list of jobs.
+ */
+
+static void discard ( int i )
+{
+     int j;
+
+     while ( i != -1 )
+     {
+          for ( j = 0; j < tree_count; ++j )
+          {
+               reference_ephem_constants ( jobs[i].ind.tr[j].data, -1 );
+               free_tree ( jobs[i].ind.tr+j );
+          }
+          ++async_discarded;
+          i = jobs[i].next;
+     }
+}
+
+/* async_end()
+ *
+ * stop the evaluation threads.  offspring still queued or not yet moved
+ * in are thrown away.
+ */
+
+void async_end ( void )
+{
+#ifdef THREADS_AVAILABLE
+     int i;
+     
+     if ( !running )
+          return;
+
+     pthread_mutex_lock ( &queue_mutex );
+     quit = 1;
+     pthread_cond_broadcast ( &work_cond );
+     pthread_mutex_unlock ( &queue_mutex );
+     for ( i = 0; i < workers; ++i )
+          pthread_join ( threads[i], NULL );
+     FREE ( threads );
+     eval_threads -= workers;
+     running = 0;
+
+     /* nothing else touches the lists now. */
+     discard ( todo_head );
+     discard ( done_head );
+
+     for ( i = 0; i < job_count; ++i )
+     {
+          FREE ( jobs[i].ind.tr );
+          FREE ( jobs[i].ind.errors );
+     }
+     FREE ( jobs );
+     FREE ( free_jobs );
+     for ( i = 0; i < share_count; ++i )
+          FREE ( shares[i] );
+     FREE ( shares );
+     FREE ( pending );
+     share_count = 0;
+     for ( i = 0; i < busy_count; ++i )
+          FREE ( busy[i] );
+     FREE ( busy );
+     jobs = NULL;
+     busy = NULL;
+     job_count = free_count = busy_count = 0;
+     workers = 0;
+#endif
+}
+
+/* output_async_stats()
+ *
+ * report the asynchronous evaluation totals at the end of the run.
+ */
+
+void output_async_stats ( void )
+{
+     if ( !used_workers )
+          return;
+     oprintf ( OUT_SYS, 30, "\n------- async evaluation -------\n" );
+     oprintf ( OUT_SYS, 30, "             threads:      %d\n", used_workers );
+     oprintf ( OUT_SYS, 30, "           evaluated:      %ld\n", async_evaluated );
+     oprintf ( OUT_SYS, 30, "           discarded:      %ld\n", async_discarded );
+     oprintf ( OUT_SYS, 30, "         queue waits:      %ld\n", async_waits );
+     oprintf ( OUT_SYS, 30, "     slot collisions:      %ld\n", async_collisions );
+}
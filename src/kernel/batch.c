@@ -0,0 +1,269 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+#include "lilgp.h"
+
+/* batches of runs.
+ *
+ * with "batch.runs" set to n, the kernel does n independent runs one
+ * after another in this process, instead of one.  the fitness cases
+ * are read and the function sets built once, and the evaluation
+ * threads ("eval.threads") are started once and shared by every run,
+ * so a seed sweep pays for none of these per run and never has two
+ * runs fighting over the cores.
+ *
+ * run i (counting from 1) is seeded with random_seed+i-1 and writes
+ * its output under the basename "<output.basename>.<i>"; the .sys file
+ * (and the profiler's trace) stays at output.basename and gets a
+ * summary line per run; nothing else is written under output.basename
+ * itself.  any parameter can be changed for one run by giving it as
+ * "batch.<i>.<name>", eg. "batch.3.pop_size = 2000" or
+ * "batch.2.random_seed = 77".  parameters read when the cases are
+ * loaded or the function sets built (app.*, eval.engine) are the same
+ * for every run.
+ *
+ * the runs' checkpoint files are named "<basename>.<i>." followed by
+ * checkpoint.filename, and each restarts as a single run.
+ */
+
+int batch_run = 0;
+
+/* the parameters changed for the current run, and their values
+   before it. */
+static char **saved_name = NULL;
+static char **saved_value = NULL;
+static int saved_count = 0;
+static int saved_size = 0;
+
+/* batch_runs()
+ *
+ * the number of runs to do, or 0 for an ordinary run.
+ */
+
+int batch_runs ( void )
+{
+     char *param = get_parameter ( "batch.runs" );
+
+     return param ? atoi ( param ) : 0;
+}
+
+/* set_for_run()
+ *
+ * sets a parameter for the current run, remembering its old value.
+ */
+
+static void set_for_run ( char *name, char *value )
+{
+     char *old = get_parameter ( name );
+
+     if ( saved_count == saved_size )
+     {
+          saved_size += 8;
+          saved_name = (char **)REALLOC ( saved_name, saved_size * sizeof ( char * ) );
+          saved_value = (char **)REALLOC ( saved_value, saved_size * sizeof ( char * ) );
+     }
+     saved_name[saved_count] = (char *)MALLOC ( strlen ( name ) + 1 );
+     strcpy ( saved_name[saved_count], name );
+     saved_value[saved_count] = NULL;
+     if ( old )
+     {
+          saved_value[saved_count] = (char *)MALLOC ( strlen ( old ) + 1 );
+          strcpy ( saved_value[saved_count], old );
+     }
+     ++saved_count;
+
+     add_parameter ( name, value, PARAM_COPY_NAME|PARAM_COPY_VALUE );
+}
+
+/* restore_parameters()
+ *
+ * puts back the parameters changed for a run, latest first.
+ */
+
+static void restore_parameters ( void )
+{
+     while ( saved_count > 0 )
+     {
+          --saved_count;
+          if ( saved_value[saved_count] )
+               add_parameter ( saved_name[saved_count], saved_value[saved_count],
+                              PARAM_COPY_NAME|PARAM_COPY_VALUE );
+          else
+               delete_parameter ( saved_name[saved_count] );
+          FREE ( saved_name[saved_count] );
+          FREE ( saved_value[saved_count] );
+     }
+}
+
+/* overridden()
+ *
+ * is name one of the n parameters in names?
+ */
+
+static int overridden ( char **names, int n, char *name )
+{
+     int i;
+
+     for ( i = 0; i < n; ++i )
+          if ( strcmp ( names[i], name ) == 0 )
+               return 1;
+     return 0;
+}
+
+/* set_run_parameters()
+ *
+ * sets the parameters for run number run:  its "batch.<run>.*"
+ * overrides, then its seed, basename and checkpoint names unless those
+ * were overridden.
+ */
+
+static void set_run_parameters ( int run, char *basename, long seed,
+                                char *checkname )
+{
+     extern parameter *param;
+     extern int param_size;
+     char prefix[40];
+     char **names, **values;
+     char *buffer;
+     int i, n, len;
+
+     /* collect them first:  setting parameters can move the database. */
+     sprintf ( prefix, "batch.%d.", run );
+     len = strlen ( prefix );
+     names = (char **)MALLOC ( ( param_size + 1 ) * sizeof ( char * ) );
+     values = (char **)MALLOC ( ( param_size + 1 ) * sizeof ( char * ) );
+     for ( i = n = 0; i < param_size; ++i )
+          if ( strncmp ( param[i].n, prefix, len ) == 0 && param[i].n[len] )
+          {
+               names[n] = param[i].n + len;
+               values[n++] = param[i].v;
+          }
+     for ( i = 0; i < n; ++i )
+          set_for_run ( names[i], values[i] );
+
+     buffer = (char *)MALLOC ( strlen ( basename ) + strlen ( checkname ) + 40 );
+     if ( !overridden ( names, n, "random_seed" ) )
+     {
+          sprintf ( buffer, "%ld", seed + run - 1 );
+          set_for_run ( "random_seed", buffer );
+     }
+     if ( !overridden ( names, n, "output.basename" ) )
+     {
+          sprintf ( buffer, "%s.%d", basename, run );
+          set_for_run ( "output.basename", buffer );
+     }
+     if ( !overridden ( names, n, "checkpoint.filename" ) )
+     {
+          sprintf ( buffer, "%s.%d.%s", basename, run, checkname );
+          set_for_run ( "checkpoint.filename", buffer );
+     }
+     
+     FREE ( buffer );
+     FREE ( names );
+     FREE ( values );
+}
+
+/* run_gp_batch()
+ *
+ * does the runs.  the cases are loaded, the function sets built and the
+ * output streams open, as for a single run.
+ */
+
+void run_gp_batch ( int runs, event *t_eval, event *t_breed )
+{
+     multipop *mpop;
+     char *param, *basename, *checkname;
+     double *fitness;
+     int *hits, *gen;
+     long seed;
+     int run;
+
+     param = get_parameter ( "random_seed" );
+     seed = param ? atol ( param ) : 1;
+     param = get_parameter ( "output.basename" );
+     basename = (char *)MALLOC ( strlen ( param ) + 1 );
+     strcpy ( basename, param );
+     param = get_parameter ( "checkpoint.filename" );
+     checkname = (char *)MALLOC ( strlen ( param ) + 1 );
+     strcpy ( checkname, param );
+
+     fitness = (double *)MALLOC ( runs * sizeof ( double ) );
+     hits = (int *)MALLOC ( runs * sizeof ( int ) );
+     gen = (int *)MALLOC ( runs * sizeof ( int ) );
+
+     for ( run = 1; run <= runs; ++run )
+     {
+          batch_run = run;
+          set_run_parameters ( run, basename, seed, checkname );
+          switch_output_streams ( get_parameter ( "output.basename" ) );
+          oprintf ( OUT_SYS, 10, "\n======= batch run %d of %d:  %s =======\n",
+                   run, runs, get_parameter ( "output.basename" ) );
+
+	  /* the app keeps the cases it already has, and starts the rest
+	     of its state afresh. */
+          read_tree_limits();
+          initialize_random();
+          if ( app_initialize ( 0 ) )
+               error ( E_FATAL_ERROR, "app_initialize() failure." );
+          
+          mpop = initial_multi_population();
+          initialize_topology ( mpop );
+          initialize_breeding ( mpop );
+          run_gp ( mpop, 0, t_eval, t_breed, 0 );
+          run_best ( fitness+run-1, hits+run-1, gen+run-1 );
+          free_breeding ( mpop );
+          free_topology ( mpop );
+          free_multi_population ( mpop );
+
+          restore_parameters();
+
+	  /* a preempted run ends the batch; it restarts from the run's
+	     checkpoint. */
+          if ( budget_preempted() )
+          {
+               runs = run;
+               break;
+          }
+     }
+     batch_run = 0;
+
+     oprintf ( OUT_SYS, 10, "\n------- batch -------\n" );
+     oprintf ( OUT_SYS, 10, "   run   standardized    hits   generation\n" );
+     for ( run = 1; run <= runs; ++run )
+          oprintf ( OUT_SYS, 10, "%6d   %12.6f  %6d   %10d\n", run,
+                   fitness[run-1], hits[run-1], gen[run-1] );
+
+     FREE ( saved_name );
+     FREE ( saved_value );
+     saved_name = saved_value = NULL;
+     saved_size = 0;
+     FREE ( fitness );
+     FREE ( hits );
+     FREE ( gen );
+     FREE ( basename );
+     FREE ( checkname );
+}
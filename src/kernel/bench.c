@@ -0,0 +1,754 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+
+#include "lilgp.h"
+
+/* the benchmark suite.
+ *
+ * run with "lil-gp -b ...": after the usual initialization (parameters,
+ * function sets, application data) the kernel runs the benchmarks
+ * instead of evolving.  each benchmark repeats its operation until at
+ * least "bench.seconds" of wall time has passed, and reports the mean
+ * time per operation.  everything is seeded from "random_seed", so the
+ * work done is the same from run to run and commit to commit.
+ *
+ * parameters:
+ *    bench.run          comma-separated list of benchmarks to run, or
+ *                       "all".  names are eval, tiled, generate,
+ *                       replace, subtree, select, checkpoint, ercgc,
+ *                       macro.
+ *    bench.seconds      minimum time for each benchmark (default 0.5).
+ *    bench.generations  generations for the macro benchmark (default 5).
+ *    bench.output       file the results are appended to, one JSON
+ *                       object per line (default "bench.jsl").
+ *    bench.tag          string stored with each result, eg. a commit id.
+ *    bench.compare      a previous results file; each result is printed
+ *                       next to the last result with the same name,
+ *                       number of cases and population size.
+ *
+ * the dataset is whatever the application loaded, so the macro
+ * benchmark can be run against synthetic data of any size with
+ * app.synthetic_cases.
+ */
+
+int benchmode = 0;
+
+static double min_seconds;
+static long seed;
+static char *tag;
+static FILE *bout;
+
+/* names, sizes and timings from the comparison file. */
+static int compare_count = 0;
+static char **compare_name;
+static int *compare_cases;
+static int *compare_pop;
+static double *compare_ns;
+
+/* bench_wanted()
+ *
+ * checks "bench.run" for a benchmark name.
+ */
+
+static int bench_wanted ( char *name )
+{
+     char *param = get_parameter ( "bench.run" );
+     char **argv;
+     int argc, i, ret = 0;
+
+     if ( param == NULL || strcmp ( param, "all" ) == 0 )
+          return 1;
+     
+     argc = parse_o_rama ( param, &argv );
+     for ( i = 0; i < argc; ++i )
+          if ( strcmp ( argv[i], name ) == 0 )
+               ret = 1;
+     free_o_rama ( argc, &argv );
+
+     return ret;
+}
+
+/* read_comparison()
+ *
+ * loads the results of an earlier run from "bench.compare".  only the
+ * name, number of cases, population size and time of each line are
+ * used; later lines replace earlier ones with the same name and sizes.
+ */
+
+static void read_comparison ( char *filename )
+{
+     FILE *f;
+     char line[1024], name[256];
+     char *p;
+     double ns;
+     int i, ncases, npop;
+
+     f = fopen ( filename, "r" );
+     if ( f == NULL )
+     {
+          error ( E_WARNING, "can't open benchmark comparison file \"%s\".",
+                 filename );
+          return;
+     }
+
+     while ( fgets ( line, 1024, f ) )
+     {
+          p = strstr ( line, "\"bench\":\"" );
+          if ( p == NULL || sscanf ( p+9, "%255[^\"]", name ) != 1 )
+               continue;
+          p = strstr ( line, "\"cases\":" );
+          if ( p == NULL || sscanf ( p+8, "%d", &ncases ) != 1 )
+               continue;
+          p = strstr ( line, "\"pop_size\":" );
+          if ( p == NULL || sscanf ( p+11, "%d", &npop ) != 1 )
+               continue;
+          p = strstr ( line, "\"ns_per_op\":" );
+          if ( p == NULL || sscanf ( p+12, "%lf", &ns ) != 1 )
+               continue;
+
+          for ( i = 0; i < compare_count; ++i )
+               if ( strcmp ( compare_name[i], name ) == 0 &&
+                    compare_cases[i] == ncases && compare_pop[i] == npop )
+                    break;
+          if ( i == compare_count )
+          {
+               compare_name = (char **)REALLOC ( compare_name,
+                                                (compare_count+1) * sizeof ( char * ) );
+               compare_cases = (int *)REALLOC ( compare_cases,
+                                               (compare_count+1) * sizeof ( int ) );
+               compare_pop = (int *)REALLOC ( compare_pop,
+                                             (compare_count+1) * sizeof ( int ) );
+               compare_ns = (double *)REALLOC ( compare_ns,
+                                               (compare_count+1) * sizeof ( double ) );
+               compare_name[i] = (char *)MALLOC ( strlen ( name ) + 1 );
+               strcpy ( compare_name[i], name );
+               compare_cases[i] = ncases;
+               compare_pop[i] = npop;
+               ++compare_count;
+          }
+          compare_ns[i] = ns;
+     }
+
+     fclose ( f );
+}
+
+/* report()
+ *
+ * prints one result to the .sys file and the results file.
+ */
+
+static void report ( char *name, long ops, uint64_t ns, char *unit )
+{
+     double per = (double)ns / ops;
+     int pop_size = atoi ( get_parameter ( "pop_size" ) );
+     int i;
+
+     oprintf ( OUT_SYS, 10, "    %-32s %14.1lf ns/%-10s (%ld)", name, per,
+              unit, ops );
+     for ( i = 0; i < compare_count; ++i )
+          if ( strcmp ( compare_name[i], name ) == 0 &&
+               compare_cases[i] == fitness_cases && compare_pop[i] == pop_size )
+          {
+               oprintf ( OUT_SYS, 10, "   was %.1lf, x%.3lf", compare_ns[i],
+                        per / compare_ns[i] );
+               break;
+          }
+     oputs ( OUT_SYS, 10, "\n" );
+          
+     if ( bout )
+          fprintf ( bout, "{\"bench\":\"%s\",\"tag\":\"%s\",\"cases\":%d,\"pop_size\":%s,\"ops\":%ld,\"unit\":\"%s\",\"ns_per_op\":%.3lf}\n",
+                   name, tag, fitness_cases, get_parameter ( "pop_size" ),
+                   ops, unit, per );
+}
+
+/* bench_population()
+ *
+ * creates a fresh, evaluated, single-subpopulation multipop from the
+ * current parameters, starting from the benchmark seed.
+ */
+
+static multipop *bench_population ( void )
+{
+     multipop *mpop;
+     population *pop;
+     int k;
+
+     random_seed ( seed );
+     mpop = initial_multi_population();
+     pop = mpop->pop[0];
+     generation_No = 0;
+     for ( k = 0; k < pop->size; ++k )
+     {
+          population_No = k;
+          app_eval_fitness ( pop->ind+k );
+     }
+
+     return mpop;
+}
+
+/* elapsed()
+ *
+ * true once a benchmark that started at start has run long enough.
+ */
+
+static int elapsed ( uint64_t start )
+{
+     return ( prof_now() - start ) / 1e9 >= min_seconds;
+}
+
+/* bench_eval()
+ *
+ * evaluate_tree() over the trees of the population, per node; and
+ * the application's fitness function, per node per fitness case.
+ */
+
+static void bench_eval ( population *pop )
+{
+     uint64_t start;
+     long nodes = 0, ops = 0;
+     int k;
+
+     for ( k = 0; k < pop->size; ++k )
+          nodes += pop->ind[k].tr[0].nodes;
+
+     start = prof_now();
+     do
+     {
+          for ( k = 0; k < pop->size; ++k )
+          {
+               set_current_individual ( pop->ind+k );
+               evaluate_tree ( pop->ind[k].tr[0].data, 0 );
+          }
+          ops += nodes;
+     }
+     while ( !elapsed ( start ) );
+     report ( "eval.tree", ops, prof_now() - start, "node" );
+     
+     ops = 0;
+     start = prof_now();
+     do
+     {
+          for ( k = 0; k < pop->size; ++k )
+          {
+               population_No = k;
+               app_eval_fitness ( pop->ind+k );
+          }
+          ops += nodes * fitness_cases;
+     }
+     while ( !elapsed ( start ) );
+     report ( "eval.app", ops, prof_now() - start, "node-case" );
+}
+
+/* bench_tiled()
+ *
+ * the tiled engine over the whole population, in double and with
+ * "eval.float", per node per fitness case.  the population is scored
+ * again in double afterwards.
+ */
+
+static void bench_tiled ( population *pop )
+{
+     uint64_t start;
+     long nodes = 0, ops;
+     char *param, *saved = NULL;
+     int k, f;
+
+     /* streamed cases are read from the file, and never in float. */
+     if ( eval_engine == EVAL_ENGINE_STREAM )
+          return;
+
+     for ( k = 0; k < pop->size; ++k )
+          nodes += pop->ind[k].tr[0].nodes;
+
+     param = get_parameter ( "eval.float" );
+     if ( param )
+     {
+          saved = (char *)MALLOC ( strlen ( param ) + 1 );
+          strcpy ( saved, param );
+     }
+
+     for ( f = 0; f < 2; ++f )
+     {
+          add_parameter ( "eval.float", f ? "1" : "0", PARAM_COPY_NONE );
+          ops = 0;
+          start = prof_now();
+          do
+          {
+               for ( k = 0; k < pop->size; ++k )
+                    pop->ind[k].evald = EVAL_CACHE_INVALID;
+               tile_evaluate_pop ( pop );
+               ops += nodes * fitness_cases;
+          }
+          while ( !elapsed ( start ) );
+          report ( f ? "eval.tiled.float" : "eval.tiled", ops,
+                  prof_now() - start, "node-case" );
+     }
+
+     if ( saved )
+     {
+          add_parameter ( "eval.float", saved, PARAM_COPY_VALUE );
+          FREE ( saved );
+     }
+     else
+          delete_parameter ( "eval.float" );
+     free_tile();
+
+     for ( k = 0; k < pop->size; ++k )
+     {
+          population_No = k;
+          app_eval_fitness ( pop->ind+k );
+          pop->ind[k].flags &= ~FLAG_FLOATFIT;
+     }
+}
+
+/* bench_generate()
+ *
+ * random tree generation, full and grow, at the deepest initial depth.
+ */
+
+static void bench_generate ( void )
+{
+     uint64_t start;
+     long ops;
+     int depth = 6;
+     char *param;
+     
+     param = get_parameter ( "init.depth" );
+     if ( param && strchr ( param, '-' ) )
+          depth = atoi ( strchr ( param, '-' ) + 1 );
+
+     random_seed ( seed );
+     ops = 0;
+     start = prof_now();
+     do
+     {
+          gensp_reset ( 0 );
+          generate_random_full_tree ( 0, depth, fset+tree_map[0].fset );
+          if ( ( ++ops & 1023 ) == 0 )
+               ephem_const_gc();
+     }
+     while ( ( ops & 63 ) || !elapsed ( start ) );
+     report ( "generate.full", ops, prof_now() - start, "tree" );
+     ephem_const_gc();
+
+     random_seed ( seed );
+     ops = 0;
+     start = prof_now();
+     do
+     {
+          gensp_reset ( 0 );
+          generate_random_grow_tree ( 0, depth, fset+tree_map[0].fset );
+          if ( ( ++ops & 1023 ) == 0 )
+               ephem_const_gc();
+     }
+     while ( ( ops & 63 ) || !elapsed ( start ) );
+     report ( "generate.grow", ops, prof_now() - start, "tree" );
+
+     /* the ERCs in the generated trees were never referenced. */
+     ephem_const_gc();
+}
+
+/* bench_replace()
+ *
+ * copy_tree_replace_many(), as crossover uses it: one random subtree of
+ * one tree replaced by a random subtree of another.
+ */
+
+static void bench_replace ( population *pop )
+{
+     uint64_t start;
+     long ops = 0;
+     lnode *a, *b, *sa, *sb;
+     int repcount;
+
+     random_seed ( seed );
+     start = prof_now();
+     do
+     {
+          a = pop->ind[random_int ( pop->size )].tr[0].data;
+          b = pop->ind[random_int ( pop->size )].tr[0].data;
+          sa = get_subtree ( a, random_int ( tree_nodes ( a ) ) );
+          sb = get_subtree ( b, random_int ( tree_nodes ( b ) ) );
+          gensp_reset ( 0 );
+          copy_tree_replace_many ( 0, a, &sa, &sb, 1, &repcount );
+          ++ops;
+     }
+     while ( ( ops & 63 ) || !elapsed ( start ) );
+     report ( "copy_tree_replace_many", ops, prof_now() - start, "copy" );
+}
+
+/* bench_subtree()
+ *
+ * get_subtree(), get_subtree_internal() and get_subtree_external() at
+ * uniformly chosen indices.
+ */
+
+static void bench_subtree ( population *pop )
+{
+     uint64_t start;
+     long ops;
+     int which, k, n;
+     tree *t;
+     static char *names[3] = { "get_subtree", "get_subtree_internal",
+                                    "get_subtree_external" };
+
+     for ( which = 0; which < 3; ++which )
+     {
+          random_seed ( seed );
+          ops = 0;
+          start = prof_now();
+          do
+          {
+               for ( k = 0; k < pop->size; ++k )
+               {
+                    t = pop->ind[k].tr;
+                    switch ( which )
+                    {
+                       case 0:
+                         get_subtree ( t->data, random_int ( t->nodes ) );
+                         break;
+                       case 1:
+                         n = tree_nodes_internal ( t->data );
+                         if ( n )
+                              get_subtree_internal ( t->data, random_int ( n ) );
+                         break;
+                       case 2:
+                         n = tree_nodes_external ( t->data );
+                         get_subtree_external ( t->data, random_int ( n ) );
+                         break;
+                    }
+               }
+               ops += pop->size;
+          }
+          while ( !elapsed ( start ) );
+          report ( names[which], ops, prof_now() - start, "call" );
+     }
+}
+
+/* bench_select()
+ *
+ * every method in the selection method table, with default options:
+ * the cost of building a context and of one selection from it.  the
+ * lexicase methods are left out unless "case_errors" is set.
+ */
+
+static void bench_select ( population *pop )
+{
+     extern select_method select_method_table[];
+     select_method *s;
+     sel_context *sc;
+     uint64_t start, init;
+     long ops, inits;
+     int k;
+     char name[100];
+
+     for ( s = select_method_table; s->name; ++s )
+     {
+	  /* the lexicase methods need the population's per-case errors. */
+          if ( case_error_format == CASE_ERRORS_NONE &&
+               ( s->func == select_lexicase_context ||
+                 s->func == select_epsilon_lexicase_context ) )
+               continue;
+          
+          random_seed ( seed );
+          inits = ops = 0;
+          init = 0;
+          start = prof_now();
+          do
+          {
+               init -= prof_now();
+               sc = s->func ( SELECT_INIT, NULL, pop, s->name );
+               init += prof_now();
+               ++inits;
+               for ( k = 0; k < pop->size; ++k )
+                    sc->select_method ( sc );
+               sc->context_method ( SELECT_CLEAN, sc, NULL, NULL );
+               ops += pop->size;
+          }
+          while ( !elapsed ( start ) );
+
+          sprintf ( name, "select.%s.init", s->name );
+          report ( name, inits, init, "context" );
+          sprintf ( name, "select.%s", s->name );
+          report ( name, ops, prof_now() - start - init, "selection" );
+     }
+}
+
+/* bench_checkpoint()
+ *
+ * writing and reading the population (and its ERCs) in checkpoint
+ * format, text and binary, through a temporary file.
+ */
+
+static void bench_checkpoint ( population *pop )
+{
+     FILE *f;
+     ephem_index *eind;
+     ephem_const **rind;
+     int rcount;
+     population *rpop;
+     multipop one, rmpop;
+     uint64_t start, wns = 0, rns = 0;
+     long ops = 0;
+
+     start = prof_now();
+     do
+     {
+          f = tmpfile();
+          if ( f == NULL )
+          {
+               error ( E_WARNING, "can't create a temporary file; skipping checkpoint benchmark." );
+               return;
+          }
+          
+          wns -= prof_now();
+          eind = write_ephem_list ( f );
+          write_population ( pop, eind, f );
+          fflush ( f );
+          wns += prof_now();
+          FREE ( eind );
+
+          rewind ( f );
+          rns -= prof_now();
+          rind = read_ephem_list ( f, NULL );
+          rpop = read_population ( rind, f );
+          rns += prof_now();
+          if ( rind )
+               FREE ( rind );
+          fclose ( f );
+
+	  /* the ERCs just read carry the refcounts of the originals, which
+	     freeing the copy of the population brings back to zero. */
+          free_population ( rpop );
+          ephem_const_gc();
+
+          ops += pop->size;
+     }
+     while ( !elapsed ( start ) );
+
+     report ( "checkpoint.write", ops, wns, "individual" );
+     report ( "checkpoint.read", ops, rns, "individual" );
+
+     /* the same in the binary format. */
+     one.size = 1;
+     one.pop = &pop;
+     wns = rns = 0;
+     ops = 0;
+     start = prof_now();
+     do
+     {
+          f = tmpfile();
+          if ( f == NULL )
+               return;
+          
+          wns -= prof_now();
+          eind = write_ephem_list ( f );
+          write_population_block ( &one, eind, f );
+          fflush ( f );
+          wns += prof_now();
+          FREE ( eind );
+
+          rewind ( f );
+          rns -= prof_now();
+          rind = read_ephem_list ( f, &rcount );
+          read_population_block ( &rmpop, rind, rcount, f );
+          rns += prof_now();
+          if ( rind )
+               FREE ( rind );
+          fclose ( f );
+
+          free_population ( rmpop.pop[0] );
+          FREE ( rmpop.pop );
+          ephem_const_gc();
+
+          ops += pop->size;
+     }
+     while ( !elapsed ( start ) );
+
+     report ( "checkpoint.binary.write", ops, wns, "individual" );
+     report ( "checkpoint.binary.read", ops, rns, "individual" );
+}
+
+/* bench_ercgc()
+ *
+ * ephem_const_gc() over the population's ERCs plus as many newly
+ * created, unreferenced ones.
+ */
+
+static void bench_ercgc ( population *pop )
+{
+     function *erc = NULL;
+     uint64_t start, ns = 0;
+     long ops = 0;
+     int i;
+
+     for ( i = 0; i < fset[0].size; ++i )
+          if ( fset[0].cset[i].type == TERM_ERC )
+               erc = fset[0].cset+i;
+     if ( erc == NULL )
+     {
+          oputs ( OUT_SYS, 10, "    (no ERCs in the function set; skipping ercgc)\n" );
+          return;
+     }
+
+     random_seed ( seed );
+     start = prof_now();
+     do
+     {
+          for ( i = 0; i < pop->size; ++i )
+               new_ephemeral_const ( erc );
+          ns -= prof_now();
+          ephem_const_gc();
+          ns += prof_now();
+          ++ops;
+     }
+     while ( !elapsed ( start ) );
+     report ( "ephem_const_gc", ops, ns, "collection" );
+}
+
+/* bench_macro()
+ *
+ * evaluation plus breeding for bench.generations generations, from
+ * a fresh initial population.  reported per generation and per
+ * individual evaluated.
+ */
+
+static void bench_macro ( void )
+{
+     multipop *mpop;
+     uint64_t start;
+     int gens, g, i;
+     long inds = 0;
+     char *param;
+
+     param = get_parameter ( "bench.generations" );
+     gens = param ? atoi ( param ) : 5;
+     /* the application keeps per-generation arrays sized by
+	max_generations. */
+     if ( gens > generationSIZE )
+          gens = generationSIZE;
+     if ( gens < 1 )
+          return;
+
+     random_seed ( seed );
+     mpop = initial_multi_population();
+     initialize_topology ( mpop );
+     initialize_breeding ( mpop );
+
+     start = prof_now();
+     for ( g = 0; g < gens; ++g )
+     {
+          generation_No = g;
+          for ( i = 0; i < mpop->size; ++i )
+          {
+               evaluate_pop ( mpop->pop[i] );
+               inds += mpop->pop[i]->size;
+          }
+          for ( i = 0; i < mpop->size; ++i )
+               mpop->pop[i] = change_population ( mpop->pop[i], mpop->bpt[i] );
+          ephem_const_gc();
+     }
+     report ( "macro.generation", gens, prof_now() - start, "generation" );
+     report ( "macro.individual", inds, prof_now() - start, "individual" );
+
+     free_breeding ( mpop );
+     free_topology ( mpop );
+     free_multi_population ( mpop );
+     ephem_const_gc();
+}
+
+/* run_benchmarks()
+ *
+ * runs the benchmark suite.
+ */
+
+void run_benchmarks ( void )
+{
+     multipop *mpop;
+     char *param;
+     int i;
+
+     param = get_parameter ( "bench.seconds" );
+     min_seconds = param ? strtod ( param, NULL ) : 0.5;
+     param = get_parameter ( "random_seed" );
+     seed = param ? atol ( param ) : 1;
+     tag = get_parameter ( "bench.tag" );
+     if ( tag == NULL )
+          tag = "";
+
+     param = get_parameter ( "bench.compare" );
+     if ( param )
+          read_comparison ( param );
+     
+     param = get_parameter ( "bench.output" );
+     if ( param == NULL )
+          param = "bench.jsl";
+     bout = fopen ( param, "a" );
+     if ( bout == NULL )
+          error ( E_WARNING, "can't open benchmark output file \"%s\".", param );
+
+     oprintf ( OUT_SYS, 10, "\nbenchmarks: %d fitness cases, population %s, at least %.2lf s each\n",
+              fitness_cases, get_parameter ( "pop_size" ), min_seconds );
+
+     mpop = bench_population();
+     
+     if ( bench_wanted ( "eval" ) )
+          bench_eval ( mpop->pop[0] );
+     if ( bench_wanted ( "tiled" ) )
+          bench_tiled ( mpop->pop[0] );
+     if ( bench_wanted ( "generate" ) )
+          bench_generate();
+     if ( bench_wanted ( "replace" ) )
+          bench_replace ( mpop->pop[0] );
+     if ( bench_wanted ( "subtree" ) )
+          bench_subtree ( mpop->pop[0] );
+     if ( bench_wanted ( "select" ) )
+          bench_select ( mpop->pop[0] );
+     if ( bench_wanted ( "checkpoint" ) )
+          bench_checkpoint ( mpop->pop[0] );
+     if ( bench_wanted ( "ercgc" ) )
+          bench_ercgc ( mpop->pop[0] );
+
+     free_multi_population ( mpop );
+     ephem_const_gc();
+     
+     if ( bench_wanted ( "macro" ) )
+          bench_macro();
+
+     if ( bout )
+          fclose ( bout );
+     for ( i = 0; i < compare_count; ++i )
+          FREE ( compare_name[i] );
+     if ( compare_count )
+     {
+          FREE ( compare_name );
+          FREE ( compare_cases );
+          FREE ( compare_pop );
+          FREE ( compare_ns );
+     }
+}
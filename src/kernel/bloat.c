@@ -0,0 +1,707 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+#include "lilgp.h"
+
+/* bloat control.
+ *
+ * four ways of keeping trees small, which keep evaluation cheap as a
+ * run goes on:
+ *
+ *   "bloat.tarpeian = p"     Tarpeian selection:  each individual about
+ *                            to be evaluated that is bigger than the
+ *                            population's mean is, with probability p,
+ *                            given the fitness of the population's
+ *                            worst individual instead.  it is not
+ *                            evaluated at all.
+ *
+ *   double_tournament        a selection method:  tournaments on
+ *                            fitness whose contestants are the winners
+ *                            of size tournaments, or the other way
+ *                            around.  options "size" (of the fitness
+ *                            tournament, default 7), "parsimony" (the
+ *                            size tournament picks the smaller of two
+ *                            with probability parsimony/2; between 1
+ *                            and 2, default 1.4) and "fitness_first"
+ *                            (the fitness tournaments are the
+ *                            qualifiers; default no).
+ *
+ *   crossover "fair"         "fair = size" picks the second parent's
+ *                            crossover point among subtrees no bigger
+ *                            than 1+2s, where s is the size of the first
+ *                            parent's, so that on average the offspring
+ *                            are no bigger than the parents (size-fair
+ *                            crossover).  "fair = homologous" also
+ *                            prefers the subtree nearest the depth of
+ *                            the first.
+ *
+ *   "bloat.opeq = w"         operator equalisation:  the sizes of a new
+ *                            population are held to a distribution, in
+ *                            bins w nodes wide, set by the mean fitness
+ *                            of each bin in the old population.  an
+ *                            offspring whose bin is full is thrown away
+ *                            and another bred.  the distribution grows
+ *                            by one bin when the best individual is in
+ *                            the top bin.  (offspring aren't evaluated
+ *                            while breeding, so unlike the original
+ *                            method a bigger offspring isn't let in for
+ *                            having a new best fitness.)  generational
+ *                            runs only.
+ *
+ * sizes are node counts.
+ */
+
+/* give up on the opeq distribution after this many offspring per
+   individual have been thrown away. */
+#define OPEQ_ATTEMPTS     10
+
+typedef struct
+{
+     int count;
+     double parsimony;
+     int fitness_first;
+} double_tournament_data;
+
+static double tarpeian;
+
+/* the worst fitness in the population, which Tarpeian victims are
+   given; in a generational population it is only known once the rest
+   are evaluated. */
+static int tarpeian_found;
+static double tarpeian_r;
+static double tarpeian_s;
+static double tarpeian_a;
+
+static long tarpeian_checked = 0;
+static long tarpeian_killed = 0;
+static long size_rounds = 0;
+static long size_smaller = 0;
+static long fair_count = 0;
+static double fair_removed = 0.0;
+static double fair_inserted = 0.0;
+static long opeq_generations = 0;
+static long opeq_rejected = 0;
+static long opeq_overflow = 0;
+
+/* the opeq bins for the population being bred. */
+static int opeq_width = 0;
+static int opeq_bins = 0;
+static int *opeq_capacity = NULL;
+static int *opeq_count = NULL;
+static int opeq_tries;
+static int opeq_limit;
+
+/* the subtrees of the second parent, for fair crossover. */
+static lnode **sub_node = NULL;
+static int *sub_nodes = NULL;
+static int *sub_depth = NULL;
+static int sub_size = 0;
+
+/* bloat_mean_size()
+ *
+ * the mean node count of a population.
+ */
+
+double bloat_mean_size ( population *pop )
+{
+     double total = 0.0;
+     int k;
+
+     for ( k = 0; k < pop->size; ++k )
+          total += individual_size ( pop->ind+k );
+     return total / pop->size;
+}
+
+/* tarpeian_worst()
+ *
+ * finds the lowest adjusted fitness among a population's evaluated
+ * individuals, leaving out victims still waiting for it.
+ */
+
+static void tarpeian_worst ( population *pop )
+{
+     individual *ind;
+     int k;
+
+     tarpeian_found = 0;
+     for ( k = 0; k < pop->size; ++k )
+     {
+          ind = pop->ind+k;
+          if ( ind->evald != EVAL_CACHE_VALID || ind->s_fitness == HUGE_VAL )
+               continue;
+          if ( !tarpeian_found || ind->a_fitness < tarpeian_a )
+          {
+               tarpeian_r = ind->r_fitness;
+               tarpeian_s = ind->s_fitness;
+               tarpeian_a = ind->a_fitness;
+               tarpeian_found = 1;
+          }
+     }
+}
+
+/* bloat_tarpeian_begin()
+ *
+ * reads the Tarpeian rate and finds the population's worst fitness.
+ * returns the mean size of the population, or -1 if Tarpeian
+ * selection is off.
+ */
+
+double bloat_tarpeian_begin ( population *pop )
+{
+     char *param;
+
+     param = get_parameter ( "bloat.tarpeian" );
+     tarpeian = param ? atof ( param ) : 0.0;
+     if ( tarpeian <= 0.0 )
+          return -1.0;
+     tarpeian_worst ( pop );
+     return bloat_mean_size ( pop );
+}
+
+/* bloat_tarpeian()
+ *
+ * decides whether an individual about to be evaluated is to be given
+ * the worst fitness instead, given the mean from
+ * bloat_tarpeian_begin().  returns 1 if it was.
+ */
+
+int bloat_tarpeian ( individual *ind, double mean )
+{
+     if ( mean < 0.0 )
+          return 0;
+
+     ++tarpeian_checked;
+     if ( individual_size ( ind ) <= mean || random_double() >= tarpeian )
+          return 0;
+
+     /* without a worst fitness yet, bloat_tarpeian_end() fills it in;
+	the values must stay finite for the inverse_fitness widths. */
+     if ( tarpeian_found )
+     {
+          ind->r_fitness = tarpeian_r;
+          ind->s_fitness = tarpeian_s;
+          ind->a_fitness = tarpeian_a;
+     }
+     else
+     {
+          ind->r_fitness = HUGE_VAL;
+          ind->s_fitness = HUGE_VAL;
+          ind->a_fitness = 0.0;
+     }
+     ind->hits = 0;
+     ind->evald = EVAL_CACHE_VALID;
+     ind->flags &= ~FLAG_FLOATFIT;
+     ind->flags |= FLAG_TARPEIAN;
+     worst_case_errors ( ind );
+     ++tarpeian_killed;
+     return 1;
+}
+
+/* bloat_tarpeian_pop()
+ *
+ * applies bloat_tarpeian() to each individual of a population that
+ * needs evaluating.  the victims get their fitness from
+ * bloat_tarpeian_end(), once the rest are evaluated.
+ */
+
+void bloat_tarpeian_pop ( population *pop )
+{
+     double mean;
+     int k;
+
+     mean = bloat_tarpeian_begin ( pop );
+     if ( mean < 0.0 )
+          return;
+     tarpeian_found = 0;
+     for ( k = 0; k < pop->size; ++k )
+          if ( pop->ind[k].evald != EVAL_CACHE_VALID )
+               bloat_tarpeian ( pop->ind+k, mean );
+}
+
+/* bloat_tarpeian_end()
+ *
+ * gives the victims of bloat_tarpeian_pop() the worst fitness of the
+ * evaluated population.
+ */
+
+void bloat_tarpeian_end ( population *pop )
+{
+     individual *ind;
+     int k;
+
+     if ( tarpeian <= 0.0 )
+          return;
+     tarpeian_worst ( pop );
+     if ( !tarpeian_found )
+          return;
+     for ( k = 0; k < pop->size; ++k )
+     {
+          ind = pop->ind+k;
+          if ( ( ind->flags & FLAG_TARPEIAN ) && ind->s_fitness == HUGE_VAL )
+          {
+               ind->r_fitness = tarpeian_r;
+               ind->s_fitness = tarpeian_s;
+               ind->a_fitness = tarpeian_a;
+          }
+     }
+}
+
+/* select_double_tournament_context()
+ *
+ * returns a selection context for the double_tournament method.
+ */
+
+sel_context *select_double_tournament_context ( int op, sel_context *sc,
+                                               population *p, char *string )
+{
+     char **argv;
+     int i, j;
+     double_tournament_data *td;
+     
+     switch ( op )
+     {
+        case SELECT_INIT:
+
+          sc = (sel_context *)MALLOC ( sizeof ( sel_context ) );
+          sc->p = p;
+          sc->select_method = select_double_tournament;
+          sc->context_method = select_double_tournament_context;
+
+          td = (double_tournament_data *)MALLOC ( sizeof ( double_tournament_data ) );
+          td->count = 7;
+          td->parsimony = 1.4;
+          td->fitness_first = 0;
+          j = parse_o_rama ( string, &argv );
+          for ( i = 1; i < j; ++i )
+          {
+               if ( strcmp ( argv[i], "size" ) == 0 )
+                    td->count = atoi ( argv[++i] );
+               else if ( strcmp ( argv[i], "parsimony" ) == 0 )
+                    td->parsimony = strtod ( argv[++i], NULL );
+               else if ( strcmp ( argv[i], "fitness_first" ) == 0 )
+                    td->fitness_first = translate_binary ( argv[++i] );
+               else
+                    error ( E_FATAL_ERROR, "unknown double_tournament option \"%s\".",
+                           argv[i] );
+          }
+	  free_o_rama ( j, &argv );
+          
+          if ( td->count <= 0 )
+               error ( E_FATAL_ERROR,
+                      "tournament size must be at least 1.  (%s)", string );
+          if ( td->parsimony < 1.0 || td->parsimony > 2.0 )
+               error ( E_FATAL_ERROR,
+                      "double_tournament parsimony must be between 1 and 2.  (%s)",
+                      string );
+          if ( td->fitness_first == -1 )
+               error ( E_FATAL_ERROR,
+                      "double_tournament fitness_first must be yes or no.  (%s)",
+                      string );
+
+          sc->data = (void *)td;
+          return sc;
+          break;
+          
+        case SELECT_CLEAN:
+
+          FREE ( sc->data );
+          FREE ( sc );
+          return NULL;
+          break;
+     }
+
+     return NULL;
+}
+
+static int size_round ( sel_context *sc, int fitness_first );
+
+/* fitness_round()
+ *
+ * a tournament on fitness.  each contestant is picked at random, or
+ * (if size_first) is the winner of a size round.
+ */
+
+static int fitness_round ( sel_context *sc, int size_first )
+{
+     double_tournament_data *td = (double_tournament_data *)(sc->data);
+     population *p = sc->p;
+     int i, j = -1, k;
+
+     for ( i = 0; i < td->count; ++i )
+     {
+          k = size_first ? size_round ( sc, 0 ) : random_int ( p->size );
+          if ( j == -1 || p->ind[k].a_fitness > p->ind[j].a_fitness )
+               j = k;
+     }
+     return j;
+}
+
+/* size_round()
+ *
+ * a tournament of two on size:  the smaller wins with probability
+ * parsimony/2.  the contestants are picked at random, or (if
+ * fitness_first) are the winners of fitness rounds.
+ */
+
+static int size_round ( sel_context *sc, int fitness_first )
+{
+     double_tournament_data *td = (double_tournament_data *)(sc->data);
+     population *p = sc->p;
+     int a, b, t, sa, sb;
+
+     a = fitness_first ? fitness_round ( sc, 0 ) : random_int ( p->size );
+     b = fitness_first ? fitness_round ( sc, 0 ) : random_int ( p->size );
+     sa = individual_size ( p->ind+a );
+     sb = individual_size ( p->ind+b );
+
+     ++size_rounds;
+     if ( sa == sb )
+          return random_int ( 2 ) ? a : b;
+     if ( sb < sa )
+     {
+          t = a;
+          a = b;
+          b = t;
+     }
+     /* a is now the smaller. */
+     if ( random_double() < td->parsimony / 2.0 )
+     {
+          ++size_smaller;
+          return a;
+     }
+     return b;
+}
+
+/* select_double_tournament()
+ *
+ * does a double tournament selection.
+ */
+
+int select_double_tournament ( sel_context *sc )
+{
+     double_tournament_data *td = (double_tournament_data *)(sc->data);
+
+     if ( td->fitness_first )
+          return size_round ( sc, 1 );
+     return fitness_round ( sc, 1 );
+}
+
+/* bloat_fair_subtree()
+ *
+ * picks the second parent's crossover point for fair crossover, given
+ * the first parent's tree and point.  fair is 1 for size-fair, 2 for
+ * homologous.
+ */
+
+lnode *bloat_fair_subtree ( lnode *data, int nodes, lnode *data1,
+                           lnode *st1, int fair )
+{
+     int s, d = 0;
+     int i, n, c;
+     int ns = 0, ne = 0, nl = 0;
+     double ms = 0.0, ml = 0.0;
+     int want, best = -1, bestd = 0, ties = 0;
+
+     s = tree_nodes ( st1 );
+     if ( fair == BLOAT_FAIR_HOMOLOGOUS )
+          d = tree_depth_to_subtree ( data1, st1 );
+
+     if ( nodes > sub_size )
+     {
+          sub_size = nodes * 2;
+          sub_node = (lnode **)REALLOC ( sub_node, sub_size * sizeof ( lnode * ) );
+          sub_nodes = (int *)REALLOC ( sub_nodes, sub_size * sizeof ( int ) );
+          sub_depth = (int *)REALLOC ( sub_depth, sub_size * sizeof ( int ) );
+     }
+     tree_subtrees ( data, sub_node, sub_nodes, sub_depth );
+
+     /* the candidates, no bigger than 1+2s, in three classes:  smaller
+	than s, the same, and bigger. */
+     for ( i = 0; i < nodes; ++i )
+     {
+          n = sub_nodes[i];
+          if ( n > 2 * s + 1 )
+               continue;
+          if ( n < s )
+          {
+               ++ns;
+               ms += n;
+          }
+          else if ( n == s )
+               ++ne;
+          else
+          {
+               ++nl;
+               ml += n;
+          }
+     }
+
+     /* pick a class:  the same size in proportion to how many there
+	are, and otherwise smaller or bigger so that the size is
+	unchanged on average. */
+     if ( ne && random_int ( ns + ne + nl ) < ne )
+          want = 0;
+     else if ( ns && nl )
+     {
+          ms /= ns;
+          ml /= nl;
+          want = random_double() * ( ml - ms ) < s - ms ? 1 : -1;
+     }
+     else if ( ns )
+          want = -1;
+     else if ( nl )
+          want = 1;
+     else
+          want = 0;
+
+     /* pick a member of the class:  at random, or the one at the
+	nearest depth to the first point (ties at random). */
+     for ( i = 0; i < nodes; ++i )
+     {
+          n = sub_nodes[i];
+          if ( n > 2 * s + 1 || ( n > s ) - ( n < s ) != want )
+               continue;
+          c = fair == BLOAT_FAIR_HOMOLOGOUS ? abs ( sub_depth[i] - d ) : 0;
+          if ( best == -1 || c < bestd )
+          {
+               best = i;
+               bestd = c;
+               ties = 1;
+          }
+          else if ( c == bestd && random_int ( ++ties ) == 0 )
+               best = i;
+     }
+
+     ++fair_count;
+     fair_removed += s;
+     fair_inserted += sub_nodes[best];
+     return sub_node[best];
+}
+
+/* bloat_opeq_begin()
+ *
+ * sets up the opeq distribution for breeding a population of size
+ * individuals from oldpop.  returns 0 if opeq is off.
+ */
+
+int bloat_opeq_begin ( population *oldpop, int size )
+{
+     char *param;
+     double *fit, low = HUGE_VAL, total = 0.0;
+     int *count;
+     int i, b, best, top, left;
+
+     param = get_parameter ( "bloat.opeq" );
+     opeq_width = param ? atoi ( param ) : 0;
+     if ( opeq_width <= 0 )
+          return 0;
+
+     /* the old population's bins, and the bin of its best
+	individual. */
+     opeq_bins = 0;
+     best = 0;
+     for ( i = 0; i < oldpop->size; ++i )
+     {
+          b = ( individual_size ( oldpop->ind+i ) - 1 ) / opeq_width;
+          if ( b >= opeq_bins )
+               opeq_bins = b + 1;
+          if ( oldpop->ind[i].a_fitness > oldpop->ind[best].a_fitness )
+               best = i;
+     }
+     top = ( individual_size ( oldpop->ind+best ) - 1 ) / opeq_width;
+     /* room to grow, if the best individual is among the biggest. */
+     if ( top == opeq_bins - 1 )
+          ++opeq_bins;
+
+     opeq_capacity = (int *)MALLOC ( opeq_bins * sizeof ( int ) );
+     opeq_count = (int *)MALLOC ( opeq_bins * sizeof ( int ) );
+     fit = (double *)MALLOC ( opeq_bins * sizeof ( double ) );
+     count = opeq_count;
+     for ( b = 0; b < opeq_bins; ++b )
+     {
+          fit[b] = 0.0;
+          count[b] = 0;
+     }
+     for ( i = 0; i < oldpop->size; ++i )
+     {
+          b = ( individual_size ( oldpop->ind+i ) - 1 ) / opeq_width;
+          fit[b] += oldpop->ind[i].a_fitness;
+          ++count[b];
+     }
+
+     /* each bin holds a share of the population in proportion to how
+	much its mean fitness beats the worst bin's (or, if they're all
+	alike, to its share of the old population).  every bin has room
+	for at least one. */
+     for ( b = 0; b < opeq_bins; ++b )
+          if ( count[b] )
+          {
+               fit[b] /= count[b];
+               if ( fit[b] < low )
+                    low = fit[b];
+          }
+     best = 0;
+     for ( b = 0; b < opeq_bins; ++b )
+          if ( count[b] )
+          {
+               fit[b] -= low;
+               total += fit[b];
+               if ( fit[b] > fit[best] || !count[best] )
+                    best = b;
+          }
+     left = size;
+     for ( b = 0; b < opeq_bins; ++b )
+     {
+          if ( !count[b] )
+               opeq_capacity[b] = 1;
+          else if ( total > 0.0 )
+               opeq_capacity[b] = (int)( size * fit[b] / total + 0.5 );
+          else
+               opeq_capacity[b] = (int)( (double)size * count[b] / oldpop->size + 0.5 );
+          if ( opeq_capacity[b] < 1 )
+               opeq_capacity[b] = 1;
+          left -= opeq_capacity[b];
+          count[b] = 0;
+     }
+     /* whatever rounding leaves over goes to the fittest bin. */
+     if ( left > 0 )
+          opeq_capacity[best] += left;
+
+     FREE ( fit );
+     opeq_tries = 0;
+     opeq_limit = OPEQ_ATTEMPTS * size;
+     ++opeq_generations;
+     return 1;
+}
+
+/* bloat_opeq_filter()
+ *
+ * looks at the offspring newpop->ind[first..next-1] just bred, and
+ * throws away those whose bins are full.
+ */
+
+void bloat_opeq_filter ( population *newpop, int first )
+{
+     individual t;
+     int k, j, b;
+
+     for ( k = newpop->next - 1; k >= first; --k )
+     {
+          b = ( individual_size ( newpop->ind+k ) - 1 ) / opeq_width;
+          if ( b < opeq_bins && opeq_count[b] < opeq_capacity[b] )
+          {
+               ++opeq_count[b];
+               continue;
+          }
+          if ( opeq_tries >= opeq_limit )
+          {
+	       /* the distribution can't be met; take what comes. */
+               ++opeq_overflow;
+               continue;
+          }
+          ++opeq_tries;
+          ++opeq_rejected;
+
+          for ( j = 0; j < tree_count; ++j )
+               free_tree ( newpop->ind[k].tr+j );
+          --newpop->next;
+          if ( k != newpop->next )
+          {
+               t = newpop->ind[k];
+               newpop->ind[k] = newpop->ind[newpop->next];
+               newpop->ind[newpop->next] = t;
+          }
+     }
+}
+
+/* bloat_opeq_end()
+ *
+ * frees the opeq distribution.
+ */
+
+void bloat_opeq_end ( void )
+{
+     FREE ( opeq_capacity );
+     FREE ( opeq_count );
+     opeq_capacity = opeq_count = NULL;
+}
+
+/* free_bloat()
+ *
+ * frees fair crossover's subtree lists.
+ */
+
+void free_bloat ( void )
+{
+     if ( sub_node )
+     {
+          FREE ( sub_node );
+          FREE ( sub_nodes );
+          FREE ( sub_depth );
+     }
+     sub_node = NULL;
+     sub_nodes = sub_depth = NULL;
+     sub_size = 0;
+}
+
+/* output_bloat_stats()
+ *
+ * prints what the bloat controls did, for those that were used.
+ */
+
+void output_bloat_stats ( void )
+{
+     if ( tarpeian_checked == 0 && size_rounds == 0 && fair_count == 0 &&
+          opeq_generations == 0 )
+          return;
+     
+     oprintf ( OUT_SYS, 30, "\n------- bloat control -------\n" );
+     if ( tarpeian_checked )
+     {
+          oprintf ( OUT_SYS, 30, "    tarpeian checked:      %ld\n", tarpeian_checked );
+          oprintf ( OUT_SYS, 30, "   evaluations saved:      %ld\n", tarpeian_killed );
+     }
+     if ( size_rounds )
+     {
+          oprintf ( OUT_SYS, 30, "         size rounds:      %ld\n", size_rounds );
+          oprintf ( OUT_SYS, 30, "      smaller chosen:      %ld\n", size_smaller );
+     }
+     if ( fair_count )
+     {
+          oprintf ( OUT_SYS, 30, "     fair crossovers:      %ld\n", fair_count );
+          oprintf ( OUT_SYS, 30, "   mean size removed:      %.2f\n",
+                   fair_removed / fair_count );
+          oprintf ( OUT_SYS, 30, "  mean size inserted:      %.2f\n",
+                   fair_inserted / fair_count );
+     }
+     if ( opeq_generations )
+     {
+          oprintf ( OUT_SYS, 30, "    opeq generations:      %ld\n", opeq_generations );
+          oprintf ( OUT_SYS, 30, "  offspring rejected:      %ld\n", opeq_rejected );
+          oprintf ( OUT_SYS, 30, "  admitted over bins:      %ld\n", opeq_overflow );
+     }
+}
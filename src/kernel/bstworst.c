@@ -49,6 +49,34 @@ int select_bestworst ( sel_context *sc )
      return bwd->list[bwd->next++];
 }
 
+/* bestworst_update()
+ *
+ * moves the replaced individual to its new place in the sorted list.
+ * the population has changed, so selection starts over from the top
+ * of the list.
+ */
+
+static void bestworst_update ( sel_context *sc,
+                              int (*compare)( const void *, const void * ) )
+{
+     bestworst_data *bwd = (bestworst_data *)(sc->data);
+     int n = sc->p->size;
+     int i;
+
+     /* take it out of the list... */
+     for ( i = 0; bwd->list[i] != sc->changed; ++i );
+     memmove ( bwd->list+i, bwd->list+i+1, (n-1-i) * sizeof ( int ) );
+
+     /* ...and put it back in order. */
+     selectpop = sc->p;
+     for ( i = 0; i < n-1 && compare ( bwd->list+i, &sc->changed ) <= 0; ++i );
+     selectpop = NULL;
+     memmove ( bwd->list+i+1, bwd->list+i, (n-1-i) * sizeof ( int ) );
+     bwd->list[i] = sc->changed;
+
+     bwd->next = 0;
+}
+
 /* select_best_context()
  *
  * Sets up the best selection method.
@@ -88,6 +116,11 @@ sel_context *select_best_context ( int op, sel_context *sc,
           return sc;
           break;
 
+        case SELECT_UPDATE:
+          bestworst_update ( sc, select_best_compare );
+          return sc;
+          break;
+
         case SELECT_CLEAN:
           bwd = (bestworst_data *)(sc->data);
           FREE ( bwd->list );
@@ -154,6 +187,11 @@ sel_context *select_worst_context ( int op, sel_context *sc, population *p,
           return sc;
           break;
 
+        case SELECT_UPDATE:
+          bestworst_update ( sc, select_worst_compare );
+          return sc;
+          break;
+
         case SELECT_CLEAN:
           bwd = (bestworst_data *)(sc->data);
           FREE ( bwd->list );
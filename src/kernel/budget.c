@@ -0,0 +1,378 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+#include "lilgp.h"
+#include <signal.h>
+
+/* run control:  budgets, stagnation, and preemption.
+ *
+ * besides max_generations and the app's termination criterion, a run
+ * stops at the end of a generation when:
+ *
+ *   stop.time         seconds of wall-clock time have been spent
+ *   stop.nodes        this many nodes have been evaluated, counting
+ *                     each node once per fitness case
+ *   stop.stagnation   the best individual of the run has not changed
+ *                     for this many generations
+ *
+ * stop.plateau is the window of the app's own plateau test in
+ * evaluate_pop():  the number of generations the best error may fail
+ * to improve before the run ends (0 turns it off).
+ *
+ * with stop.time set, "stop.adapt" decides what gives when the
+ * generations left won't fit in the time left, going by the time the
+ * generations so far have taken.  "generations" lowers
+ * max_generations; "population" breeds smaller populations, down to
+ * "stop.min_pop_size" (a quarter of pop_size by default), and then
+ * lowers max_generations if that isn't enough.  steady-state runs
+ * only adapt the generation count.
+ *
+ * a SIGTERM makes the run checkpoint at the end of the generation and
+ * stop, so a preempted job can be restarted from the checkpoint with
+ * -c.  a second SIGTERM kills the process as usual.  a SIGUSR1 asks
+ * for a checkpoint at the end of the generation, and the run carries
+ * on.  steady-state runs, whose populations are complete between any
+ * two offspring, stop breeding at the next offspring on a SIGTERM
+ * rather than finishing the generation.  the handlers are installed at
+ * startup, so a signal sent while the run is being set up takes effect
+ * at the end of the first generation.  the time and nodes spent so
+ * far are saved in the checkpoint's parameters ("stop.spent.*"), so
+ * the budgets cover the whole run across restarts.
+ */
+
+int plateau_window = 3;
+
+static volatile sig_atomic_t preempted = 0;
+static volatile sig_atomic_t checkpoint_wanted = 0;
+
+static double time_limit;
+static double node_limit;
+static int stagnation;
+static int adapt_pop;
+static int adapt_gen;
+static int min_pop_size;
+static int steady;
+
+static uint64_t start_ns;
+static uint64_t last_ns;
+static uint64_t end_ns;
+static double gen_ns;
+static double spent_before;
+static long nodes;
+
+/* the population size breeding should produce, or 0 for no change. */
+static int target_size = 0;
+
+static char *stopped_by = NULL;
+
+/* catch_term()
+ *
+ * the SIGTERM handler.  just notes the signal; the run notices at the
+ * end of the generation.
+ */
+
+static void catch_term ( int sig )
+{
+     preempted = 1;
+     signal ( sig, SIG_DFL );
+}
+
+/* catch_usr1()
+ *
+ * the SIGUSR1 handler.
+ */
+
+static void catch_usr1 ( int sig )
+{
+     checkpoint_wanted = 1;
+     signal ( sig, catch_usr1 );
+}
+
+/* budget_signals()
+ *
+ * installs the SIGTERM and SIGUSR1 handlers, once, before anything
+ * else is set up.
+ */
+
+void budget_signals ( void )
+{
+     signal ( SIGTERM, catch_term );
+     signal ( SIGUSR1, catch_usr1 );
+}
+
+/* budget_begin()
+ *
+ * reads the run control parameters and starts the clock.  a signal
+ * already caught stays pending for the run.
+ */
+
+void budget_begin ( int startfromcheckpoint )
+{
+     char *param;
+
+     param = get_parameter ( "stop.time" );
+     time_limit = param ? atof ( param ) : 0.0;
+     param = get_parameter ( "stop.nodes" );
+     node_limit = param ? strtod ( param, NULL ) : 0.0;
+     param = get_parameter ( "stop.stagnation" );
+     stagnation = param ? atoi ( param ) : 0;
+     param = get_parameter ( "stop.plateau" );
+     plateau_window = param ? atoi ( param ) : 3;
+     param = get_parameter ( "steady_state" );
+     steady = ( param && atoi ( param ) );
+
+     adapt_pop = adapt_gen = 0;
+     param = get_parameter ( "stop.adapt" );
+     if ( param == NULL || strcmp ( param, "none" ) == 0 )
+          ;
+     else if ( strcmp ( param, "generations" ) == 0 )
+          adapt_gen = 1;
+     else if ( strcmp ( param, "population" ) == 0 )
+     {
+          adapt_gen = 1;
+          adapt_pop = !steady;
+     }
+     else
+          error ( E_FATAL_ERROR, "\"stop.adapt\" must be \"none\", "
+                 "\"generations\", or \"population\"." );
+
+     param = get_parameter ( "stop.min_pop_size" );
+     if ( param )
+          min_pop_size = atoi ( param );
+     else
+     {
+          param = get_parameter ( "pop_size" );
+          min_pop_size = param ? atoi ( param ) / 4 : 1;
+     }
+     if ( min_pop_size < 1 )
+          min_pop_size = 1;
+
+     /* pick up what a checkpointed run had already spent. */
+     spent_before = 0.0;
+     nodes = 0;
+     if ( startfromcheckpoint )
+     {
+          param = get_parameter ( "stop.spent.time" );
+          if ( param )
+               spent_before = atof ( param );
+          param = get_parameter ( "stop.spent.nodes" );
+          if ( param )
+               nodes = atol ( param );
+     }
+     delete_parameter ( "stop.spent.time" );
+     delete_parameter ( "stop.spent.nodes" );
+
+     start_ns = last_ns = prof_now();
+     end_ns = 0;
+     gen_ns = 0.0;
+     target_size = 0;
+     stopped_by = NULL;
+}
+
+/* budget_end()
+ *
+ * stops the clock.
+ */
+
+void budget_end ( void )
+{
+     end_ns = prof_now();
+}
+
+/* budget_charge()
+ *
+ * counts the nodes an individual about to be evaluated will take.
+ */
+
+void budget_charge ( individual *ind )
+{
+     nodes += (long)individual_size ( ind ) * ( cases.cases > 0 ? cases.cases : 1 );
+}
+
+/* budget_charge_pop()
+ *
+ * the same, for every individual of a population that needs
+ * evaluating.
+ */
+
+void budget_charge_pop ( population *pop )
+{
+     int k;
+
+     for ( k = 0; k < pop->size; ++k )
+          if ( pop->ind[k].evald != EVAL_CACHE_VALID )
+               budget_charge ( pop->ind+k );
+}
+
+/* spent_time()
+ *
+ * seconds spent on the run, including before a restart.
+ */
+
+static double spent_time ( void )
+{
+     return spent_before + ( ( end_ns ? end_ns : prof_now() ) - start_ns ) / 1e9;
+}
+
+/* budget_stop()
+ *
+ * called at the end of each generation's evaluation.  returns 1 if the
+ * run should stop here.  may lower *maxgen, or the size of the
+ * populations bred from now on, to fit the time budget.
+ */
+
+int budget_stop ( int gen, int *maxgen, multipop *mpop )
+{
+     extern popstats *run_stats;
+     uint64_t now = prof_now();
+     double left, need, scale = 1.0;
+     int size, fit;
+
+     /* the time a generation takes, smoothed. */
+     gen_ns = gen_ns > 0.0 ? ( gen_ns + ( now - last_ns ) ) / 2 : now - last_ns;
+     last_ns = now;
+
+     if ( preempted )
+          stopped_by = "SIGTERM";
+     else if ( time_limit > 0.0 && spent_time() >= time_limit )
+          stopped_by = "time budget";
+     else if ( node_limit > 0.0 && nodes >= node_limit )
+          stopped_by = "node budget";
+     else if ( stagnation > 0 && gen - run_stats[0].bestgen >= stagnation )
+          stopped_by = "stagnation";
+     if ( stopped_by )
+     {
+          oprintf ( OUT_SYS, 10, "    stopping:  %s.\n", stopped_by );
+          return 1;
+     }
+
+     if ( time_limit <= 0.0 || !adapt_gen || gen + 1 >= *maxgen )
+          return 0;
+
+     /* will the generations left fit in the time left? */
+     left = ( time_limit - spent_time() ) * 1e9;
+     need = ( *maxgen - gen - 1 ) * gen_ns;
+     if ( need <= left )
+          return 0;
+
+     if ( adapt_pop )
+     {
+          size = mpop->pop[0]->size;
+          if ( size > min_pop_size )
+          {
+               target_size = (int)( size * left / need );
+               if ( target_size < min_pop_size )
+                    target_size = min_pop_size;
+               if ( target_size < size )
+               {
+                    scale = (double)target_size / size;
+                    oprintf ( OUT_SYS, 10, "    budget:  population size "
+                             "lowered to %d.\n", target_size );
+               }
+          }
+          if ( need * scale <= left )
+               return 0;
+     }
+
+     fit = (int)( left / ( gen_ns * scale ) );
+     if ( fit < 1 )
+     {
+          stopped_by = "time budget";
+          oprintf ( OUT_SYS, 10, "    stopping:  %s.\n", stopped_by );
+          return 1;
+     }
+     *maxgen = gen + 1 + fit;
+     oprintf ( OUT_SYS, 10, "    budget:  max_generations lowered to %d.\n",
+              *maxgen );
+     return 0;
+}
+
+/* budget_pop_size()
+ *
+ * the size to breed a population of the given size to.
+ */
+
+int budget_pop_size ( int size )
+{
+     return ( target_size > 0 && target_size < size ) ? target_size : size;
+}
+
+/* budget_preempted()
+ *
+ * returns 1 if a SIGTERM has asked the run to stop.
+ */
+
+int budget_preempted ( void )
+{
+     return preempted;
+}
+
+/* budget_checkpoint_due()
+ *
+ * returns 1 if a signal has asked for a checkpoint since the last
+ * one.
+ */
+
+int budget_checkpoint_due ( void )
+{
+     if ( !preempted && !checkpoint_wanted )
+          return 0;
+     checkpoint_wanted = 0;
+     return 1;
+}
+
+/* budget_save()
+ *
+ * records what has been spent in the parameter database, for a
+ * checkpoint.
+ */
+
+void budget_save ( void )
+{
+     char buffer[40];
+
+     sprintf ( buffer, "%.3f", spent_time() );
+     add_parameter ( "stop.spent.time", buffer, PARAM_COPY_NAME|PARAM_COPY_VALUE );
+     sprintf ( buffer, "%ld", nodes );
+     add_parameter ( "stop.spent.nodes", buffer, PARAM_COPY_NAME|PARAM_COPY_VALUE );
+}
+
+/* output_budget_stats()
+ *
+ * prints what the run spent, if it had a budget.
+ */
+
+void output_budget_stats ( void )
+{
+     if ( time_limit <= 0.0 && node_limit <= 0.0 && stopped_by == NULL )
+          return;
+     oprintf ( OUT_SYS, 30, "\n------- budget -------\n" );
+     oprintf ( OUT_SYS, 30, "          time spent:      %.2f s\n", spent_time() );
+     oprintf ( OUT_SYS, 30, "    node evaluations:      %ld\n", nodes );
+     if ( stopped_by )
+          oprintf ( OUT_SYS, 30, "          stopped by:      %s\n", stopped_by );
+}
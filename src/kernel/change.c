@@ -38,6 +38,53 @@ operator operator_table[] =
   { "mutation",       operator_mutate_init },
   { NULL, NULL } };
 
+/* operator_name()
+ *
+ * the name of an operator type, for profiling output.
+ */
+
+static char *operator_name ( int op )
+{
+     switch ( op )
+     {
+        case OPERATOR_CROSSOVER:
+          return "breed.crossover";
+        case OPERATOR_REPRODUCE:
+          return "breed.reproduction";
+        case OPERATOR_MUTATE:
+          return "breed.mutation";
+     }
+     return "breed.other";
+}
+
+/* choose_phase()
+ *
+ * selects a breeding phase for the next offspring, either stochastically
+ * or not depending on the probabilistic_operators parameter.  done
+ * offspring out of size have been made so far.
+ */
+
+static int choose_phase ( breedphase *bp, double totalrate, int prob_oper,
+                         int done, int size )
+{
+     double r, r2;
+     int i;
+     
+     if ( prob_oper )
+          r = totalrate * random_double();
+     else
+          r = totalrate * ((double)done/(double)size);
+     r2 = bp[1].rate;
+     for ( i = 1; r2 < r; )
+          r2 += bp[++i].rate;
+
+#ifdef DEBUG
+     fprintf ( stderr, "picked %10.3lf; operator %d\n", r, i );
+#endif
+
+     return i;
+}
+
 /* change_population()
  *
  * breed the new population.
@@ -48,17 +95,36 @@ population *change_population ( population *oldpop, breedphase *bp )
      population *newpop;
      int i, j;
      int numphases;
+     int opeq, first;
      double totalrate = 0.0;
-     double r, r2;
      int prob_oper = atoi ( get_parameter ( "probabilistic_operators" ) );
+     uint64_t *phase_ns = NULL;
+     long *phase_calls = NULL;
+     uint64_t t, start = 0;
+     tree *tr;
+
+     /* allocate the new population.  a time budget may want it smaller
+	than the old one. */
+     newpop = allocate_population ( budget_pop_size ( oldpop->size ) );
 
-     /* allocate the new population. */
-     newpop = allocate_population ( oldpop->size );
+     /* operator equalisation may throw offspring away. */
+     opeq = bloat_opeq_begin ( oldpop, newpop->size );
 
      /* the first element of the breedphase table is a dummy -- its
 	operator field stores the number of phases. */
      numphases = bp[0].operator;
 
+     /* when profiling, the time spent in each phase is summed here and
+	handed to the profiler once at the end. */
+     if ( prof_enabled )
+     {
+          phase_ns = (uint64_t *)MALLOC ( (numphases+1) * sizeof ( uint64_t ) );
+          phase_calls = (long *)MALLOC ( (numphases+1) * sizeof ( long ) );
+          memset ( phase_ns, 0, (numphases+1) * sizeof ( uint64_t ) );
+          memset ( phase_calls, 0, (numphases+1) * sizeof ( long ) );
+          start = prof_now();
+     }
+
      /* call the start method for each phase. */
      for ( i = 1; i <= numphases; ++i )
      {
@@ -70,24 +136,42 @@ population *change_population ( population *oldpop, breedphase *bp )
      /* now fill the new population. */
      while ( newpop->next < newpop->size )
      {
-
-	  /** select an operator, either stochastically or not depending on
-	    the probabilistic_operators parameter. **/
-          if ( prob_oper )
-               r = totalrate * random_double();
-          else
-               r = totalrate * ((double)newpop->next/(double)newpop->size);
-
-          r2 = bp[1].rate;
-          for ( i = 1; r2 < r; )
-               r2 += bp[++i].rate;
-#ifdef DEBUG
-          fprintf ( stderr, "picked %10.3lf; operator %d\n", r, i );
-#endif
+          i = choose_phase ( bp, totalrate, prob_oper, newpop->next,
+                            newpop->size );
+          first = newpop->next;
 
 	  /* call the phase's method to do the operation. */
           if ( bp[i].operator_operate )
-               bp[i].operator_operate ( oldpop, newpop, bp[i].data );
+          {
+               if ( phase_ns )
+               {
+                    t = prof_now();
+                    bp[i].operator_operate ( oldpop, newpop, bp[i].data );
+                    phase_ns[i] += prof_now() - t;
+                    ++phase_calls[i];
+               }
+               else
+                    bp[i].operator_operate ( oldpop, newpop, bp[i].data );
+          }
+
+          if ( opeq )
+               bloat_opeq_filter ( newpop, first );
+     }
+     if ( opeq )
+          bloat_opeq_end();
+
+     if ( phase_ns )
+     {
+          /* the phases are interleaved, so they are laid end to end in
+	     the trace. */
+          for ( i = 1; i <= numphases; ++i )
+          {
+               prof_add ( prof_counter ( operator_name ( bp[i].operator ), 1 ),
+                         start, phase_ns[i], phase_calls[i] );
+               start += phase_ns[i];
+          }
+          FREE ( phase_ns );
+          FREE ( phase_calls );
      }
 
      /* call each phase's method to do cleanup. */
@@ -97,18 +181,227 @@ population *change_population ( population *oldpop, breedphase *bp )
                bp[i].operator_end ( bp[i].data );
      }
 
-     /* mark all the ERCs referenced in the new population. */
+     /* update the ERC reference counts.  rather than referencing every
+	tree in the new population and dereferencing every tree in the
+	old one, an unchanged copy is charged to the tree it was copied
+	from, and only the difference is applied to each old tree. */
+     for ( i = 0; i < oldpop->size; ++i )
+          for ( j = 0; j < tree_count; ++j )
+               oldpop->ind[i].tr[j].copies = 0;
+     
      for ( i = 0; i < newpop->size; ++i )
           for ( j = 0; j < tree_count; ++j )
-               reference_ephem_constants ( newpop->ind[i].tr[j].data, 1 );
+          {
+               tr = newpop->ind[i].tr+j;
+               if ( tr->copyof )
+                    ++tr->copyof->copies;
+               else
+                    reference_ephem_constants ( tr->data, 1 );
+          }
+
+     for ( i = 0; i < oldpop->size; ++i )
+          for ( j = 0; j < tree_count; ++j )
+               reference_ephem_constants ( oldpop->ind[i].tr[j].data,
+                                          oldpop->ind[i].tr[j].copies - 1 );
 
      /* free the old population. */
-     free_population ( oldpop );
+     release_population ( oldpop );
 
      return ( newpop );
      
 }
 
+/* move_in()
+ *
+ * moves an evaluated offspring into a slot of the population.  the
+ * offspring's trees must already hold their ERC references; the
+ * individual it replaces gives up its own.  the slot keeps its row of
+ * per-case errors, and the offspring's are copied into it.
+ */
+
+static void move_in ( population *pop, int victim, individual *k )
+{
+     individual *v = pop->ind+victim;
+     tree *tr;
+     void *errors;
+     int j;
+
+     for ( j = 0; j < tree_count; ++j )
+     {
+          reference_ephem_constants ( v->tr[j].data, -1 );
+          free_tree ( v->tr+j );
+          v->tr[j] = k->tr[j];
+          v->tr[j].copyof = NULL;
+          k->tr[j].data = NULL;
+     }
+     tr = v->tr;
+     errors = v->errors;
+     copy_case_errors ( v, k );
+     *v = *k;
+     v->tr = tr;
+     v->errors = errors;
+}
+
+/* replaced()
+ *
+ * tell the replacement context and the phases' contexts that a slot has
+ * a new individual.
+ */
+
+static void replaced ( sel_context *rsc, breedphase *bp, int victim )
+{
+     int i;
+
+     select_context_update ( rsc, victim );
+     for ( i = 1; i <= bp[0].operator; ++i )
+          if ( bp[i].operator_update )
+               bp[i].operator_update ( victim, bp[i].data );
+}
+
+/* take_finished()
+ *
+ * moves the offspring the evaluation threads have finished into their
+ * slots, waiting for them until at least room more can be queued.  only
+ * slots of the subpopulation being bred have live contexts to update;
+ * the others are rebuilt when their turn comes.
+ */
+
+static void take_finished ( multipop *mpop, int sub, sel_context *rsc,
+                           breedphase *bp, int room )
+{
+     async_job *job;
+
+     while ( ( job = async_collect ( async_room() < room ) ) != NULL )
+     {
+          move_in ( mpop->pop[job->sub], job->slot, &job->ind );
+          if ( job->sub == sub )
+               replaced ( rsc, bp, job->slot );
+          async_release ( job );
+     }
+}
+
+/* steady_state_population()
+ *
+ * breeds a subpopulation in place.  each offspring is evaluated as soon
+ * as it is made and then replaces an individual chosen by the
+ * steady_state.replace selection method; the phases' selection contexts
+ * are told about every replacement instead of being rebuilt.  one call
+ * makes as many offspring as the population has individuals, so that
+ * statistics, checkpoints and exchanges still come once per
+ * "generation".
+ *
+ * when evaluation threads are running, the offspring are handed to
+ * them instead, and move in whenever they are done -- possibly during
+ * a later call.  the slot an offspring will take is reserved when it is
+ * made, so that no two offspring in flight aim at the same one.
+ */
+
+void steady_state_population ( multipop *mpop, int sub )
+{
+     population *pop = mpop->pop[sub];
+     breedphase *bp = mpop->bpt[sub];
+     population *kids;
+     sel_context *rsc;
+     individual *k;
+     int i, j, n;
+     int born;
+     int victim;
+     int numphases;
+     int threads = async_running();
+     double mean;
+     double totalrate = 0.0;
+     int prob_oper = atoi ( get_parameter ( "probabilistic_operators" ) );
+     char *replace = get_parameter ( "steady_state.replace" );
+     uint64_t t;
+
+     if ( replace == NULL || !exists_select_method ( replace ) )
+          error ( E_FATAL_ERROR,
+                 "\"steady_state.replace\" is not a known selection method." );
+
+     /* the operators write their offspring here; no operator makes
+	more than two at a time. */
+     kids = allocate_population ( 2 );
+
+     numphases = bp[0].operator;
+     for ( i = 1; i <= numphases; ++i )
+     {
+          totalrate += bp[i].rate;
+          if ( bp[i].operator_start )
+               bp[i].operator_start ( pop, bp[i].data );
+     }
+     rsc = select_context_init ( replace, pop );
+     mean = bloat_tarpeian_begin ( pop );
+
+     /* the population is complete between offspring, so a preempted
+	run can stop here and checkpoint it. */
+     born = 0;
+     while ( born < pop->size && !budget_preempted() )
+     {
+	  /* make sure there is room in the queue for two more. */
+          if ( threads )
+               take_finished ( mpop, sub, rsc, bp, 2 );
+	  
+          i = choose_phase ( bp, totalrate, prob_oper, born, pop->size );
+          kids->next = 0;
+          if ( bp[i].operator_operate )
+               bp[i].operator_operate ( pop, kids, bp[i].data );
+
+          for ( n = 0; n < kids->next; ++n )
+          {
+               k = kids->ind+n;
+               victim = rsc->select_method ( rsc );
+               if ( threads )
+                    victim = async_free_slot ( sub, victim, pop->size );
+
+               for ( j = 0; j < tree_count; ++j )
+                    reference_ephem_constants ( k->tr[j].data, 1 );
+
+               population_No = victim;
+               if ( k->evald != EVAL_CACHE_VALID && !fitcache_fetch ( k ) &&
+                    !bloat_tarpeian ( k, mean ) )
+               {
+                    budget_charge ( k );
+                    if ( threads )
+                    {
+                         async_submit ( k, sub, victim );
+                         continue;
+                    }
+		    
+		    /* evaluate the offspring under the number of the slot
+		       it is going into. */
+                    if ( prof_enabled )
+                    {
+                         t = prof_now();
+                         app_eval_fitness ( k );
+                         prof_eval_sample ( prof_now() - t );
+                    }
+                    else
+                         app_eval_fitness ( k );
+                    fitcache_store ( k );
+               }
+
+               move_in ( pop, victim, k );
+               replaced ( rsc, bp, victim );
+          }
+
+          born += kids->next;
+     }
+
+     if ( threads )
+          take_finished ( mpop, sub, rsc, bp, 0 );
+     
+     rsc->context_method ( SELECT_CLEAN, rsc, NULL, NULL );
+     for ( i = 1; i <= numphases; ++i )
+     {
+          if ( bp[i].operator_end )
+               bp[i].operator_end ( bp[i].data );
+     }
+
+     /* the offspring have all been moved out, so there are no trees left
+	to free. */
+     release_population ( kids );
+}
+
 /* free_breeding()
  *
  * this frees the breedphase table for each subpopulation.
@@ -197,6 +490,7 @@ breedphase * initialize_one_breeding ( char *prefix )
      bp[0].operator_end = NULL;
      bp[0].operator_free = NULL;
      bp[0].operator_operate = NULL;
+     bp[0].operator_update = NULL;
 
      /* for each phase... */
      for ( i = 0; i < j; ++i )
@@ -205,6 +499,7 @@ breedphase * initialize_one_breeding ( char *prefix )
           bp[i+1].operator_end = NULL;
           bp[i+1].operator_free = NULL;
           bp[i+1].operator_operate = NULL;
+          bp[i+1].operator_update = NULL;
 
 	  /* get the operator string (name and options) */
           param = get_breed_parameter ( prefix, "breed[%d].operator", i+1 );
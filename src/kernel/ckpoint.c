@@ -27,6 +27,12 @@
 
 #include "lilgp.h"
 
+#ifdef MMAP_AVAILABLE
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
 #ifdef USEVFORK
 extern char **environ;
 #endif
@@ -42,6 +48,7 @@ void read_checkpoint ( char *filename, int *gen, multipop **mpop )
      FILE *f;
      char *buffer;
      ephem_const **eind;
+     int ecount;
      int random_state_bytes;
      int i, j;
      char *rand_state;
@@ -113,6 +120,8 @@ void read_checkpoint ( char *filename, int *gen, multipop **mpop )
 #endif
      /* read the parameter database. */
      read_parameter_database ( f );
+     /* the trees are stored however the checkpointed run stored them. */
+     ephem_configure();
 
      /* make internal copies of function set(s). */
      if ( app_build_function_sets() ) 
@@ -125,9 +134,10 @@ void read_checkpoint ( char *filename, int *gen, multipop **mpop )
 #endif
      
      /* read the list of ephemeral constants, and index them */
-     eind = read_ephem_list ( f );
+     eind = read_ephem_list ( f, &ecount );
 
-     /** skip the "section: erc" line. **/
+     /** read the population section line, which says whether the
+       population is stored as text or in binary. **/
      fgets ( buffer, MAXCHECKLINELENGTH, f );
 #ifdef DEBUG
      printf ( "should be population section: %s", buffer );
@@ -137,20 +147,25 @@ void read_checkpoint ( char *filename, int *gen, multipop **mpop )
 
      /* allocate memory. */
      *mpop = (multipop *)MALLOC ( sizeof ( multipop ) );
-     /* read number of subpops. */
-     fscanf ( f, "%*s %d\n", &((**mpop).size) );
-     /* allocate subpop list. */
-     (**mpop).pop = (population **)MALLOC ( (**mpop).size *
-                                           sizeof ( population * ) );
-     for ( i = 0; i < (**mpop).size; ++i )
+     if ( strcmp ( buffer, "section: population-binary\n" ) == 0 )
+          read_population_block ( *mpop, eind, ecount, f );
+     else
      {
-	  /** skip each "subpop: #" line. **/
-	  fgets ( buffer, MAXCHECKLINELENGTH, f );
+	  /* read number of subpops. */
+          fscanf ( f, "%*s %d\n", &((**mpop).size) );
+	  /* allocate subpop list. */
+          (**mpop).pop = (population **)MALLOC ( (**mpop).size *
+                                                sizeof ( population * ) );
+          for ( i = 0; i < (**mpop).size; ++i )
+          {
+	       /** skip each "subpop: #" line. **/
+               fgets ( buffer, MAXCHECKLINELENGTH, f );
 #ifdef DEBUG
-	  printf ( "should be subpop %d: %s", i, buffer );
+               printf ( "should be subpop %d: %s", i, buffer );
 #endif
-	  /* read the population. */
-          (**mpop).pop[i] = read_population ( eind, f );
+	       /* read the population. */
+               (**mpop).pop[i] = read_population ( eind, f );
+          }
      }
 
      /** skip the "section: application" line. **/
@@ -232,13 +247,23 @@ void write_checkpoint ( int gen, multipop *mpop, char *filename )
      fprintf ( f, "section: erc\n" );
      eind = write_ephem_list ( f );
 
-     /** write the population. **/
-     fprintf ( f, "section: population\n" );
-     fprintf ( f, "subpop-count: %d\n", mpop->size );
-     for ( i = 0; i < mpop->size; ++i )
+     /** write the population, as text or (with "checkpoint.format =
+       binary") as a block that restarts can read without parsing. **/
+     param = get_parameter ( "checkpoint.format" );
+     if ( param && strcmp ( param, "binary" ) == 0 )
      {
-	  fprintf ( f, "subpop: %d\n", i );
-          write_population ( mpop->pop[i], eind, f );
+          fprintf ( f, "section: population-binary\n" );
+          write_population_block ( mpop, eind, f );
+     }
+     else
+     {
+          fprintf ( f, "section: population\n" );
+          fprintf ( f, "subpop-count: %d\n", mpop->size );
+          for ( i = 0; i < mpop->size; ++i )
+          {
+               fprintf ( f, "subpop: %d\n", i );
+               write_population ( mpop->pop[i], eind, f );
+          }
      }
      
      /** application-specific data. **/
@@ -362,6 +387,7 @@ void read_individual ( individual *ind, ephem_const **eind, FILE *f,
 
      /* read the evald and flags fields. */
      fscanf ( f, "%d %d ", &(ind->evald), &(ind->flags) );
+     ind->errors = NULL;
      if ( ind->evald == EVAL_CACHE_VALID )
      {
 	  /** if the individual has valid fitness values saved in the
@@ -431,7 +457,7 @@ void read_tree_recurse ( int space, ephem_const **eind, FILE *fil, int tree,
 {
      function *f;
      int i, j;
-     ephem_const *ep;
+     lnode erc;
 
      /* read up until a nonwhitespace character in file.   the nonwhitespace
       character is saved in string[0]. */
@@ -459,11 +485,11 @@ void read_tree_recurse ( int space, ephem_const **eind, FILE *fil, int tree,
 #endif
 
      /* look up the function name in this tree's function set.  if the
-	function is an ERC terminal (the name is of the form "name:ERCindex"),
-	then place the ERC address in ep. */
-     f = get_function_by_name ( tree, string, &ep, eind );
+	function is an ERC terminal (the name is of the form "name:ERCindex"
+	or "name#hexvalue"), then place the ERC address or value in erc. */
+     f = get_function_by_name ( tree, string, &erc, eind );
      /* add an lnode to the tree. */
-     gensp_next(space)->f = f;
+     LNODE_SETF ( *gensp_next(space), f );
      
      switch ( f->type )
      {
@@ -472,8 +498,8 @@ void read_tree_recurse ( int space, ephem_const **eind, FILE *fil, int tree,
 	case EVAL_TERM:
 	  break;
 	case TERM_ERC:
-	  /* record the ERC address as the next lnode in the array. */
-	  gensp_next(space)->d = ep;
+	  /* record the ERC as the next lnode in the array. */
+	  *gensp_next(space) = erc;
 	  break;
 	case FUNC_DATA:
 	case EVAL_DATA:
@@ -502,15 +528,21 @@ void read_tree_recurse ( int space, ephem_const **eind, FILE *fil, int tree,
  *
  * looks up a function name in the function set for the given tree.  if
  * the function is an ERC, looks up the index (encoded in the name)
- * and stores the ERC address in ep.
+ * and stores the ERC address in erc, or decodes the inline value
+ * (also encoded in the name) into erc.
  */
 
-function * get_function_by_name ( int tree, char *string, ephem_const **ep,
+function * get_function_by_name ( int tree, char *string, lnode *erc,
 				 ephem_const **eind )
 {
      int i, j, k;
+#ifndef COMPACT_TREES
+     int c[2];
+     unsigned char *b;
+#endif
      function_set *fs = fset+tree_map[tree].fset;
 
+     j = -1;
      k = strlen ( string );
      for ( i = 0; i < k; ++i )
      {
@@ -518,10 +550,33 @@ function * get_function_by_name ( int tree, char *string, ephem_const **ep,
 	  {
 	       /* names of the form "name:index" are chopped at the colon,
 		  and the value of the index saved. */
+	       if ( ephem_inline )
+		    error ( E_FATAL_ERROR, "checkpoint has pooled ERCs, but inline_ercs is set." );
 	       string[i] = 0;
 	       j = atoi ( string+i+1 );
 	       break;
 	  }
+	  else if ( string[i] == '#' )
+	  {
+	       /* names of the form "name#hex" are chopped at the hash
+		  mark, and the hex digits decoded as the ERC's value. */
+	       if ( !ephem_inline )
+		    error ( E_FATAL_ERROR, "checkpoint has inline ERCs, but inline_ercs is not set." );
+	       string[i] = 0;
+#ifndef COMPACT_TREES
+	       b = (unsigned char *)&(erc->v);
+	       for ( j = 0; j < sizeof ( DATATYPE ); ++j )
+	       {
+		    c[0] = string[i+1+2*j];
+		    c[1] = string[i+2+2*j];
+		    c[0] = c[0]>'9' ? c[0]-'a'+10 : c[0]-'0';
+		    c[1] = c[1]>'9' ? c[1]-'a'+10 : c[1]-'0';
+		    b[j] = c[0] * 16 + c[1];
+	       }
+#endif
+	       j = -1;
+	       break;
+	  }
 	  else if ( string[i] == ')' )
 	  {
 	       /* chop the name at the first closing parenthesis, since we
@@ -537,10 +592,13 @@ function * get_function_by_name ( int tree, char *string, ephem_const **ep,
 	  {
 	       if ( fs->cset[i].type == TERM_ERC )
 	       {
-		    /* if this is an ERC, lookup the saved index in the
-		       eind table, and store the looked-up address in ep. */
-		    *ep = eind[j];
-		    (*ep)->f = fs->cset+i;
+		    /* if this is a pooled ERC, lookup the saved index in
+		       the eind table, and store the looked-up address. */
+		    if ( j >= 0 )
+		    {
+			 LNODE_SETD ( *erc, eind[j] );
+			 eind[j]->f = fs->cset+i;
+		    }
 	       }
 	       /* return a pointer to the function. */
 	       return fs->cset+i;
@@ -628,7 +686,7 @@ void write_tree_recurse ( lnode **l, ephem_index *eind, FILE *fil )
      int i;
 
      /* remember which function we are. */
-     f = (**l).f;
+     f = LNODE_F(**l);
 
      /* a space, then an open-paren if this function is not a terminal. */
      fputc ( ' ', fil );
@@ -638,9 +696,18 @@ void write_tree_recurse ( lnode **l, ephem_index *eind, FILE *fil )
      ++*l;
      if ( f->type == TERM_ERC )
      {
-	  /* ERCs printed as "name:index". */
-	  fprintf ( fil, "%s:%d", f->string,
-		   lookup_ephem ( eind, (**l).d ) );
+	  /* ERCs printed as "name:index", or "name#hexvalue" if they are
+	     stored inline. */
+#ifndef COMPACT_TREES
+	  if ( ephem_inline )
+	  {
+	       fprintf ( fil, "%s#", f->string );
+	       write_hex_block ( &((**l).v), sizeof ( DATATYPE ), fil );
+	  }
+	  else
+#endif
+	       fprintf ( fil, "%s:%d", f->string,
+			lookup_ephem ( eind, LNODE_D(**l) ) );
           ++*l;
      }
      else
@@ -670,6 +737,298 @@ void write_tree_recurse ( lnode **l, ephem_index *eind, FILE *fil )
           fprintf ( fil, ")" );
 }
 
+/* encode_tree_recurse()
+ *
+ * stores a tree as the words of the binary population section (see
+ * ckpop_individual in types.h), returning the next free word.
+ */
+
+static int64_t *encode_tree_recurse ( lnode **l, int64_t *w, ephem_index *eind )
+{
+     function *f;
+     int i;
+
+     f = LNODE_F(**l);
+     *(w++) = f->id;
+     ++*l;
+     
+     switch ( f->type )
+     {
+        case TERM_ERC:
+#ifndef COMPACT_TREES
+          if ( ephem_inline )
+          {
+               *w = 0;
+               memcpy ( w, &((**l).v), sizeof ( DATATYPE ) );
+          }
+          else
+#endif
+               *w = lookup_ephem ( eind, LNODE_D(**l) );
+          ++w;
+          ++*l;
+          break;
+        case FUNC_DATA:
+        case EVAL_DATA:
+          for ( i = 0; i < f->arity; ++i )
+               w = encode_tree_recurse ( l, w, eind );
+          break;
+        case FUNC_EXPR:
+        case EVAL_EXPR:
+          for ( i = 0; i < f->arity; ++i )
+          {
+               *(w++) = -1 - (**l).s;
+               ++*l;
+               w = encode_tree_recurse ( l, w, eind );
+          }
+          break;
+     }
+
+     return w;
+}
+
+/* write_population_block()
+ *
+ * writes every subpopulation to a checkpoint file as one binary block.
+ * the block starts at a multiple of 8 bytes into the file, so it can be
+ * used in place once the file is mapped.
+ */
+
+void write_population_block ( multipop *mpop, ephem_index *eind, FILE *f )
+{
+     ckpop_header h;
+     ckpop_individual ci;
+     ckpop_tree ct;
+     individual *ind;
+     int32_t sn[2];
+     int64_t *words = NULL;
+     int wordsize = 0;
+     lnode *l;
+     int64_t bytes;
+     int i, j, k;
+
+     /* the size of the block, which goes ahead of it. */
+     bytes = sizeof ( ckpop_header );
+     for ( i = 0; i < mpop->size; ++i )
+     {
+          bytes += sizeof ( sn ) + mpop->pop[i]->size *
+               ( sizeof ( ckpop_individual ) + tree_count * sizeof ( ckpop_tree ) );
+          for ( k = 0; k < mpop->pop[i]->size; ++k )
+               for ( j = 0; j < tree_count; ++j )
+                    bytes += mpop->pop[i]->ind[k].tr[j].size * sizeof ( int64_t );
+     }
+     fprintf ( f, "binary-bytes: %ld\n", (long)bytes );
+     while ( ftell ( f ) % 8 )
+          fputc ( '\n', f );
+
+     memset ( &h, 0, sizeof ( h ) );
+     memcpy ( h.magic, CK_POPMAGIC, 8 );
+     h.functions = function_table_size;
+     h.trees = tree_count;
+     h.subpops = mpop->size;
+     h.bytes = bytes;
+     fwrite ( &h, sizeof ( h ), 1, f );
+
+     memset ( &ci, 0, sizeof ( ci ) );
+     memset ( &ct, 0, sizeof ( ct ) );
+     for ( i = 0; i < mpop->size; ++i )
+     {
+          sn[0] = mpop->pop[i]->size;
+          sn[1] = mpop->pop[i]->next;
+          fwrite ( sn, sizeof ( sn ), 1, f );
+          for ( k = 0; k < mpop->pop[i]->size; ++k )
+          {
+               ind = mpop->pop[i]->ind+k;
+               ci.evald = ind->evald;
+               ci.flags = ind->flags;
+               ci.hits = ind->hits;
+               ci.r_fitness = ind->r_fitness;
+               ci.s_fitness = ind->s_fitness;
+               ci.a_fitness = ind->a_fitness;
+               fwrite ( &ci, sizeof ( ci ), 1, f );
+
+               for ( j = 0; j < tree_count; ++j )
+               {
+                    ct.size = ind->tr[j].size;
+                    ct.nodes = ind->tr[j].nodes;
+                    ct.depth = ind->tr[j].depth;
+                    ct.internal = ind->tr[j].internal;
+                    ct.external = ind->tr[j].external;
+                    fwrite ( &ct, sizeof ( ct ), 1, f );
+
+                    if ( ct.size > wordsize )
+                    {
+                         wordsize = ct.size * 2;
+                         words = (int64_t *)REALLOC ( words, wordsize * sizeof ( int64_t ) );
+                    }
+                    l = ind->tr[j].data;
+                    encode_tree_recurse ( &l, words, eind );
+                    fwrite ( words, sizeof ( int64_t ), ct.size, f );
+               }
+          }
+     }
+
+     if ( words )
+          FREE ( words );
+}
+
+/* decode_tree()
+ *
+ * the inverse of encode_tree_recurse().  the words say what each lnode
+ * is, so no walk of the tree is needed.  ecount is the number of ERCs
+ * in eind.
+ */
+
+static void decode_tree ( tree *t, ckpop_tree *ct, int64_t *w,
+                         ephem_const **eind, int ecount )
+{
+     function *f;
+     int i;
+
+     t->size = ct->size;
+     t->nodes = ct->nodes;
+     t->depth = ct->depth;
+     t->internal = ct->internal;
+     t->external = ct->external;
+     t->copyof = NULL;
+     t->copies = 0;
+     t->data = (lnode *)MALLOC ( t->size * sizeof ( lnode ) );
+     
+     for ( i = 0; i < t->size; ++i )
+     {
+          if ( w[i] < 0 )
+          {
+               t->data[i].s = -1 - w[i];
+               continue;
+          }
+          if ( w[i] >= function_table_size )
+               error ( E_FATAL_ERROR, "checkpoint file corrupted in population section." );
+          f = function_table[w[i]];
+          LNODE_SETF ( t->data[i], f );
+          if ( f->type == TERM_ERC )
+          {
+               if ( ++i >= t->size )
+                    error ( E_FATAL_ERROR, "checkpoint file corrupted in population section." );
+#ifndef COMPACT_TREES
+               if ( ephem_inline )
+                    memcpy ( &(t->data[i].v), w+i, sizeof ( DATATYPE ) );
+               else
+#endif
+               {
+                    if ( w[i] < 0 || w[i] >= ecount )
+                         error ( E_FATAL_ERROR, "checkpoint file corrupted in population section." );
+                    LNODE_SETD ( t->data[i], eind[w[i]] );
+                    eind[w[i]]->f = f;
+               }
+          }
+     }
+}
+
+/* read_population_block()
+ *
+ * reads the subpopulations written by write_population_block().  the
+ * file is mapped rather than read where mmap() is available.
+ */
+
+void read_population_block ( multipop *mpop, ephem_const **eind,
+                            int ecount, FILE *f )
+{
+     char buffer[MAXCHECKLINELENGTH];
+     ckpop_header *h;
+     ckpop_individual *ci;
+     ckpop_tree *ct;
+     population *pop;
+     individual *ind;
+     int32_t *sn;
+     char *base = NULL, *p;
+     long off, bytes = 0;
+     int mapped = 0;
+     int i, j, k;
+#ifdef MMAP_AVAILABLE
+     struct stat st;
+#endif
+
+     fgets ( buffer, MAXCHECKLINELENGTH, f );
+     sscanf ( buffer, "%*s %ld", &bytes );
+     off = ( ftell ( f ) + 7 ) & ~7L;
+     if ( bytes < (long)sizeof ( ckpop_header ) )
+          error ( E_FATAL_ERROR, "checkpoint file corrupted in population section." );
+
+#ifdef MMAP_AVAILABLE
+     if ( fstat ( fileno ( f ), &st ) == 0 && st.st_size >= off + bytes )
+     {
+          base = (char *)mmap ( NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+                               fileno ( f ), 0 );
+          if ( base == (char *)MAP_FAILED )
+               base = NULL;
+          else
+          {
+               mapped = 1;
+               p = base + off;
+          }
+     }
+#endif
+     if ( base == NULL )
+     {
+          base = p = (char *)MALLOC ( bytes );
+          fseek ( f, off, SEEK_SET );
+          if ( fread ( base, 1, bytes, f ) != bytes )
+               error ( E_FATAL_ERROR, "checkpoint file is truncated." );
+     }
+
+     h = (ckpop_header *)p;
+     if ( memcmp ( h->magic, CK_POPMAGIC, 8 ) || h->bytes != bytes ||
+          h->trees != tree_count )
+          error ( E_FATAL_ERROR, "checkpoint file corrupted in population section." );
+     if ( h->functions != function_table_size )
+          error ( E_FATAL_ERROR, "checkpoint was written with different function sets." );
+     p += sizeof ( ckpop_header );
+
+     mpop->size = h->subpops;
+     mpop->pop = (population **)MALLOC ( mpop->size * sizeof ( population * ) );
+     for ( i = 0; i < mpop->size; ++i )
+     {
+          sn = (int32_t *)p;
+          p += 2 * sizeof ( int32_t );
+          pop = (population *)MALLOC ( sizeof ( population ) );
+          pop->size = sn[0];
+          pop->next = sn[1];
+          pop->ind = (individual *)MALLOC ( pop->size * sizeof ( individual ) );
+          for ( k = 0; k < pop->size; ++k )
+          {
+               ci = (ckpop_individual *)p;
+               p += sizeof ( ckpop_individual );
+               ind = pop->ind+k;
+               ind->evald = ci->evald;
+               ind->flags = ci->flags;
+               ind->hits = ci->hits;
+               ind->r_fitness = ci->r_fitness;
+               ind->s_fitness = ci->s_fitness;
+               ind->a_fitness = ci->a_fitness;
+               ind->errors = NULL;
+
+               ind->tr = (tree *)MALLOC ( tree_count * sizeof ( tree ) );
+               for ( j = 0; j < tree_count; ++j )
+               {
+                    ct = (ckpop_tree *)p;
+                    p += sizeof ( ckpop_tree );
+                    decode_tree ( ind->tr+j, ct, (int64_t *)p, eind, ecount );
+                    p += ct->size * sizeof ( int64_t );
+               }
+          }
+          mpop->pop[i] = pop;
+     }
+
+#ifdef MMAP_AVAILABLE
+     if ( mapped )
+          munmap ( base, st.st_size );
+     else
+#endif
+          FREE ( base );
+     
+     /* carry on with the text after the block. */
+     fseek ( f, off + bytes, SEEK_SET );
+}
+
 /* write_hex_block()
  *
  * writes a block of memory to a file, as a string of hex characters.
@@ -30,6 +30,8 @@
 typedef struct
 {
      int keep_trying;
+     int fair;           /* BLOAT_FAIR_*:  how the second point is
+			    chosen. */
      double internal;
      double external;
      double *tree;       /* probability that a given tree
@@ -69,9 +71,11 @@ int operator_crossover_init ( char *options, breedphase *bp )
      bp->operator_start = operator_crossover_start;
      bp->operator_end = operator_crossover_end;
      bp->operator_operate = operator_crossover;
+     bp->operator_update = operator_crossover_update;
 
      /* default values for all the crossover options. */
      cd->keep_trying = 0;
+     cd->fair = BLOAT_FAIR_NONE;
      cd->internal = 0.9;
      cd->external = 0.1;
      cd->tree = (double *)MALLOC ( tree_count * sizeof ( double ) );
@@ -102,6 +106,23 @@ int operator_crossover_init ( char *options, breedphase *bp )
                            argv[i] );
                }
           }
+	  /* parse "fair" option. */
+          else if ( strcmp ( "fair", argv[i] ) == 0 )
+          {
+               ++i;
+               if ( strcmp ( argv[i], "none" ) == 0 )
+                    cd->fair = BLOAT_FAIR_NONE;
+               else if ( strcmp ( argv[i], "size" ) == 0 )
+                    cd->fair = BLOAT_FAIR_SIZE;
+               else if ( strcmp ( argv[i], "homologous" ) == 0 )
+                    cd->fair = BLOAT_FAIR_HOMOLOGOUS;
+               else
+               {
+                    ++errors;
+                    error ( E_ERROR, "crossover: \"%s\" is not a valid setting for \"fair\".",
+                           argv[i] );
+               }
+          }
 	  /* parse "internal" option. */
           else if ( strcmp ( "internal", argv[i] ) == 0 )
           {
@@ -295,20 +316,17 @@ void operator_crossover_free ( void *data )
 void operator_crossover_start ( population *oldpop, void *data )
 {
      crossover_data * cd;
-     select_context_func_ptr select_con;
 
      cd = (crossover_data *)data;
      
-     select_con = get_select_context ( cd->sname );
-     cd->sc = select_con ( SELECT_INIT, NULL, oldpop, cd->sname );
+     cd->sc = select_context_init ( cd->sname, oldpop );
 
      /* if there is a separate selection method specified for the
 	second parent... */
      if ( cd->sname2 != cd->sname )
      {
 	  /* ...then initialize it too. */
-          select_con = get_select_context ( cd->sname2 );
-          cd->sc2 = select_con ( SELECT_INIT, NULL, oldpop, cd->sname2 );
+          cd->sc2 = select_context_init ( cd->sname2, oldpop );
      }
      else
 	  /* ...otherwise use the first context. */
@@ -332,6 +350,23 @@ void operator_crossover_end ( void *data )
           cd->sc2->context_method ( SELECT_CLEAN, cd->sc2, NULL, NULL );
 }
 
+/* operator_crossover_update()
+ *
+ * passes the replacement of an individual on to this phase's selection
+ * contexts.
+ */
+
+void operator_crossover_update ( int index, void *data )
+{
+     crossover_data * cd;
+
+     cd = (crossover_data *)data;
+
+     select_context_update ( cd->sc, index );
+     if ( cd->sname != cd->sname2 )
+          select_context_update ( cd->sc2, index );
+}
+
 /* operator_crossover()
  *
  * performs the crossover, inserting one or both offspring into the
@@ -419,17 +454,25 @@ void operator_crossover ( population *oldpop, population *newpop,
           else if ( total*random_double() < cd->internal )
           {
 	       /* choose an internal point. */
-               l1 = random_int ( tree_nodes_internal (oldpop->ind[p1].tr[t1].data) );
+               l1 = random_int ( oldpop->ind[p1].tr[t1].internal );
                st[1] = get_subtree_internal ( oldpop->ind[p1].tr[t1].data, l1 );
           }
           else
           {
 	       /* choose an external point. */
-               l1 = random_int ( tree_nodes_external (oldpop->ind[p1].tr[t1].data) );
+               l1 = random_int ( oldpop->ind[p1].tr[t1].external );
                st[1] = get_subtree_external ( oldpop->ind[p1].tr[t1].data, l1 );
           }
                                 
-          if ( forceany2 )
+          if ( cd->fair )
+          {
+	       /* choose a point on the second parent to fit the
+		  first. */
+               st[2] = bloat_fair_subtree ( oldpop->ind[p2].tr[t2].data, ps2,
+                                           oldpop->ind[p1].tr[t1].data,
+                                           st[1], cd->fair );
+          }
+          else if ( forceany2 )
           {
 	       /* choose any point on second parent. */
                l2 = random_int ( ps2 );
@@ -438,13 +481,13 @@ void operator_crossover ( population *oldpop, population *newpop,
           else if ( total*random_double() < cd->internal )
           {
 	       /* choose internal point. */
-               l2 = random_int ( tree_nodes_internal (oldpop->ind[p2].tr[t2].data) );
+               l2 = random_int ( oldpop->ind[p2].tr[t2].internal );
                st[2] = get_subtree_internal ( oldpop->ind[p2].tr[t2].data, l2 );
           }
           else
           {
 	       /* choose external point. */
-               l2 = random_int ( tree_nodes_external (oldpop->ind[p2].tr[t2].data) );
+               l2 = random_int ( oldpop->ind[p2].tr[t2].external );
                st[2] = get_subtree_external ( oldpop->ind[p2].tr[t2].data, l2 );
           }
 
@@ -0,0 +1,389 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+
+#include "lilgp.h"
+
+/* shared-subexpression evaluation.
+ *
+ * with eval.engine = dag, the trees of all the individuals awaiting
+ * evaluation are hash-consed into one DAG:  every distinct subexpression
+ * in the population becomes one node, however many trees contain it.
+ * the fitness cases are then run through the DAG a block at a time --
+ * each node computes its values for the whole block once, from its
+ * children's values -- and each individual is scored from its root
+ * node's values.  on a converged population, most of the work of
+ * evaluating the population is shared.
+ *
+ * the nodes are created children-first, so evaluating them in creation
+ * order is a valid schedule.
+ *
+ * this needs the fitness cases registered with register_caseset(), and
+ * the app's case scoring functions.  an individual whose tree is not
+ * made purely of primitives, ERCs and input terminals (see prim in the
+ * function table), or that has more than one tree, is evaluated with
+ * app_eval_fitness() instead.  trees are simplified first if "simplify"
+ * is on.
+ */
+
+static dagnode *nodes = NULL;
+static int node_count;
+static int node_size = 0;
+
+/* open-addressed hash table of node indices; -1 is empty. */
+static int *table = NULL;
+static int table_size = 0;
+
+static DATATYPE *values = NULL;
+static size_t values_size = 0;
+
+static long dag_trees = 0;
+static long dag_lnodes = 0;
+static long dag_nodes = 0;
+
+/* hash_node()
+ *
+ * hashes a node's function, children, and (for constants) value.
+ */
+
+static unsigned int hash_node ( dagnode *n )
+{
+     uint64_t h = (uint64_t)(uintptr_t)n->f * 0x9e3779b97f4a7c15ULL;
+     uint64_t bits;
+     int i;
+
+     if ( n->f->type == TERM_ERC )
+     {
+          memcpy ( &bits, &(n->value), sizeof ( bits ) );
+          h ^= bits + 0x9e3779b97f4a7c15ULL + ( h << 6 ) + ( h >> 2 );
+     }
+     else
+          for ( i = 0; i < n->f->arity; ++i )
+               h ^= (uint64_t)n->child[i] + 0x9e3779b97f4a7c15ULL +
+                    ( h << 6 ) + ( h >> 2 );
+     return (unsigned int)( h ^ ( h >> 32 ) );
+}
+
+/* same_node()
+ *
+ * compares two nodes.  constants are the same if their bits are.
+ */
+
+static int same_node ( dagnode *a, dagnode *b )
+{
+     int i;
+
+     if ( a->hash != b->hash )
+          return 0;
+     if ( a->f->type == TERM_ERC || b->f->type == TERM_ERC )
+          return a->f->type == b->f->type &&
+               memcmp ( &(a->value), &(b->value), sizeof ( DATATYPE ) ) == 0;
+     if ( a->f != b->f )
+          return 0;
+     for ( i = 0; i < a->f->arity; ++i )
+          if ( a->child[i] != b->child[i] )
+               return 0;
+     return 1;
+}
+
+/* grow_table()
+ *
+ * doubles the hash table and reinserts every node.
+ */
+
+static void grow_table ( void )
+{
+     int i, j;
+
+     table_size = table_size ? table_size * 2 : DAG_HASHSTART;
+     table = (int *)REALLOC ( table, table_size * sizeof ( int ) );
+     for ( i = 0; i < table_size; ++i )
+          table[i] = -1;
+     for ( i = 0; i < node_count; ++i )
+     {
+          for ( j = nodes[i].hash & ( table_size - 1 ); table[j] != -1;
+               j = ( j + 1 ) & ( table_size - 1 ) );
+          table[j] = i;
+     }
+}
+
+/* intern()
+ *
+ * returns the index of the node equal to n, adding it if necessary.
+ */
+
+static int intern ( dagnode *n )
+{
+     int j;
+
+     n->hash = hash_node ( n );
+     for ( j = n->hash & ( table_size - 1 ); table[j] != -1;
+          j = ( j + 1 ) & ( table_size - 1 ) )
+          if ( same_node ( nodes+table[j], n ) )
+               return table[j];
+
+     if ( node_count == node_size )
+     {
+          node_size = node_size ? node_size * 2 : DAG_HASHSTART;
+          nodes = (dagnode *)REALLOC ( nodes, node_size * sizeof ( dagnode ) );
+     }
+     nodes[node_count] = *n;
+     table[j] = node_count;
+     
+     /* keep the table at most half full. */
+     if ( ++node_count * 2 > table_size )
+          grow_table();
+     
+     return node_count-1;
+}
+
+/* intern_recurse()
+ *
+ * adds the subtree at *l to the DAG, returning its node index, or -1 if
+ * the subtree contains anything the DAG can't evaluate.
+ */
+
+static int intern_recurse ( lnode **l )
+{
+     function *f = LNODE_F(**l);
+     dagnode n;
+     int i;
+
+     ++*l;
+     memset ( &n, 0, sizeof ( n ) );
+     n.f = f;
+
+     switch ( f->type )
+     {
+        case TERM_ERC:
+          n.value = ERC_VALUE(**l);
+          ++*l;
+          break;
+        case TERM_NORM:
+          if ( f->prim != PRIM_INPUT || f->input >= cases.inputs )
+               return -1;
+          break;
+        case FUNC_DATA:
+          if ( f->prim == PRIM_NONE )
+               return -1;
+          for ( i = 0; i < f->arity; ++i )
+               if ( ( n.child[i] = intern_recurse ( l ) ) == -1 )
+                    return -1;
+          break;
+        default:
+          return -1;
+     }
+
+     return intern ( &n );
+}
+
+/* free_dag()
+ *
+ * frees the DAG's storage.
+ */
+
+void free_dag ( void )
+{
+     if ( nodes )
+          FREE ( nodes );
+     if ( table )
+          FREE ( table );
+     if ( values )
+          FREE ( values );
+     nodes = NULL;
+     table = NULL;
+     values = NULL;
+     node_size = table_size = 0;
+     values_size = 0;
+}
+
+/* output_dag_stats()
+ *
+ * print how much sharing the DAG found, at the end of the run.
+ */
+
+void output_dag_stats ( void )
+{
+     if ( eval_engine != EVAL_ENGINE_DAG )
+          return;
+     oprintf ( OUT_SYS, 30, "\n------- dag evaluation -------\n" );
+     oprintf ( OUT_SYS, 30, "               trees:      %ld\n", dag_trees );
+     oprintf ( OUT_SYS, 30, "        lnodes input:      %ld\n", dag_lnodes );
+     oprintf ( OUT_SYS, 30, "      distinct nodes:      %ld\n", dag_nodes );
+}
+
+/* evaluate_block()
+ *
+ * computes every node's values for cases c0 .. c0+b-1.  node i's values
+ * are at values+i*b.
+ */
+
+static void evaluate_block ( int c0, int b )
+{
+     int i, j, k;
+     dagnode *n;
+     DATATYPE *v, *x, *y;
+     farg args[MAXARGS];
+
+     for ( i = 0; i < node_count; ++i )
+     {
+          n = nodes+i;
+          v = values + (size_t)i * b;
+          
+          switch ( n->f->type )
+          {
+             case TERM_ERC:
+               for ( j = 0; j < b; ++j )
+                    v[j] = n->value;
+               continue;
+             case TERM_NORM:
+               memcpy ( v, cases.input[n->f->input]+c0, b * sizeof ( DATATYPE ) );
+               continue;
+          }
+
+          x = values + (size_t)n->child[0] * b;
+          y = values + (size_t)n->child[1] * b;
+          switch ( n->f->prim )
+          {
+             case PRIM_ADD:
+               for ( j = 0; j < b; ++j )
+                    v[j] = x[j] + y[j];
+               break;
+             case PRIM_SUB:
+               for ( j = 0; j < b; ++j )
+                    v[j] = x[j] - y[j];
+               break;
+             case PRIM_MUL:
+               for ( j = 0; j < b; ++j )
+                    v[j] = x[j] * y[j];
+               break;
+             case PRIM_PDIV:
+               for ( j = 0; j < b; ++j )
+                    v[j] = ( y[j] == 0.0 ) ? 1.0 : x[j] / y[j];
+               break;
+             default:
+               /* other primitives are called case by case. */
+               for ( j = 0; j < b; ++j )
+               {
+                    for ( k = 0; k < n->f->arity; ++k )
+                         args[k].d = values[(size_t)n->child[k] * b + j];
+                    v[j] = (n->f->code)(0, args);
+               }
+               break;
+          }
+     }
+}
+
+/* dag_evaluate_pop()
+ *
+ * evaluates the individuals of a population that need it.
+ */
+
+void dag_evaluate_pop ( population *pop )
+{
+     int *root;
+     int i, k, c0, b;
+     lnode *l;
+     size_t need;
+
+     root = (int *)MALLOC ( pop->size * sizeof ( int ) );
+     
+     /* build the DAG. */
+     node_count = 0;
+     if ( table == NULL )
+          grow_table();
+     for ( i = 0; i < table_size; ++i )
+          table[i] = -1;
+     
+     for ( k = 0; k < pop->size; ++k )
+     {
+          root[k] = -1;
+          if ( pop->ind[k].evald == EVAL_CACHE_VALID || tree_count != 1 )
+               continue;
+          l = simplify_tree ( pop->ind[k].tr[0].data, 0 );
+          dag_lnodes += tree_size ( l );
+          root[k] = intern_recurse ( &l );
+          if ( root[k] != -1 )
+               ++dag_trees;
+     }
+     dag_nodes += node_count;
+
+     if ( node_count > 0 )
+     {
+	  /* choose a block size that keeps the node values within
+	     DAG_MEMORY bytes. */
+          b = DAG_MEMORY / ( node_count * sizeof ( DATATYPE ) );
+          if ( b > cases.cases )
+               b = cases.cases;
+          if ( b < 1 )
+               b = 1;
+          need = (size_t)node_count * b;
+          if ( need > values_size )
+          {
+               values_size = need;
+               values = (DATATYPE *)REALLOC ( values,
+                                             values_size * sizeof ( DATATYPE ) );
+          }
+          
+          for ( k = 0; k < pop->size; ++k )
+               if ( root[k] != -1 )
+               {
+                    population_No = k;
+                    app_begin_cases ( pop->ind+k );
+               }
+
+          for ( c0 = 0; c0 < cases.cases; c0 += b )
+          {
+               if ( c0 + b > cases.cases )
+                    b = cases.cases - c0;
+               evaluate_block ( c0, b );
+               for ( k = 0; k < pop->size; ++k )
+                    if ( root[k] != -1 )
+                    {
+                         population_No = k;
+                         for ( i = 0; i < b; ++i )
+                              app_score_case ( pop->ind+k, c0+i,
+                                              values[(size_t)root[k]*b+i] );
+                    }
+          }
+     }
+
+     /* finish the individuals in order, evaluating the ones the DAG
+	couldn't handle as we go. */
+     for ( k = 0; k < pop->size; ++k )
+     {
+          if ( pop->ind[k].evald == EVAL_CACHE_VALID )
+               continue;
+          population_No = k;
+          if ( root[k] != -1 )
+               app_end_cases ( pop->ind+k );
+          else
+               app_eval_fitness ( pop->ind+k );
+     }
+
+     FREE ( root );
+}
@@ -39,10 +39,54 @@
    1 as the default random seed. */
 /*#define RANDOMSEEDTIME*/
 
+/* define this to store each tree node in a 32-bit word -- a function,
+   skip or ERC index -- instead of a pointer.  halves tree memory on
+   64-bit machines.  ERCs can't be stored inline in this mode. */
+/*#define COMPACT_TREES*/
+
+/* evaluation threads (see async.c) need POSIX threads and per-thread
+   variables.  THREAD_LOCAL marks the evaluation state each thread keeps
+   for itself; ATOMIC_ADD is for counters bumped from several threads.
+   ATOMIC_CAS and MEMORY_BARRIER are for memory shared with other
+   processes (the fitness cache), which also needs mmap().  binary
+   checkpoints are mapped with mmap() where it is available. */
+#if defined(__GNUC__) && !defined(_WIN32)
+#define THREADS_AVAILABLE
+#define FITCACHE_AVAILABLE
+#define MMAP_AVAILABLE
+#define THREAD_LOCAL          __thread
+#define ATOMIC_ADD(v,n)       __sync_add_and_fetch ( &(v), (n) )
+#define ATOMIC_CAS(v,o,n)     __sync_bool_compare_and_swap ( &(v), (o), (n) )
+#define MEMORY_BARRIER()      __sync_synchronize()
+#else
+#define THREAD_LOCAL
+#define ATOMIC_ADD(v,n)       ( (v) += (n) )
+#define ATOMIC_CAS(v,o,n)     ( (v) == (o) ? ( (v) = (n), 1 ) : 0 )
+#define MEMORY_BARRIER()
+#endif
+
 #define EXTRAMEM              8
-#define EPHEM_METABLOCKSIZE   10
-#define EPHEM_STARTSIZE       1000
-#define EPHEM_GROWSIZE        500
+#define EPHEM_CHUNKSHIFT      10
+#define EPHEM_CHUNKSIZE       (1<<EPHEM_CHUNKSHIFT)
+#define EPHEM_CHUNKLISTGROW   16
+
+/* access to the contents of an lnode:  the function, or the ERC that
+   follows an ERC's function. */
+#ifdef COMPACT_TREES
+#define LNODE_F(n)            ( function_table[(n).w] )
+#define LNODE_SETF(n,fp)      ( (n).w = (fp)->id )
+#define LNODE_D(n)            ( ephem_chunks[(n).w>>EPHEM_CHUNKSHIFT] + \
+                                ( (n).w & ( EPHEM_CHUNKSIZE - 1 ) ) )
+#define LNODE_SETD(n,e)       ( (n).w = (e)->index )
+#define ERC_VALUE(l)          ( LNODE_D(l)->d )
+#else
+#define LNODE_F(n)            ( (n).f )
+#define LNODE_SETF(n,fp)      ( (n).f = (fp) )
+#define LNODE_D(n)            ( (n).d )
+#define LNODE_SETD(n,e)       ( (n).d = (e) )
+/* the value of the ERC in lnode l, which follows the ERC's function. */
+#define ERC_VALUE(l)          ( ephem_inline ? (l).v : (l).d->d )
+#endif
 
 #define MAXPARAMLINELENGTH    255
 #define MAXCHECKLINELENGTH    255
@@ -64,6 +108,7 @@
 #define EVAL_CACHE_VALID     0
 
 #define SELECT_INIT    1
+#define SELECT_UPDATE  2
 #define SELECT_CLEAN   3
 
 #define GENERATE_FULL           1
@@ -93,13 +138,87 @@
 #define OUT_USER   6
 #define OUT_ERROR  7
 
+/* the optional generation record streams.  these use negative ids so
+   they can never collide with application streams (OUT_USER+n). */
+#define OUT_REC    -1
+#define OUT_JSL    -2
+#define OUT_TRC    -3
+
 #define PARAM_COPY_NONE   0
 #define PARAM_COPY_NAME   1
 #define PARAM_COPY_VALUE  2
 
 #define MAXMESSAGELENGTH 4096
 #define MAXOUTPUTSTREAMS 25
-#define SYSOUTPUTSTREAMS 6
+#define SYSOUTPUTSTREAMS 9
+
+#define RECORD_NONE      0
+#define RECORD_BINARY    1
+#define RECORD_JSON      2
+
+#define RECORD_MAGIC     "lgprec01"
+#define RECORD_VERSION   1
+
+/* the fixed profiling counters.  others (per-operator, per-selection
+   method) are registered by name as they are first used. */
+#define PROF_EVAL         0
+#define PROF_BREED        1
+#define PROF_EXCHANGE     2
+#define PROF_STATS        3
+#define PROF_CHECKPOINT   4
+#define PROF_ERCGC        5
+#define PROF_FIXED        6
+
+#define PROF_MAXCOUNTERS  64
+#define PROF_HISTBUCKETS  48
+#define PROF_NAMELENGTH   40
+
+/* what a function computes, for the jit and the simplifier.  the jit
+   emits ADD through EXP inline, and calls anything else through its code
+   pointer.  PRIM_NONE marks a function that may not be a pure function
+   of its arguments. */
+#define PRIM_NONE         0
+#define PRIM_ADD          1
+#define PRIM_SUB          2
+#define PRIM_MUL          3
+#define PRIM_PDIV         4
+#define PRIM_SIN          5
+#define PRIM_COS          6
+#define PRIM_EXP          7
+#define PRIM_INPUT        8
+#define PRIM_RLOG         9
+
+#define JIT_MINCASES      1000
+
+#define SIMPLIFY_STARTSIZE 256
+
+/* frames kept on the C stack by the iterative tree walkers before they
+   spill to the heap. */
+#define WALK_STACKSIZE    64
+
+/* evaluation engines, selected by eval.engine. */
+#define EVAL_ENGINE_TREE  0
+#define EVAL_ENGINE_DAG   1
+#define EVAL_ENGINE_TILED 2
+#define EVAL_ENGINE_STREAM 3
+
+#define DAG_HASHSTART     1024
+#define DAG_MEMORY        (16*1024*1024)
+
+/* defaults for the tiled engine:  cases per block, and program
+   instructions per batch of individuals.  a block's stack of values
+   and a batch's programs should fit in L2 together. */
+#define TILE_CASES        256
+#define TILE_OPS          8192
+
+#define STREAM_MAGIC      "lgpcase1"
+#define STREAM_ROWS       65536
+
+/* the fitness cache file:  its default size in entries, and the
+   entries of a set, among which the least recently used is evicted. */
+#define FITCACHE_MAGIC    "lgpfit01"
+#define FITCACHE_SLOTS    65536
+#define FITCACHE_WAYS     4
 
 #define PARAMETER_MINSIZE       31
 #define PARAMETER_CHUNKSIZE     16
@@ -110,6 +229,20 @@
 
 #define FLAG_NONE               0
 #define FLAG_NEWEXCH            1
+#define FLAG_FLOATFIT           2
+#define FLAG_TARPEIAN           4
+
+/* the "fair" option of crossover. */
+#define BLOAT_FAIR_NONE         0
+#define BLOAT_FAIR_SIZE         1
+#define BLOAT_FAIR_HOMOLOGOUS   2
+
+/* how per-case errors are kept (lexicase.c), and the scale of the
+   quantized ones' log. */
+#define CASE_ERRORS_NONE        0
+#define CASE_ERRORS_FLOAT       1
+#define CASE_ERRORS_QUANTIZED   2
+#define CASE_ERROR_QSCALE       2048.0
 
 #define GENSPACE_COUNT          2
 
@@ -119,4 +252,7 @@
 #define CK_MAGIC                "lilgp1.0\n"
 #define CK_IDSTRING             "id: lilgp v1.0 checkpoint file\n"
 
+/* the binary population section of a checkpoint. */
+#define CK_POPMAGIC             "lgppop01"
+
 #endif
@@ -26,64 +26,119 @@
  */
 
 #include "lilgp.h"
+
+/* ERCs live in a pool of fixed-size chunks.  each record is addressed
+ * by its index in the pool (chunk number, then offset in the chunk), so
+ * pointers to records never move when the pool grows.  free records
+ * are marked in a bitmap; allocation takes the lowest free index.
+ *
+ * garbage collection is incremental: rather than sweeping every live
+ * record each generation, the records that could be garbage -- newly
+ * created ones, and ones whose reference count has dropped to zero --
+ * are pushed on a candidate list, and only those are examined.
+ */
+
+#define MAPBITS            ( 8 * (int)sizeof ( unsigned long ) )
+#define RECORD(i)          ( ephem_chunks[(i)>>EPHEM_CHUNKSHIFT] + \
+                             ( (i) & ( EPHEM_CHUNKSIZE - 1 ) ) )
+#define IS_FREE(i)         ( free_map[(i)/MAPBITS] & ( 1UL << ( (i)%MAPBITS ) ) )
+
+/* nonzero if ERC values are stored directly in the trees. */
+int ephem_inline = 0;
+
 /* total counts of ERCs used and freed */
 int ercused = 0;
 int ercfree = 0;
 int ercalloc = 0;
 
-/* the active list. */
-ephem_const *active_head;
 int active_count;
-
-/* the free list. */
-ephem_const *free_head;
 int free_count;
 
-/* pointers for the allocated blocks for ERCs. */
-ephem_const **block_list;
-int block_list_size;
-int block_count;
+/* the chunks of the pool.  (compact trees address ERCs through this.) */
+ephem_const **ephem_chunks;
+static int chunk_list_size;
+static int chunk_count;
+
+#ifdef COMPACT_TREES
+/* outgrown chunk lists.  evaluation threads read ephem_chunks without
+   the lock, so a list that is replaced stays valid until the pool is
+   freed. */
+static ephem_const ***retired;
+static int retired_count;
+#endif
+
+/* the free bitmap (bit set = record free), and the first word that may
+   have a free bit in it. */
+static unsigned long *free_map;
+static int free_hint;
+
+/* indices of records that may have become garbage. */
+static int *candidates;
+static int candidate_count;
+static int candidate_size;
+
+/* lowest_bit()
+ *
+ * returns the index of the lowest set bit of a nonzero word.
+ */
+
+static int lowest_bit ( unsigned long m )
+{
+#ifdef __GNUC__
+     return __builtin_ctzl ( m );
+#else
+     int b = 0;
+     while ( !( m & 1 ) )
+     {
+          m >>= 1;
+          ++b;
+     }
+     return b;
+#endif
+}
+
+/* ephem_configure()
+ *
+ * reads the inline_ercs parameter.  called once the parameter database
+ * is complete, before any trees are built or read.
+ */
+
+void ephem_configure ( void )
+{
+     char *param = get_parameter ( "inline_ercs" );
+     
+     ephem_inline = param ? atoi ( param ) : 0;
+#ifdef COMPACT_TREES
+     if ( ephem_inline )
+          error ( E_WARNING, "inline_ercs is not available with compact trees." );
+     ephem_inline = 0;
+#endif
+     if ( ephem_inline )
+          oputs ( OUT_SYS, 30, "    ERC values stored inline in trees.\n" );
+}
 
 /* initialize_ephem_const()
  *
- * allocate and set up the first block of ERCs, the free list,
- * etc.
+ * allocate and set up the first chunk of the ERC pool.
  */
 
 void initialize_ephem_const ( void )
 {
-     int i;
-     int size;
-
      oputs ( OUT_SYS, 30, "    ephemeral random constants.\n" );
 
-     active_head = (ephem_const *)MALLOC ( sizeof ( ephem_const ) );
-     active_head->refcount = 1;
-     active_head->next = NULL;
+     chunk_list_size = EPHEM_CHUNKLISTGROW;
+     ephem_chunks = (ephem_const **)MALLOC ( chunk_list_size *
+                                          sizeof ( ephem_const * ) );
+     chunk_count = 0;
+     free_map = NULL;
+     free_hint = 0;
+     active_count = free_count = 0;
+
+     candidate_size = EPHEM_CHUNKSIZE;
+     candidates = (int *)MALLOC ( candidate_size * sizeof ( int ) );
+     candidate_count = 0;
      
-     free_head = (ephem_const *)MALLOC ( sizeof ( ephem_const ) );
-     free_head->refcount = 1;
-     free_head->next = NULL;
-     
-     /** how many block >>pointers<< to allocate (not blocks). **/
-     block_list_size = EPHEM_METABLOCKSIZE;
-     block_list = (ephem_const **)MALLOC ( block_list_size *
-					  sizeof ( ephem_const * ) );
-
-     /* allocate the first block. */
-     size = EPHEM_STARTSIZE;
-     block_count = 1;
-     block_list[0] = (ephem_const *)MALLOC ( size *
-                                                  sizeof ( ephem_const ) );
-     free_count = ercalloc = size;
-
-     /* chain all the ERC records in the block together. */
-     for ( i = 0; i < size-1; ++i )
-          block_list[0][i].next = block_list[0]+i+1;
-     block_list[0][size-1].next = NULL;
-
-     /* add the chain to the free list. */
-     free_head->next = block_list[0];
+     enlarge_ephem_space();
 }
 
 /* free_ephem_const()
@@ -97,51 +152,120 @@ void free_ephem_const ( void )
 
      ephem_const_gc();
      
-     for ( i = 0; i < block_count; ++i )
-          FREE ( block_list[i] );
-     FREE ( block_list );
-
-     FREE ( active_head );
-     FREE ( free_head );
+     for ( i = 0; i < chunk_count; ++i )
+          FREE ( ephem_chunks[i] );
+     FREE ( ephem_chunks );
+     FREE ( free_map );
+     FREE ( candidates );
+#ifdef COMPACT_TREES
+     for ( i = 0; i < retired_count; ++i )
+          FREE ( retired[i] );
+     FREE ( retired );
+     retired = NULL;
+     retired_count = 0;
+#endif
 }
 
 /* enlarge_ephem_space()
  *
- * allocate a new block of ERCs, and add all the records in it
- * to the free list.
+ * add a chunk to the pool, and mark all its records free.
  */
 
 void enlarge_ephem_space ( void )
 {
-     int i;
+     int words = EPHEM_CHUNKSIZE / MAPBITS;
+#ifdef COMPACT_TREES
+     ephem_const **list;
+#endif
+     
+     if ( chunk_count == chunk_list_size )
+     {
+          chunk_list_size += EPHEM_CHUNKLISTGROW;
+#ifdef COMPACT_TREES
+          list = (ephem_const **)MALLOC ( chunk_list_size *
+                                         sizeof ( ephem_const * ) );
+          memcpy ( list, ephem_chunks, chunk_count * sizeof ( ephem_const * ) );
+          retired = (ephem_const ***)REALLOC ( retired, ( retired_count + 1 ) *
+                                              sizeof ( ephem_const ** ) );
+          retired[retired_count++] = ephem_chunks;
+          ephem_chunks = list;
+#else
+          ephem_chunks = (ephem_const **)REALLOC ( ephem_chunks,
+                                                chunk_list_size *
+                                                sizeof ( ephem_const * ) );
+#endif
+     }
+
+     ephem_chunks[chunk_count] =
+          (ephem_const *)MALLOC ( EPHEM_CHUNKSIZE * sizeof ( ephem_const ) );
+     
+     free_map = (unsigned long *)REALLOC ( free_map, (chunk_count+1) * words *
+                                          sizeof ( unsigned long ) );
+     memset ( free_map + chunk_count * words, 0xff,
+             words * sizeof ( unsigned long ) );
+     if ( free_count == 0 )
+          free_hint = chunk_count * words;
+     
+     ++chunk_count;
+     free_count += EPHEM_CHUNKSIZE;
+     ercalloc += EPHEM_CHUNKSIZE;
+}
+
+/* ephem_alloc()
+ *
+ * takes the lowest-numbered free record out of the pool.
+ */
+
+static ephem_const *ephem_alloc ( void )
+{
      ephem_const *p;
-     int size = EPHEM_GROWSIZE;
+     int w, i;
+
+     if ( free_count == 0 )
+          enlarge_ephem_space();
+
+     /* every word below free_hint is known to be full. */
+     for ( w = free_hint; free_map[w] == 0; ++w );
+     free_hint = w;
+     
+     i = w * MAPBITS + lowest_bit ( free_map[w] );
+     free_map[w] &= ~( 1UL << ( i % MAPBITS ) );
+     --free_count;
+     ++active_count;
+     ++ercused;
+
+     p = RECORD(i);
+     p->index = i;
+     return p;
+}
+
+/* add_candidate()
+ *
+ * push a record onto the list for the next collection.
+ */
 
-     /** if we've allocated too many blocks, we need to lengthen the
-       list that holds block pointers. **/
-     if ( block_count == block_list_size )
+static void add_candidate ( int i )
+{
+     if ( candidate_count == candidate_size )
      {
-          block_list_size += EPHEM_METABLOCKSIZE;
-          block_list = (ephem_const **)REALLOC ( block_list,
-						block_list_size *
-						sizeof ( ephem_const *));
+          candidate_size *= 2;
+          candidates = (int *)REALLOC ( candidates,
+                                       candidate_size * sizeof ( int ) );
      }
+     candidates[candidate_count++] = i;
+}
 
-     /* allocate the new block. */
-     block_list[block_count] =
-          (ephem_const *)MALLOC ( size * sizeof ( ephem_const ) );
-     free_count += size;
-     ercalloc += size;
+/* ephem_release()
+ *
+ * called when an ERC's reference count drops to zero; makes it a
+ * candidate for the next collection.
+ */
 
-     /* chain together all the records in it. */
-     for ( i = 0; i < size-1; ++i )
-          block_list[block_count][i].next =
-               block_list[block_count]+i+1;
-     
-     block_list[block_count][size-1].next = free_head->next;
-     free_head->next = block_list[block_count];
-     
-     ++block_count;
+void ephem_release ( ephem_const *e )
+{
+     async_lock();
+     add_candidate ( e->index );
+     async_unlock();
 }
      
 /* new_ephemeral_const()
@@ -153,76 +277,113 @@ ephem_const *new_ephemeral_const ( function *f )
 {
      ephem_const *p;
 
-     /* make sure we have enough space. */
-     while ( free_count <= 0 )
-          enlarge_ephem_space();
-
-     /* take the next record off the free list. */
-     p = free_head->next;
-     free_head->next = free_head->next->next;
-     --free_count;
-
+     async_lock();
+     p = ephem_alloc();
+     
      /* call user code to generate the constant, placing
 	the value in the new record. */
      f->ephem_gen ( &(p->d) );
      p->f = f;
 
-     /* no references yet. */
+     /* no references yet, so it is garbage unless something picks it
+	up before the next collection. */
      p->refcount = 0;
+     add_candidate ( p->index );
+     async_unlock();
+     
+     return p;
+}
 
-     /* add this record to the linked list of active ERCs. */
-     p->next = active_head->next;
-     active_head->next = p;
-     ++active_count;
+/* ephem_hold()
+ *
+ * create a constant with the given value that already has one
+ * reference, held by the caller until it calls ephem_drop().  a
+ * collection made meanwhile on another thread can't take it.
+ */
+
+ephem_const *ephem_hold ( function *f, DATATYPE d )
+{
+     ephem_const *p;
+
+     async_lock();
+     p = ephem_alloc();
+     p->d = d;
+     p->f = f;
+     p->refcount = 1;
+     async_unlock();
 
-     ++ercused;
-     
      return p;
 }
+
+/* ephem_drop()
+ *
+ * give up a reference taken by ephem_hold().
+ */
+
+void ephem_drop ( ephem_const *e )
+{
+     async_lock();
+     if ( --e->refcount == 0 )
+          add_candidate ( e->index );
+     async_unlock();
+}
      
+/* new_ephem_node()
+ *
+ * fill in the lnode following an ERC function with a new constant:
+ * either its value, or a pointer to a new pooled ERC.
+ */
+
+void new_ephem_node ( lnode *l, function *f )
+{
+#ifndef COMPACT_TREES
+     if ( ephem_inline )
+     {
+          f->ephem_gen ( &(l->v) );
+          return;
+     }
+#endif
+     LNODE_SETD ( *l, new_ephemeral_const ( f ) );
+}
+
 /* ephem_const_gc()
  *
- * traverse the linked list of active ERCs, removing those with
- * a reference count of 0.
+ * return the candidate records that still have no references to
+ * the pool.
  */
 
 void ephem_const_gc ( void )
 {
-     ephem_const *p = active_head->next;
-     ephem_const *m = active_head;
+     int i, w;
 
-     while ( p != NULL )
+     async_lock();
+     while ( candidate_count > 0 )
      {
-          if ( p->refcount == 0 )
-          {
-	       /* patch the linked list to skip this record. */
-               m->next = p->next;
-
-	       /* add this record to the free list. */
-               p->next = free_head->next;
-	       free_head->next = p;
-               ++free_count;
-               ++ercfree;
-	       --active_count;
-	       
-               p = m->next;
-          }
-          else
-          {
-	       /* move past this record. */
-               m = p;
-               p = p->next;
-          }
+          i = candidates[--candidate_count];
+
+	  /* a record can be on the list more than once, or have been
+	     picked up again since it was put there. */
+          if ( RECORD(i)->refcount != 0 || IS_FREE(i) )
+               continue;
+
+          w = i / MAPBITS;
+          free_map[w] |= 1UL << ( i % MAPBITS );
+          if ( w < free_hint )
+               free_hint = w;
+          ++free_count;
+          --active_count;
+          ++ercfree;
      }
-
+     async_unlock();
 }
                
 /* read_ephem_list()
  *
- * read list of ERCs from a checkpoint file. 
+ * read list of ERCs from a checkpoint file.  their number is stored
+ * in *count_out, if it isn't NULL.
  */
 
-ephem_const **read_ephem_list ( FILE *f )
+ephem_const **read_ephem_list ( FILE *f, int *count_out )
 {
      ephem_const **ind;
      ephem_const *p;
@@ -232,6 +393,8 @@ ephem_const **read_ephem_list ( FILE *f )
 
      /* read the count. */
      fscanf ( f, "%*s %d\n", &count );
+     if ( count_out )
+          *count_out = count;
 
      /** if no ERCs, do nothing and return a NULL pointer for the index. **/
      if ( count == 0 )
@@ -244,42 +407,19 @@ ephem_const **read_ephem_list ( FILE *f )
      /* allocate the index translating integers --> addresses. */
      ind = (ephem_const **)MALLOC ( count * sizeof ( ephem_const * ) );
      
-     /** allocate a new block to hold all the ERCs we read. **/
-
-     /* we shouldn't EVER need to lengthen the block list while reading
-	a checkpoint, but check anyway... */
-     if ( block_count == block_list_size )
-     {
-          block_list_size += EPHEM_METABLOCKSIZE;
-          block_list = (ephem_const **)REALLOC ( block_list,
-						block_list_size *
-						sizeof ( ephem_const *));
-     }
-
-     /* allocate the new block. */
-     block_list[block_count] =
-	  (ephem_const *)MALLOC ( count * sizeof ( ephem_const ) );
-     ercalloc += count;
-     
-     /* read the checkpointed ERCs into the new block. */
+     /* read the checkpointed ERCs into the pool.  the function pointer
+	is filled in as the trees are read. */
      for ( i = 0; i < count; ++i )
      {
-	  p = block_list[block_count]+i;
+	  p = ephem_alloc();
 	  fscanf ( f, "%d %d ", &j, &(p->refcount) );
 	  ind[j] = p;
 	  read_hex_block ( &(p->d), sizeof ( DATATYPE ), f );
 	  fgets ( buffer, MAXCHECKLINELENGTH, f );
-
-	  /* chain together all the records. */
-	  block_list[block_count][i].next = block_list[block_count]+i+1;
+	  p->f = NULL;
+	  if ( p->refcount == 0 )
+	       ephem_release ( p );
      }
-     /* add the chained block to the active list. */
-     block_list[block_count][count-1].next = active_head->next;
-     active_head->next = block_list[block_count];
-     active_count += count;
-     ercused += count;
-     
-     ++block_count;
 
      FREE ( buffer );
      
@@ -289,81 +429,53 @@ ephem_const **read_ephem_list ( FILE *f )
      
 /* write_ephem_list()
  *
- * write the active list of ERCs to a checkpoint file.  returns an
- * index listing for translating an ERC address to a unique integer.
- * (we can't store the address directly in the checkpoint, since
- * the ERCs won't be loaded in the same spot in memory on restart.)
+ * write the live ERCs to a checkpoint file, numbered consecutively.
+ * returns an index, addressed by pool index, for translating an ERC to
+ * its number in the file.  (we can't store the pool index directly,
+ * since the pool may be laid out differently on restart.)
  */
 
 ephem_index *write_ephem_list ( FILE *f )
 {
      ephem_index *ind;
-     ephem_const *p = active_head->next;
-     int j;
+     ephem_const *p;
+     int i, j;
 
-     ind = (ephem_index *)MALLOC ( active_count * sizeof ( ephem_index ) );
+     ind = (ephem_index *)MALLOC ( chunk_count * EPHEM_CHUNKSIZE *
+                                  sizeof ( ephem_index ) );
      fprintf ( f, "erc-count: %d\n", active_count );
      
      j = 0;
-     while ( p )
+     for ( i = 0; i < chunk_count * EPHEM_CHUNKSIZE; ++i )
      {
+          if ( IS_FREE(i) )
+               continue;
+          p = RECORD(i);
+          
 	  /* store the index entry. */
-          ind[j].e = p;
-          ind[j].i = j;
+          ind[i].e = p;
+          ind[i].i = j;
 
 	  /* write the reference count and the value. */
 	  fprintf ( f, "%d %d ", j, p->refcount );
 	  write_hex_block ( &(p->d), sizeof(DATATYPE), f );
 	  fprintf ( f, " %s %s\n", p->f->string, p->f->ephem_str ( p->d ) );
 
-	  /* move down the list. */
-          p = p->next;
           ++j;
      }
 
-     /* sort the index by address, so we can use binary searching
-	on it. */
-     qsort ( ind, active_count, sizeof(ephem_index), ephem_index_comp );
-
      return ind;
 }
 
 /* lookup_ephem()
  *
- * look up an ERC (by address) in an index returned by write_ephem_list()
- * and return its integer index.
+ * look up an ERC in an index returned by write_ephem_list() and return
+ * its number in the checkpoint file.
  */
 
 int lookup_ephem ( ephem_index *ind, ephem_const *e )
 {
-     int low = 0;
-     int high = (ercused-ercfree);
-     int mid;
-
-     while ( low < high-1 )
-     {
-          mid = (low+high)/2;
-          if ( e >= ind[mid].e )
-               low = mid;
-          else
-               high = mid;
-     }
-
-     return ind[low].i;
-}
-     
-/* ephem_index_comp()
- *
- * comparison function for using qsort() to order the ERC index by
- * address.
- */
-
-int ephem_index_comp ( const void *a, const void *b )
-{
-     if ( ((ephem_index *)a)->e < ((ephem_index *)b)->e )
-          return -1;
-     else
-          return 1;
+     return ind[e->index].i;
 }
 
 /* get_ephem_stats()
@@ -375,6 +487,6 @@ void get_ephem_stats ( int *used, int *free, int *blocks, int *alloc )
 {
      *used = ercused;
      *free = ercfree;
-     *blocks = block_count;
+     *blocks = chunk_count;
      *alloc = ercalloc;
 }
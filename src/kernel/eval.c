@@ -26,6 +26,56 @@
  */
 
 #include "lilgp.h"
+
+/* which engine evaluate_pop() uses, and the fitness cases for the
+   engines that run the cases themselves. */
+int eval_engine = EVAL_ENGINE_TREE;
+caseset cases = { 0, 0, NULL, NULL };
+
+/* initialize_eval_engine()
+ *
+ * reads the eval.engine parameter.
+ */
+
+void initialize_eval_engine ( void )
+{
+     char *param = get_parameter ( "eval.engine" );
+
+     if ( param == NULL || strcmp ( param, "tree" ) == 0 )
+          eval_engine = EVAL_ENGINE_TREE;
+     else if ( strcmp ( param, "dag" ) == 0 )
+          eval_engine = EVAL_ENGINE_DAG;
+     else if ( strcmp ( param, "tiled" ) == 0 )
+          eval_engine = EVAL_ENGINE_TILED;
+     else if ( strcmp ( param, "stream" ) == 0 )
+     {
+          eval_engine = EVAL_ENGINE_STREAM;
+          stream_open();
+     }
+     else
+          error ( E_FATAL_ERROR, "unknown eval.engine \"%s\".", param );
+}
+
+/* register_caseset()
+ *
+ * called by the application to describe its fitness cases:  input[i]
+ * is an array of input i's values for each case, and target the values
+ * wanted.  the arrays remain the application's.  engines other than
+ * "tree" need this.  with the streaming engine the cases come from its
+ * dataset instead, and this does nothing.
+ */
+
+void register_caseset ( int count, int inputs, DATATYPE **input,
+                       DATATYPE *target )
+{
+     if ( eval_engine == EVAL_ENGINE_STREAM )
+          return;
+     cases.cases = count;
+     cases.inputs = inputs;
+     cases.input = input;
+     cases.target = target;
+}
+
 /* set_current_individual()
  *
  * the current_individual variable is used so that evaluation tokens know
@@ -33,13 +83,27 @@
  * set this value from the application code.
  */
 
-static individual * current_individual;
+static THREAD_LOCAL individual * current_individual;
 
 void set_current_individual ( individual *ind )
 {
      current_individual = ind;
 }
 
+/* set_input_row()
+ *
+ * input terminals (PRIM_INPUT) are read by the evaluator:  input i is
+ * row[i].  the application points this at the current case's inputs
+ * before evaluating trees.
+ */
+
+static THREAD_LOCAL const DATATYPE * input_row;
+
+void set_input_row ( const DATATYPE *row )
+{
+     input_row = row;
+}
+
 /* evaluate_tree()
  *
  * this is the wrapper which sets up a traversal pointer for doing the
@@ -66,8 +130,9 @@ DATATYPE evaluate_tree_recurse ( lnode **l, int whichtree )
 {
 
      farg arg[MAXARGS];
+     DATATYPE d;
      int i;
-     function *f = (**l).f;
+     function *f = LNODE_F(**l);
      treeinfo savearg;
 
      /* step the traversal pointer forward, now that we've saved which
@@ -77,13 +142,19 @@ DATATYPE evaluate_tree_recurse ( lnode **l, int whichtree )
      switch ( f->type )
      {
         case TERM_NORM:
-	  /* normal terminal:  just call the user code. */
+	  /* normal terminal:  just call the user code.  input terminals
+	     have none, and read the current case's inputs. */
+          if ( f->prim == PRIM_INPUT )
+               return input_row[f->input];
           return (f->code)(whichtree, NULL);
           break;
         case TERM_ERC:
-	  /* ERC terminal:  traversal pointer points to ERC structure.
-	     pull the value out, and step the pointer forward. */
-          return (*((*l)++)).d->d;
+	  /* ERC terminal:  traversal pointer points to the ERC value,
+	     or to the ERC structure holding it.  pull the value out, and
+	     step the pointer forward. */
+          d = ERC_VALUE(**l);
+          ++*l;
+          return d;
           break;
         case FUNC_DATA:
 	  /* function (DATA type):  recursively evaluate each subtree,
@@ -408,7 +408,6 @@ void exchange_subpopulations ( multipop *mpop )
      int i, j, k;
      sel_context *tocon;
      sel_context **fromcon;
-     select_context_func_ptr select_con;
      int tp, *fp;
      int ti, *fi;
 
@@ -432,9 +431,7 @@ void exchange_subpopulations ( multipop *mpop )
           tp = mpop->exch[i].to;
 
 	  /* set up selection method to pick individuals to be replaced. */
-          select_con = get_select_context ( mpop->exch[i].tosc );
-          tocon = select_con ( SELECT_INIT, NULL, mpop->pop[tp],
-                              mpop->exch[i].tosc );
+          tocon = select_context_init ( mpop->exch[i].tosc, mpop->pop[tp] );
 
 	  /* are we copying whole individuals or creating composites? */
           if ( mpop->exch[i].copywhole > -1 )
@@ -446,9 +443,8 @@ void exchange_subpopulations ( multipop *mpop )
 
 	       /* selection method for choosing individuals from source
 		  subpop. */
-               select_con = get_select_context ( mpop->exch[i].fromsc[0] );
-               fromcon[0] = select_con ( SELECT_INIT, NULL, mpop->pop[fp[0]],
-                                        mpop->exch[i].fromsc[0] );
+               fromcon[0] = select_context_init ( mpop->exch[i].fromsc[0],
+                                                 mpop->pop[fp[0]] );
 
                for ( k = 0; k < mpop->exch[i].count; ++k )
                {
@@ -508,10 +504,8 @@ void exchange_subpopulations ( multipop *mpop )
                                  j, mpop->exch[i].fromsc[j] );
 #endif
 			 /* create it. */
-                         select_con = get_select_context ( mpop->exch[i].fromsc[j] );
-                         fromcon[j] = select_con ( SELECT_INIT, NULL,
-                                                  mpop->pop[mpop->exch[i].from[j]],
-                                                  mpop->exch[i].fromsc[j] );
+                         fromcon[j] = select_context_init ( mpop->exch[i].fromsc[j],
+                                                           mpop->pop[mpop->exch[i].from[j]] );
                     }
                     else
 			 /* don't need one. */
@@ -0,0 +1,446 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+#include "lilgp.h"
+
+#ifdef FITCACHE_AVAILABLE
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* the persistent fitness cache.
+ *
+ * with "fitcache.file" set, the fitness of every individual evaluated
+ * is kept in that file, and an individual found there is not evaluated
+ * again -- in this run or any later one on the same problem.  the file
+ * is mapped into memory and may be shared by any number of runs at
+ * once.
+ *
+ * an entry's key hashes the individual's trees with the problem:  the
+ * function sets, the fitness cases (or the streamed dataset's name,
+ * size and date), and the "app.*" parameters.  the app keeps one value
+ * of its own with each fitness (app_cache_extra()), and is given it
+ * back on a hit (app_cache_hit()).
+ *
+ * the file holds "fitcache.size" entries (rounded up to a power of
+ * two; an existing file keeps its size), in sets of FITCACHE_WAYS.  a
+ * new fitness replaces the least recently used entry of its set.
+ * entries are written under a per-entry sequence lock, so readers
+ * never take a lock; a writer that finds an entry busy just doesn't
+ * store.
+ *
+ * individuals scored in single precision (FLAG_FLOATFIT), or not
+ * scored at all (FLAG_TARPEIAN), are not stored.  the cache isn't used
+ * when per-case errors are kept ("case_errors"), since it can't give
+ * them back.
+ */
+
+static fitcache_header *header = NULL;
+static fitcache_entry *entries;
+static size_t map_size;
+static uint64_t problem[2];
+
+/* individuals of the population being evaluated that missed. */
+static int *pending = NULL;
+static int pending_size = 0;
+static int pending_count;
+
+static long cache_lookups = 0;
+static long cache_hits = 0;
+static long cache_stores = 0;
+static long cache_evictions = 0;
+
+/* hash_bytes()
+ *
+ * folds a block of memory into the problem hashes (FNV-1a).
+ */
+
+static void hash_bytes ( const void *p, size_t n )
+{
+     const unsigned char *c = (const unsigned char *)p;
+     size_t i;
+     
+     for ( i = 0; i < n; ++i )
+     {
+          problem[0] = ( problem[0] ^ c[i] ) * 0x100000001b3ULL;
+          problem[1] = ( problem[1] ^ c[i] ) * 0x100000001b3ULL;
+     }
+}
+
+/* hash_problem()
+ *
+ * computes the hash of everything besides the trees that goes into a
+ * fitness.
+ */
+
+static void hash_problem ( void )
+{
+     extern parameter *param;
+     extern int param_size;
+     uint64_t sum = 0, h;
+     char *name, *v;
+     int i, j;
+#ifdef FITCACHE_AVAILABLE
+     struct stat st;
+#endif
+
+     problem[0] = 0xcbf29ce484222325ULL;
+     problem[1] = 0x84222325cbf29ce4ULL;
+
+     /* the function sets, by name. */
+     hash_bytes ( &fset_count, sizeof ( int ) );
+     hash_bytes ( &tree_count, sizeof ( int ) );
+     for ( i = 0; i < fset_count; ++i )
+          for ( j = 0; j < fset[i].size; ++j )
+               hash_bytes ( fset[i].cset[j].string,
+                           strlen ( fset[i].cset[j].string ) + 1 );
+
+     /* the cases. */
+     hash_bytes ( &cases.cases, sizeof ( int ) );
+     hash_bytes ( &cases.inputs, sizeof ( int ) );
+     if ( eval_engine == EVAL_ENGINE_STREAM )
+     {
+          name = get_parameter ( "eval.stream.file" );
+          hash_bytes ( name, strlen ( name ) );
+#ifdef FITCACHE_AVAILABLE
+          if ( stat ( name, &st ) == 0 )
+          {
+               hash_bytes ( &st.st_size, sizeof ( st.st_size ) );
+               hash_bytes ( &st.st_mtime, sizeof ( st.st_mtime ) );
+          }
+#endif
+     }
+     else if ( cases.input != NULL )
+     {
+          for ( i = 0; i < cases.inputs; ++i )
+               hash_bytes ( cases.input[i], cases.cases * sizeof ( DATATYPE ) );
+          hash_bytes ( cases.target, cases.cases * sizeof ( DATATYPE ) );
+     }
+
+     /* the app's parameters, in any order. */
+     for ( i = 0; i < param_size; ++i )
+     {
+          if ( strncmp ( param[i].n, "app.", 4 ) )
+               continue;
+          h = 0xcbf29ce484222325ULL;
+          for ( name = param[i].n; *name; ++name )
+               h = ( h ^ (unsigned char)*name ) * 0x100000001b3ULL;
+          h = ( h ^ '=' ) * 0x100000001b3ULL;
+          for ( v = param[i].v; v && *v; ++v )
+               h = ( h ^ (unsigned char)*v ) * 0x100000001b3ULL;
+          sum += h;
+     }
+     hash_bytes ( &sum, sizeof ( sum ) );
+}
+
+/* fitcache_open()
+ *
+ * maps the cache file, creating it if need be.  called once the fitness
+ * cases are registered.
+ */
+
+void fitcache_open ( void )
+{
+     char *name, *param;
+     int slots;
+#ifdef FITCACHE_AVAILABLE
+     fitcache_header h;
+     struct stat st;
+     void *map;
+     int fd;
+#endif
+
+     name = get_parameter ( "fitcache.file" );
+     if ( name == NULL || *name == 0 )
+          return;
+     if ( case_error_format != CASE_ERRORS_NONE )
+     {
+          error ( E_WARNING, "the fitness cache keeps no per-case errors; not used with \"case_errors\"." );
+          return;
+     }
+
+#ifdef FITCACHE_AVAILABLE
+     param = get_parameter ( "fitcache.size" );
+     slots = param ? atoi ( param ) : FITCACHE_SLOTS;
+     if ( slots < FITCACHE_WAYS )
+          slots = FITCACHE_WAYS;
+     for ( h.slots = FITCACHE_WAYS; h.slots < slots; h.slots *= 2 )
+          ;
+
+     fd = open ( name, O_RDWR | O_CREAT, 0666 );
+     if ( fd == -1 )
+     {
+          error ( E_WARNING, "can't open fitness cache \"%s\".", name );
+          return;
+     }
+     
+     /* only one run sets up a new file. */
+     flock ( fd, LOCK_EX );
+     if ( fstat ( fd, &st ) == 0 && st.st_size == 0 )
+     {
+          memcpy ( h.magic, FITCACHE_MAGIC, 8 );
+          h.entrysize = sizeof ( fitcache_entry );
+          h.clock = 0;
+          if ( ftruncate ( fd, sizeof ( fitcache_header ) +
+                          (off_t)h.slots * sizeof ( fitcache_entry ) ) ||
+               write ( fd, &h, sizeof ( h ) ) != sizeof ( h ) )
+               error ( E_FATAL_ERROR, "can't create fitness cache \"%s\".", name );
+     }
+     else if ( pread ( fd, &h, sizeof ( h ), 0 ) != sizeof ( h ) ||
+               memcmp ( h.magic, FITCACHE_MAGIC, 8 ) ||
+               h.entrysize != sizeof ( fitcache_entry ) ||
+               h.slots < FITCACHE_WAYS || ( h.slots & ( h.slots - 1 ) ) )
+          error ( E_FATAL_ERROR, "\"%s\" is not a fitness cache.", name );
+     else if ( h.slots != slots && param )
+          error ( E_WARNING, "fitness cache \"%s\" keeps its size of %d entries.",
+                 name, h.slots );
+     flock ( fd, LOCK_UN );
+
+     map_size = sizeof ( fitcache_header ) +
+          (size_t)h.slots * sizeof ( fitcache_entry );
+     map = mmap ( NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+     close ( fd );
+     if ( map == MAP_FAILED )
+     {
+          error ( E_WARNING, "can't map fitness cache \"%s\".", name );
+          return;
+     }
+     header = (fitcache_header *)map;
+     entries = (fitcache_entry *)( header + 1 );
+
+     hash_problem();
+     oprintf ( OUT_SYS, 30, "    fitness cache %s:  %d entries.\n", name,
+              header->slots );
+#else
+     error ( E_WARNING, "the fitness cache isn't available on this system." );
+#endif
+}
+
+/* individual_key()
+ *
+ * the key of an individual:  its trees, hashed with the problem.
+ */
+
+static void individual_key ( individual *ind, uint64_t *key )
+{
+     int j;
+     
+     key[0] = problem[0];
+     key[1] = problem[1];
+     for ( j = 0; j < tree_count; ++j )
+          tree_hash ( ind->tr[j].data, key );
+     
+     /* {0,0} marks an empty entry. */
+     key[0] |= 1;
+}
+
+/* fitcache_fetch()
+ *
+ * looks an individual up.  on a hit fills in its fitness, marks it
+ * evaluated, and returns 1.  population_No must be the individual's
+ * number, as for app_eval_fitness().
+ */
+
+int fitcache_fetch ( individual *ind )
+{
+     fitcache_entry *e, copy;
+     uint64_t key[2];
+     uint32_t seq;
+     int i;
+     
+     if ( header == NULL )
+          return 0;
+     ATOMIC_ADD ( cache_lookups, 1 );
+
+     individual_key ( ind, key );
+     e = entries + ( key[0] & ( header->slots - 1 ) & ~(uint64_t)( FITCACHE_WAYS - 1 ) );
+     for ( i = 0; i < FITCACHE_WAYS; ++i, ++e )
+     {
+          seq = *(volatile uint32_t *)&e->seq;
+          if ( seq & 1 )
+               continue;
+          MEMORY_BARRIER();
+          memcpy ( &copy, e, sizeof ( fitcache_entry ) );
+          MEMORY_BARRIER();
+          if ( *(volatile uint32_t *)&e->seq != seq ||
+               copy.key[0] != key[0] || copy.key[1] != key[1] )
+               continue;
+
+          /* losing a race to update the stamp matters little. */
+          ATOMIC_CAS ( e->stamp, copy.stamp,
+                      (uint32_t)ATOMIC_ADD ( header->clock, 1 ) );
+          
+          ind->r_fitness = copy.r_fitness;
+          ind->s_fitness = copy.s_fitness;
+          ind->a_fitness = copy.a_fitness;
+          ind->hits = copy.hits;
+          ind->evald = EVAL_CACHE_VALID;
+          ind->flags &= ~FLAG_FLOATFIT;
+          app_cache_hit ( ind, copy.extra );
+          ATOMIC_ADD ( cache_hits, 1 );
+          return 1;
+     }
+     return 0;
+}
+
+/* fitcache_store()
+ *
+ * records an individual's fitness, just after app_eval_fitness().
+ */
+
+void fitcache_store ( individual *ind )
+{
+     fitcache_entry *e, *set, *victim = NULL;
+     uint64_t key[2];
+     uint32_t seq;
+     int i;
+     
+     if ( header == NULL || ind->evald != EVAL_CACHE_VALID ||
+          ( ind->flags & ( FLAG_FLOATFIT|FLAG_TARPEIAN ) ) )
+          return;
+
+     individual_key ( ind, key );
+     set = entries + ( key[0] & ( header->slots - 1 ) & ~(uint64_t)( FITCACHE_WAYS - 1 ) );
+
+     /* the entry with this key, or else an empty one, or else the least
+	recently used. */
+     for ( i = 0, e = set; i < FITCACHE_WAYS; ++i, ++e )
+     {
+          if ( e->key[0] == key[0] && e->key[1] == key[1] )
+          {
+               victim = e;
+               break;
+          }
+          if ( victim == NULL ||
+               ( victim->key[0] != 0 && ( e->key[0] == 0 ||
+                                          (int32_t)( e->stamp - victim->stamp ) < 0 ) ) )
+               victim = e;
+     }
+
+     seq = *(volatile uint32_t *)&victim->seq;
+     if ( ( seq & 1 ) || !ATOMIC_CAS ( victim->seq, seq, seq + 1 ) )
+          return;
+     MEMORY_BARRIER();
+     
+     if ( victim->key[0] != 0 && ( victim->key[0] != key[0] ||
+                                   victim->key[1] != key[1] ) )
+          ATOMIC_ADD ( cache_evictions, 1 );
+     victim->key[0] = key[0];
+     victim->key[1] = key[1];
+     victim->r_fitness = ind->r_fitness;
+     victim->s_fitness = ind->s_fitness;
+     victim->a_fitness = ind->a_fitness;
+     victim->hits = ind->hits;
+     victim->extra = app_cache_extra ( ind );
+     victim->stamp = (uint32_t)ATOMIC_ADD ( header->clock, 1 );
+     
+     MEMORY_BARRIER();
+     ATOMIC_ADD ( victim->seq, 1 );
+     ATOMIC_ADD ( cache_stores, 1 );
+}
+
+/* fitcache_fetch_pop()
+ *
+ * looks up every individual of a population that needs evaluating, and
+ * remembers the ones that missed for fitcache_store_pop().
+ */
+
+void fitcache_fetch_pop ( population *pop )
+{
+     int k;
+     
+     pending_count = 0;
+     if ( header == NULL )
+          return;
+     
+     if ( pop->size > pending_size )
+     {
+          pending_size = pop->size;
+          pending = (int *)REALLOC ( pending, pending_size * sizeof ( int ) );
+     }
+     for ( k = 0; k < pop->size; ++k )
+          if ( pop->ind[k].evald != EVAL_CACHE_VALID )
+          {
+               population_No = k;
+               if ( !fitcache_fetch ( pop->ind+k ) )
+                    pending[pending_count++] = k;
+          }
+}
+
+/* fitcache_store_pop()
+ *
+ * stores the individuals that missed, once they are evaluated.
+ */
+
+void fitcache_store_pop ( population *pop )
+{
+     int i;
+
+     for ( i = 0; i < pending_count; ++i )
+     {
+          population_No = pending[i];
+          fitcache_store ( pop->ind+pending[i] );
+     }
+     pending_count = 0;
+}
+
+/* free_fitcache()
+ *
+ * unmaps the cache file.
+ */
+
+void free_fitcache ( void )
+{
+#ifdef FITCACHE_AVAILABLE
+     if ( header )
+          munmap ( header, map_size );
+#endif
+     header = NULL;
+     FREE ( pending );
+     pending = NULL;
+     pending_size = 0;
+}
+
+/* output_fitcache_stats()
+ *
+ * report how much the cache saved, at the end of the run.
+ */
+
+void output_fitcache_stats ( void )
+{
+     if ( cache_lookups == 0 )
+          return;
+     oprintf ( OUT_SYS, 30, "\n------- fitness cache -------\n" );
+     oprintf ( OUT_SYS, 30, "             lookups:      %ld\n", cache_lookups );
+     oprintf ( OUT_SYS, 30, "                hits:      %ld\n", cache_hits );
+     oprintf ( OUT_SYS, 30, "              stores:      %ld\n", cache_stores );
+     oprintf ( OUT_SYS, 30, "           evictions:      %ld\n", cache_evictions );
+}
@@ -26,6 +26,82 @@
  */
 
 #include "lilgp.h"
+/* overselect_build()
+ *
+ * fills in the interval table for fitness_overselect from the current
+ * fitness values.
+ */
+
+static void overselect_build ( interval_data *id, population *p )
+{
+     int i, j;
+     double total;
+     double cutoff;
+     double temp;
+
+     id->ri[0].fitness = 0.0;
+     id->ri[0].index = -1;
+     j = 1;
+          
+     /* store the fitness values in the reverse_index */
+     total = 0.0;
+     for ( i = 0; i < p->size; ++i )
+     {
+          total += p->ind[i].a_fitness;
+          id->ri[j].fitness = p->ind[i].a_fitness;
+          id->ri[j].index = i;
+          ++j;
+     }
+
+     /* (sort lowest first) */
+     qsort ( (id->ri)+1, p->size, sizeof ( reverse_index ),
+            rev_ind_compare );
+
+     /* find the top individuals accounting for (cutoff) of the fitness,
+        and multiply their interval width by the selection.  multiply
+        all the others by (1-selection). */
+     cutoff = total * (1.0-id->cutoff);
+     total = 0.0;
+     for ( i = 1; i < p->size+1; ++i )
+     {
+          if ( total >= cutoff )
+               temp = id->ri[i].fitness * id->proportion;
+          else
+               temp = id->ri[i].fitness * (1.0-id->proportion);
+          total += id->ri[i].fitness;
+          id->ri[i].fitness = temp;
+     }
+
+     /* now convert to cumulative. */
+     total = 0.0;
+     for ( i = 1; i < p->size+1; ++i )
+     {
+          total += id->ri[i].fitness;
+          id->ri[i].fitness = total;
+     }
+
+     id->total = total;
+}
+
+/* select_interval_update()
+ *
+ * brings an unsorted cumulative interval table (as built by the fitness
+ * and inverse_fitness methods) up to date after individual sc->changed
+ * has been replaced by one with the given interval width.
+ */
+
+static void select_interval_update ( sel_context *sc, double width )
+{
+     interval_data *id = (interval_data *)(sc->data);
+     int i = sc->changed+1;
+     double d;
+
+     d = width - ( id->ri[i].fitness - id->ri[i-1].fitness );
+     for ( ; i <= id->count; ++i )
+          id->ri[i].fitness += d;
+     id->total += d;
+}
+
 /* select_afit_context()
  *
  * creates context for the fitness selection method.
@@ -72,6 +148,11 @@ sel_context *select_afit_context ( int op, sel_context *sc, population *p,
           return sc;
           break;
 
+        case SELECT_UPDATE:
+          select_interval_update ( sc, p->ind[sc->changed].a_fitness );
+          return sc;
+          break;
+
         case SELECT_CLEAN:
           id = (interval_data *)(sc->data);
           FREE ( id->ri );
@@ -129,6 +210,11 @@ sel_context *select_inverse_afit_context ( int op, sel_context *sc,
           return sc;
           break;
 
+        case SELECT_UPDATE:
+          select_interval_update ( sc, 1.0/p->ind[sc->changed].a_fitness );
+          return sc;
+          break;
+
         case SELECT_CLEAN:
           id = (interval_data *)(sc->data);
           FREE ( id->ri );
@@ -152,12 +238,9 @@ sel_context *select_afit_overselect_context ( int op, sel_context *sc,
 {
      interval_data *id;
      int i, j;
-     double total;
      double group1_cutoff = 0.32;
      int cutoffset;
      double group1_selection = 0.8;
-     double cutoff;
-     double temp;
      char **argv;
 
      switch ( op )
@@ -209,55 +292,20 @@ sel_context *select_afit_overselect_context ( int op, sel_context *sc,
 
           id->ri = (reverse_index *)MALLOC ( (p->size+1) *
                                             sizeof ( reverse_index ) );
-          id->total = 0.0;
           id->count = p->size;
-
-          id->ri[0].fitness = 0.0;
-          id->ri[0].index = -1;
-          j = 1;
-          
-          /* store the fitness values in the reverse_index */
-          total = 0.0;
-          for ( i = 0; i < p->size; ++i )
-          {
-               total += p->ind[i].a_fitness;
-               id->ri[j].fitness = p->ind[i].a_fitness;
-               id->ri[j].index = i;
-               ++j;
-          }
-
-          /* (sort lowest first) */
-          qsort ( (id->ri)+1, p->size, sizeof ( reverse_index ),
-                 rev_ind_compare );
-
-	  /* find the top individuals accounting for (cutoff) of the fitness,
-	     and multiply their interval width by the selection.  multiply
-	     all the others by (1-selection). */
-          cutoff = total * (1.0-group1_cutoff);
-          total = 0.0;
-          for ( i = 1; i < p->size+1; ++i )
-          {
-               if ( total >= cutoff )
-                    temp = id->ri[i].fitness * group1_selection;
-               else
-                    temp = id->ri[i].fitness * (1.0-group1_selection);
-               total += id->ri[i].fitness;
-               id->ri[i].fitness = temp;
-          }
-
-          /* now convert to cumulative. */
-          total = 0.0;
-          for ( i = 1; i < p->size+1; ++i )
-          {
-               total += id->ri[i].fitness;
-               id->ri[i].fitness = total;
-          }
-
-          id->total = total;
+          id->cutoff = group1_cutoff;
+          id->proportion = group1_selection;
+          overselect_build ( id, p );
 
           sc->data = (void *)id;
           return sc;
           break;
+
+        case SELECT_UPDATE:
+          /* the table is sorted by fitness, so it is simply rebuilt. */
+          overselect_build ( (interval_data *)(sc->data), p );
+          return sc;
+          break;
           
         case SELECT_CLEAN:
           id = (interval_data *)(sc->data);
@@ -118,6 +118,33 @@ int gensp_next_int ( int space )
      return gensp[space].used++;
 }
 
+/* gensp_next_block()
+ *
+ * like gensp_next(), but reserves n consecutive lnodes and returns the
+ * address of the first.
+ */
+
+lnode * gensp_next_block ( int space, int n )
+{
+     while ( gensp[space].used + n > gensp[space].size )
+     {
+          int oldsize = gensp[space].size;
+          gensp[space].size += GENSPACE_GROW;
+          gensp[space].data = (lnode *)REALLOC ( gensp[space].data,
+                                                gensp[space].size *
+                                                sizeof ( lnode ) );
+          memset ( gensp[space].data+oldsize, 0,
+                   (gensp[space].size-oldsize) * sizeof ( lnode ) );
+#ifdef DEBUG
+          printf ( "next_block: genspace %d grown to %d nodes.\n",
+                  space, gensp[space].size );
+#endif
+     }
+
+     gensp[space].used += n;
+     return gensp[space].data+(gensp[space].used-n);
+}
+
 /* gensp_dup_tree()
  *
  * copies a completed tree out of a generation space into the tree
@@ -126,8 +153,18 @@ int gensp_next_int ( int space )
 
 void gensp_dup_tree ( int space, tree *t )
 {
+     treeshape s;
+
+     /* the shape is measured once here and kept with the tree, so that
+        the statistics and the breeding limit checks don't have to walk
+        unchanged trees again. */
+     tree_shape ( gensp[space].data, &s );
      t->size = gensp[space].used;
-     t->nodes = tree_nodes ( gensp[space].data );
+     t->nodes = s.nodes;
+     t->depth = s.depth;
+     t->internal = s.internal;
+     t->external = s.external;
+     t->copyof = NULL;
      t->data = (lnode *)MALLOC ( t->size * sizeof ( lnode ) );
      memcpy ( t->data, gensp[space].data, t->size * sizeof ( lnode ) );
 }
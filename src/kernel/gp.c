@@ -29,6 +29,14 @@
 popstats *run_stats;
 saved_ind *saved_head, *saved_tail;
 
+/* time spent evaluating the current generation and breeding it from the
+ previous one, for the generation record stream. */
+static double gen_eval_time, gen_breed_time;
+
+/* the best individual of the last run, for a batch's summary. */
+static double best_fitness;
+static int best_hits, best_gen;
+
 /* run_gp()
  *
  * the whole enchilada.  runs, from generation startgen, using population
@@ -50,6 +58,7 @@ void run_gp(multipop *mpop, int startgen, event *t_eval, event *t_breed,
 	termination_override =0;
 	int stt_interval;
 	int bestn;
+	int steady;
 
 	if (!startfromcheckpoint) {
 
@@ -109,6 +118,16 @@ void run_gp(multipop *mpop, int startgen, event *t_eval, event *t_breed,
 	checkfileformat = get_parameter("checkpoint.filename");
 	checkfilename = (char *) MALLOC(strlen(checkfileformat) + 50);
 
+	/* steady-state runs breed each population in place. */
+	param = get_parameter("steady_state");
+	steady = (param && atoi(param));
+	if (steady && eval_engine == EVAL_ENGINE_STREAM)
+		error( E_FATAL_ERROR,
+				"eval.engine = stream needs generational breeding.");
+	param = get_parameter("bloat.opeq");
+	if (steady && param && atoi(param) > 0)
+		error( E_FATAL_ERROR, "bloat.opeq needs generational breeding.");
+
 	/* get the interval for writing information to the .stt file. */
 	stt_interval = atoi(get_parameter("output.stt_interval"));
 	if (stt_interval < 1)
@@ -117,6 +136,8 @@ void run_gp(multipop *mpop, int startgen, event *t_eval, event *t_breed,
 
 	oputs( OUT_SYS, 10, "\n\nstarting evolution.\n");
 
+	gen_eval_time = gen_breed_time = 0.0;
+
 	/* print out how often we'll be doing checkpointing. */
 	if (checkinterval > 0)
 		oprintf( OUT_SYS, 20,
@@ -128,6 +149,20 @@ void run_gp(multipop *mpop, int startgen, event *t_eval, event *t_breed,
 	else
 		oprintf( OUT_SYS, 20, "no checkpointing will be done.\n");
 
+	/* start the clock on the run's budgets. */
+	budget_begin(startfromcheckpoint);
+
+	/* checkpoints don't keep per-case errors; the first generation after
+	 one is bred without being evaluated, so score it again here. */
+	if (startfromcheckpoint)
+		restore_case_errors(mpop, startgen);
+
+	/* in steady-state runs, start the offspring workers.  (the
+	 scheduler's pool for whole populations outlives the run, so a batch
+	 of runs can share it.) */
+	if (steady)
+		async_begin(mpop);
+
 	/* the big loop. */
 	for (gen = startgen; gen < maxgen && !term; ++gen) {
 		oprintf( OUT_SYS, 20, "=== generation %d.\n", gen);
@@ -138,9 +173,11 @@ void run_gp(multipop *mpop, int startgen, event *t_eval, event *t_breed,
 
 			/* evaluate the population. */
 			event_mark(&start);
+			prof_begin(PROF_EVAL);
 			for (i = 0; i < mpop->size; ++i) { //generation_No = i;
 				evaluate_pop(mpop->pop[i]);
 			}
+			gen_eval_time = prof_end(PROF_EVAL) / 1e9;
 			event_mark(&end);
 			event_diff(&diff, &start, &end);
 
@@ -155,8 +192,10 @@ void run_gp(multipop *mpop, int startgen, event *t_eval, event *t_breed,
 
 			/* calculate and print statistics.  returns 1 if user termination
 			 criterion was met, 0 otherwise. */
+			prof_begin(PROF_STATS);
 			term = generation_information(gen, mpop, stt_interval,
 					run_stats[0].bestn);
+			prof_end(PROF_STATS);
 			if (term) {
 				//oprintf( OUT_SYS, 30, "user termination criterion met.\n");
 				/*extern float *optimal_in_generation;
@@ -177,32 +216,54 @@ void run_gp(multipop *mpop, int startgen, event *t_eval, event *t_breed,
 
 		}
 
+		/* stop if a budget has run out or the job is being preempted;
+		 otherwise the budget may lower maxgen. */
+		if (!term)
+			term = budget_stop(gen, &maxgen, mpop);
+
 		/** write a checkpoint file if checkinterval is non-negative and:
 		 we've reached the last generation, or
 		 the user termination criterion has been met, or
-		 we've reached the specified checkpoint interval. **/
-		if (checkinterval >= 0
+		 we've reached the specified checkpoint interval.
+		 a signal (SIGTERM or SIGUSR1) always gets a checkpoint. **/
+		if ((checkinterval >= 0
 				&& (gen == maxgen || term
 						|| (checkinterval > 0 && gen > startgen
-								&& (gen % checkinterval) == 0))) {
+								&& (gen % checkinterval) == 0)))
+				|| budget_checkpoint_due()) {
 			sprintf(checkfilename, checkfileformat, gen);
+			budget_save();
+			prof_begin(PROF_CHECKPOINT);
 			write_checkpoint(gen, mpop, checkfilename);
+			prof_end(PROF_CHECKPOINT);
 		}
 
 		/** if this is not the last generation and the user criterion hasn't
-		 been met, then do breeding. **/
-		if (gen != maxgen && !term) {
+		 been met, then do breeding.  steady-state breeding evaluates as it
+		 goes, so it is skipped after the last generation. **/
+		if (gen != maxgen && !term && !(steady && gen + 1 == maxgen)) {
 
 			/** exchange subpops if it's time. **/
 			if (mpop->size > 1 && gen && (gen % exch_gen) == 0) {
+				prof_begin(PROF_EXCHANGE);
 				exchange_subpopulations(mpop);
+				prof_end(PROF_EXCHANGE);
 				oprintf( OUT_SYS, 10, "    subpopulation exchange complete.\n");
 			}
 
 			/* breed the new population. */
 			event_mark(&start);
-			for (i = 0; i < mpop->size; ++i)
-				mpop->pop[i] = change_population(mpop->pop[i], mpop->bpt[i]);
+			prof_begin(PROF_BREED);
+			if (steady) {
+				/* the offspring belong to the next generation. */
+				generation_No = gen + 1;
+				for (i = 0; i < mpop->size; ++i)
+					steady_state_population(mpop, i);
+			} else
+				for (i = 0; i < mpop->size; ++i)
+					mpop->pop[i] = change_population(mpop->pop[i],
+							mpop->bpt[i]);
+			gen_breed_time = prof_end(PROF_BREED) / 1e9;
 			event_mark(&end);
 			event_diff(&diff, &start, &end);
 
@@ -221,7 +282,12 @@ void run_gp(multipop *mpop, int startgen, event *t_eval, event *t_breed,
 		}
 
 		/* free unused ERCs. */
+		prof_begin(PROF_ERCGC);
 		ephem_const_gc();
+		prof_end(PROF_ERCGC);
+
+		/* report (and reset) the per-generation profile. */
+		prof_end_generation(gen);
 
 		flush_output_streams();
 
@@ -232,8 +298,14 @@ void run_gp(multipop *mpop, int startgen, event *t_eval, event *t_breed,
 	if (checkfilename)
 		FREE(checkfilename);
 
+	async_end();
+	budget_end();
 	ephem_const_gc();
 
+	best_fitness = run_stats[0].best[0]->ind->s_fitness;
+	best_hits = run_stats[0].best[0]->ind->hits;
+	best_gen = run_stats[0].bestgen;
+
 	for (i = 0; i < mpop->size + 1; ++i) {
 		for (j = 0; j < run_stats[i].bestn; ++j)
 			--run_stats[i].best[j]->refcount;
@@ -383,6 +455,10 @@ int generation_information(int gen, multipop *mpop, int stt_interval, int bestn)
 	/* merge stats for current generation into overall run stats. */
 	newbest = accumulate_pop_stats(run_stats, gen_stats);
 
+	/* machine-readable copy of the generation stats, if requested. */
+	write_generation_records(gen, mpop->size, gen_stats, gen_eval_time,
+			gen_breed_time);
+
 	/** more printing. **/
 
 	if (test_detail_level(90)) {
@@ -569,6 +645,18 @@ int generation_information(int gen, multipop *mpop, int stt_interval, int bestn)
 
 }
 
+/* run_best()
+ *
+ * the standardized fitness and hits of the best individual of the last run,
+ * and the generation it was found in.
+ */
+
+void run_best(double *fitness, int *hits, int *gen) {
+	*fitness = best_fitness;
+	*hits = best_hits;
+	*gen = best_gen;
+}
+
 /* evaluate_pop()
  *
  * evaluates all the individuals in a population whose cached
@@ -577,6 +665,7 @@ int generation_information(int gen, multipop *mpop, int stt_interval, int bestn)
 
 void evaluate_pop(population *pop) {
 	int k;
+	uint64_t t;
 
 #ifdef DEBUG
 	print_individual ( pop->ind, stdout );
@@ -584,46 +673,75 @@ void evaluate_pop(population *pop) {
 	exit(0);
 #endif
 
-	for (k = 0; k < pop->size; ++k) {
-		if (pop->ind[k].evald != EVAL_CACHE_VALID) {
-			population_No = k;
-			app_eval_fitness((pop->ind) + k);
+	/* individuals in the fitness cache need no evaluating. */
+	fitcache_fetch_pop(pop);
+	bloat_tarpeian_pop(pop);
+	budget_charge_pop(pop);
+
+	if (eval_engine == EVAL_ENGINE_DAG && cases.cases > 0)
+		dag_evaluate_pop(pop);
+	else if ((eval_engine == EVAL_ENGINE_TILED && cases.cases > 0)
+			|| eval_engine == EVAL_ENGINE_STREAM)
+		tile_evaluate_pop(pop);
+	else if (sched_running())
+		sched_evaluate_pop(pop);
+	else
+		for (k = 0; k < pop->size; ++k) {
+			if (pop->ind[k].evald != EVAL_CACHE_VALID) {
+				population_No = k;
+				if (prof_enabled) {
+					t = prof_now();
+					app_eval_fitness((pop->ind) + k);
+					prof_eval_sample(prof_now() - t);
+				} else
+					app_eval_fitness((pop->ind) + k);
+			}
 		}
-	}
+	bloat_tarpeian_end(pop);
+	fitcache_store_pop(pop);
 	if (generation_No != (generationSIZE - 1)) {
 		optimal_in_generation[generation_No + 1] = 1000;
 	}
-	if (optimal_in_generation[generation_No]
-			>= optimal_in_generation[generation_No - 1]) {
+	if (generation_No > 0
+			&& optimal_in_generation[generation_No]
+					>= optimal_in_generation[generation_No - 1]) {
 		same_optimal_count++;
 	} else {
 		same_optimal_count = 1;
 	}
-	if (same_optimal_count > 3) {
+	if (plateau_window <= 0) {
+		/* the plateau test is off ("stop.plateau"). */
+	} else if (same_optimal_count > plateau_window && app_input == NULL) {
+		/* streamed cases aren't in memory to score the optimum on. */
+		termination_override = 1;
+	} else if (same_optimal_count > plateau_window) {
 		//current_max_importance++;
 		printf("Printing File");
 		FILE *out_file = fopen("regress.asim", "w");
 		if (out_file) {
 			//output_stream_open( OUT_ERROR);
-			int i;
+			int i, j;
 			double v, dv, disp;
+			DATATYPE row[app_inputs];
 			float error = 0.0f;
+			set_input_row(row);
 			for (i = 0; i < fitness_cases; ++i) {
-				g.x = app_fitness_cases[0][i];
+				for (j = 0; j < app_inputs; ++j)
+					row[j] = app_input[j][i];
 				v =
 						evaluate_tree(
 								((pop->ind)
 										+ optimal_index_in_generation[generation_No])->tr[0].data,
 								0);
-				dv = app_fitness_cases[1][i];
+				dv = app_target[i];
 				disp = fabs(dv - v);
 				error += disp;
 
 			}
 			error = error / fitness_cases;
-			fprintf( out_file, 50, "%f", (float)g.x);
-			fprintf( out_file, 50, " %f", (float) error);
-			fprintf( out_file, 50, "\n");
+			fprintf(out_file, "%f", (float) row[0]);
+			fprintf(out_file, " %f", (float) error);
+			fprintf(out_file, "\n");
 			fclose(out_file);
 		//	output_stream_close( OUT_ERROR);
 			termination_override = 1;
@@ -723,6 +841,7 @@ void calculate_pop_stats(popstats *s, population *pop, int gen, int subpop) {
 		shp = (saved_ind *) MALLOC(sizeof(saved_ind));
 		shp->ind = (individual *) MALLOC(sizeof(individual));
 		shp->ind->tr = (tree *) MALLOC(tree_count * sizeof(tree));
+		shp->ind->errors = NULL;
 		duplicate_individual(shp->ind, temp[i]);
 		for (j = 0; j < tree_count; ++j)
 			reference_ephem_constants(shp->ind->tr[j].data, 1);
@@ -98,7 +98,7 @@ int individual_depth ( individual *ind )
 
      for ( j = 0; j < tree_count; ++j )
      {
-          if ( ( i = tree_depth ( ind->tr[j].data ) ) > k )
+          if ( ( i = ind->tr[j].depth ) > k )
                k = i;
      }
      return k;
@@ -120,5 +120,6 @@ void duplicate_individual ( individual *to, individual *from )
      to->hits = from->hits;
      to->evald = from->evald;
      to->flags = from->flags;
+     copy_case_errors ( to, from );
 }
 
@@ -0,0 +1,414 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+
+#include "lilgp.h"
+
+/* native code generation for individuals.
+ *
+ * an individual's tree is lowered to x86-64 machine code in an mmap'd
+ * buffer, giving a function that takes a pointer to the current fitness
+ * case's inputs and returns the tree's value.  the arithmetic primitives
+ * (as marked by the prim field of the function table) are emitted
+ * inline; input terminals load from the input vector; ERCs become
+ * constants; sin, cos and exp call the C library directly.  any other
+ * data function or normal terminal is called through its code pointer,
+ * with its arguments laid out in a farg array on the stack, so its
+ * semantics are exactly those of evaluate_tree().
+ *
+ * trees containing FUNC_EXPR, EVAL_* or argument nodes are not compiled;
+ * jit_compile() returns NULL for them and the caller falls back to
+ * evaluate_tree().
+ *
+ * the generated code keeps each intermediate value in xmm0, spilling to
+ * a stack slot per level of the tree, since any call clobbers all the
+ * xmm registers anyway.
+ *
+ * only one compiled function exists at a time -- each call to
+ * jit_compile() reuses the buffer.
+ */
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define JIT_AVAILABLE
+#include <sys/mman.h>
+#endif
+
+int jit_enabled = 0;
+static int jit_min_cases;
+
+/* each evaluation thread compiles into its own buffer. */
+static THREAD_LOCAL unsigned char *code_buffer = NULL;
+static THREAD_LOCAL size_t code_size = 0;
+static THREAD_LOCAL unsigned char *pc;
+static THREAD_LOCAL int max_slot;
+
+static long jit_compiled = 0;
+static long jit_fallback = 0;
+static int prof_compile = -1;
+
+/* initialize_jit()
+ *
+ * reads the jit parameters.
+ */
+
+void initialize_jit ( void )
+{
+     char *param;
+
+     param = get_parameter ( "jit" );
+     jit_enabled = ( param && atoi ( param ) );
+     param = get_parameter ( "jit.min_cases" );
+     jit_min_cases = param ? atoi ( param ) : JIT_MINCASES;
+     
+     if ( !jit_enabled )
+          return;
+
+     /* made here, since evaluation threads can't add counters. */
+     if ( prof_enabled )
+          prof_compile = prof_counter ( "jit.compile", 0 );
+     
+#ifdef JIT_AVAILABLE
+     if ( sizeof ( DATATYPE ) != sizeof ( double ) )
+     {
+          error ( E_WARNING, "jit needs DATATYPE to be double; disabled." );
+          jit_enabled = 0;
+     }
+#else
+     error ( E_WARNING, "no jit for this platform; disabled." );
+     jit_enabled = 0;
+#endif
+}
+
+/* free_jit()
+ *
+ * release the calling thread's code buffer.
+ */
+
+void free_jit ( void )
+{
+#ifdef JIT_AVAILABLE
+     if ( code_buffer )
+          munmap ( code_buffer, code_size );
+#endif
+     code_buffer = NULL;
+     code_size = 0;
+}
+
+/* jit_wanted()
+ *
+ * says whether an individual about to be evaluated over the given number
+ * of cases should be compiled.
+ */
+
+int jit_wanted ( int cases )
+{
+     return jit_enabled && cases >= jit_min_cases;
+}
+
+/* output_jit_stats()
+ *
+ * print the compilation counts at the end of the run.
+ */
+
+void output_jit_stats ( void )
+{
+     if ( !jit_enabled )
+          return;
+     oprintf ( OUT_SYS, 30, "\n------- jit -------\n" );
+     oprintf ( OUT_SYS, 30, "            compiled:      %ld\n", jit_compiled );
+     oprintf ( OUT_SYS, 30, "        not compiled:      %ld\n", jit_fallback );
+}
+
+#ifdef JIT_AVAILABLE
+
+/* instruction emitters. */
+
+static void emit ( int n, ... )
+{
+     va_list ap;
+     int i;
+     va_start ( ap, n );
+     for ( i = 0; i < n; ++i )
+          *pc++ = (unsigned char)va_arg ( ap, int );
+     va_end ( ap );
+}
+
+static void emit32 ( int32_t v )
+{
+     memcpy ( pc, &v, 4 );
+     pc += 4;
+}
+
+static void emit64 ( uint64_t v )
+{
+     memcpy ( pc, &v, 8 );
+     pc += 8;
+}
+
+/* movsd [rsp+slot*8], xmm0 */
+static void emit_store ( int slot )
+{
+     emit ( 5, 0xf2, 0x0f, 0x11, 0x84, 0x24 );
+     emit32 ( slot * 8 );
+}
+
+/* movsd xmm0, [rsp+slot*8] */
+static void emit_load ( int slot )
+{
+     emit ( 5, 0xf2, 0x0f, 0x10, 0x84, 0x24 );
+     emit32 ( slot * 8 );
+}
+
+/* mov rax, imm64 */
+static void emit_movrax ( uint64_t v )
+{
+     emit ( 2, 0x48, 0xb8 );
+     emit64 ( v );
+}
+
+/* load a constant into xmm0. */
+static void emit_const ( DATATYPE d )
+{
+     uint64_t bits;
+     memcpy ( &bits, &d, 8 );
+     emit_movrax ( bits );
+     /* movq xmm0, rax */
+     emit ( 5, 0x66, 0x48, 0x0f, 0x6e, 0xc0 );
+}
+
+/* call an absolute address. */
+static void emit_call ( void *fn )
+{
+     emit_movrax ( (uint64_t)(uintptr_t)fn );
+     /* call rax */
+     emit ( 2, 0xff, 0xd0 );
+}
+
+/* compile_recurse()
+ *
+ * emits code leaving the value of the subtree at *l in xmm0.  the code
+ * may use the stack slots from base upward.  returns 0 if the subtree
+ * contains something that can't be compiled.
+ */
+
+static int compile_recurse ( lnode **l, int base, int whichtree )
+{
+     function *f = LNODE_F(**l);
+     int i, inline_prim;
+     unsigned char *skip, *done;
+
+     ++*l;
+
+     switch ( f->type )
+     {
+        case TERM_ERC:
+          emit_const ( ERC_VALUE(**l) );
+          ++*l;
+          return 1;
+          
+        case TERM_NORM:
+          if ( f->prim == PRIM_INPUT )
+          {
+               /* movsd xmm0, [rbx+input*8] */
+               emit ( 4, 0xf2, 0x0f, 0x10, 0x83 );
+               emit32 ( f->input * 8 );
+          }
+          else
+          {
+               /* mov edi, whichtree; xor esi, esi */
+               emit ( 1, 0xbf );
+               emit32 ( whichtree );
+               emit ( 2, 0x31, 0xf6 );
+               emit_call ( f->code );
+          }
+          return 1;
+          
+        case FUNC_DATA:
+          break;
+          
+        default:
+          return 0;
+     }
+
+     inline_prim = ( f->prim >= PRIM_ADD && f->prim <= PRIM_EXP );
+     
+     /* evaluate the children into consecutive slots, which form the
+	farg array for a called function.  an inlined primitive takes
+	its last operand in xmm0. */
+     for ( i = 0; i < f->arity; ++i )
+     {
+          if ( !compile_recurse ( l, base+i, whichtree ) )
+               return 0;
+          if ( i < f->arity-1 || !inline_prim )
+               emit_store ( base+i );
+     }
+     if ( base+f->arity > max_slot )
+          max_slot = base+f->arity;
+
+     switch ( f->prim )
+     {
+        case PRIM_ADD:
+        case PRIM_SUB:
+        case PRIM_MUL:
+        case PRIM_PDIV:
+          /* movsd xmm1, xmm0 */
+          emit ( 4, 0xf2, 0x0f, 0x10, 0xc8 );
+          emit_load ( base );
+          break;
+     }
+     
+     switch ( f->prim )
+     {
+        case PRIM_ADD:
+          /* addsd xmm0, xmm1 */
+          emit ( 4, 0xf2, 0x0f, 0x58, 0xc1 );
+          break;
+        case PRIM_SUB:
+          /* subsd xmm0, xmm1 */
+          emit ( 4, 0xf2, 0x0f, 0x5c, 0xc1 );
+          break;
+        case PRIM_MUL:
+          /* mulsd xmm0, xmm1 */
+          emit ( 4, 0xf2, 0x0f, 0x59, 0xc1 );
+          break;
+        case PRIM_PDIV:
+          /* if the divisor is 0.0 the result is 1.0.  (unordered
+	     compares are not equal, as in C.) */
+          /* xorpd xmm2, xmm2; ucomisd xmm1, xmm2 */
+          emit ( 8, 0x66, 0x0f, 0x57, 0xd2, 0x66, 0x0f, 0x2e, 0xca );
+          /* jp div; jne div */
+          emit ( 4, 0x7a, 0x00, 0x75, 0x00 );
+          skip = pc;
+          emit_const ( 1.0 );
+          /* jmp done */
+          emit ( 2, 0xeb, 0x00 );
+          done = pc;
+          skip[-3] = (unsigned char)( pc - ( skip - 2 ) );
+          skip[-1] = (unsigned char)( pc - skip );
+          /* divsd xmm0, xmm1 */
+          emit ( 4, 0xf2, 0x0f, 0x5e, 0xc1 );
+          done[-1] = (unsigned char)( pc - done );
+          break;
+        case PRIM_SIN:
+          emit_call ( (void *)sin );
+          break;
+        case PRIM_COS:
+          emit_call ( (void *)cos );
+          break;
+        case PRIM_EXP:
+          emit_call ( (void *)exp );
+          break;
+        default:
+          /* call the user code:  code ( whichtree, &slot[base] ). */
+          emit ( 1, 0xbf );
+          emit32 ( whichtree );
+          /* lea rsi, [rsp+base*8] */
+          emit ( 4, 0x48, 0x8d, 0xb4, 0x24 );
+          emit32 ( base * 8 );
+          emit_call ( f->code );
+          break;
+     }
+
+     return 1;
+}
+
+#endif
+
+/* jit_compile()
+ *
+ * compiles the tree to native code.  returns NULL if the tree can't be
+ * compiled.  the function returned is valid until the next call.
+ */
+
+jit_function jit_compile ( lnode *data, int whichtree )
+{
+#ifdef JIT_AVAILABLE
+     lnode *l = data;
+     unsigned char *frame;
+     size_t need;
+     int n, ok;
+     uint64_t start = 0;
+
+     if ( prof_enabled )
+          start = prof_now();
+     
+     /* no lnode expands to more than 64 bytes of code. */
+     n = tree_size ( data );
+     need = ( n + 4 ) * 64;
+     if ( need > code_size )
+     {
+          free_jit();
+          code_size = ( need + 4095 ) & ~(size_t)4095;
+          code_buffer = mmap ( NULL, code_size, PROT_READ|PROT_WRITE,
+                              MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+          if ( code_buffer == MAP_FAILED )
+          {
+               code_buffer = NULL;
+               code_size = 0;
+               error ( E_WARNING, "can't map jit buffer; jit disabled." );
+               jit_enabled = 0;
+               return NULL;
+          }
+     }
+     else
+          mprotect ( code_buffer, code_size, PROT_READ|PROT_WRITE );
+
+     pc = code_buffer;
+     max_slot = 0;
+
+     /* push rbx; mov rbx, rdi; sub rsp, frame */
+     emit ( 7, 0x53, 0x48, 0x89, 0xfb, 0x48, 0x81, 0xec );
+     frame = pc;
+     emit32 ( 0 );
+
+     ok = compile_recurse ( &l, 0, whichtree );
+
+     /* the frame is a multiple of 16, so that calls see an aligned
+	stack (rsp is aligned after pushing rbx). */
+     n = ( max_slot * 8 + 15 ) & ~15;
+     memcpy ( frame, &n, 4 );
+     /* add rsp, frame; pop rbx; ret */
+     emit ( 3, 0x48, 0x81, 0xc4 );
+     emit32 ( n );
+     emit ( 2, 0x5b, 0xc3 );
+
+     mprotect ( code_buffer, code_size, PROT_READ|PROT_EXEC );
+
+     if ( prof_enabled )
+          prof_add ( prof_compile, start, prof_now() - start, 1 );
+
+     if ( !ok )
+     {
+          ATOMIC_ADD ( jit_fallback, 1 );
+          return NULL;
+     }
+     ATOMIC_ADD ( jit_compiled, 1 );
+     return (jit_function)(void *)code_buffer;
+#else
+     return NULL;
+#endif
+}
@@ -0,0 +1,956 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+#include "lilgp.h"
+
+/* per-case errors and lexicase selection.
+ *
+ * with "case_errors" set, every individual keeps its error on each
+ * fitness case (as the app reports it with case_error()) in a row of
+ * its own, alongside its fitness.  "case_errors = float" keeps them in
+ * single precision; "case_errors = quantized" in 16 bits, on a log
+ * scale good to about 0.05% of the error.  the rows aren't kept in the
+ * fitness cache, so the cache isn't used with them, and aren't saved
+ * in checkpoints -- a population read from one is scored again.
+ *
+ * the "lexicase" selection method uses them.  each selection shuffles
+ * the cases and starts with the whole population; one case at a time,
+ * the candidates not within epsilon of the best of them on that case
+ * are dropped, until one is left or the cases run out (when one of
+ * those left is picked at random).  options:
+ *
+ *   "epsilon"    "mad" for epsilon-lexicase:  each case's epsilon is
+ *                the median absolute deviation of the population's
+ *                errors on it.  or a fixed epsilon; default 0, plain
+ *                lexicase.
+ *
+ * "epsilon_lexicase" is the same method with epsilon defaulting to
+ * "mad".
+ *
+ * done naively a selection costs a pass over the population per case.
+ * instead the selection context works out, the first time a case is
+ * drawn in the generation, its epsilon, the population's best error on
+ * it, and a few bitsets:  level j holds the individuals within j
+ * quarter-epsilons of that best.  if the best of the candidates is on
+ * level j (and not below), those on level j+3 all stay and those past
+ * level j+4 all go, so filtering the candidates is mostly word-wise
+ * ANDs; only two thin bands have their errors looked at.  (while the
+ * candidates include one of the case's best, that's a single AND with
+ * level 4.)  once few enough are left they are kept as a list, and
+ * filtered by looking at their own rows of errors.  cases are shuffled
+ * lazily, as they are used.
+ *
+ * the last few candidates are often within epsilon of each other on
+ * every case left, and would be carried through all of them.  so once
+ * there are few, the cases left that can't drop any of them are set
+ * aside:  such a case can't drop any of fewer candidates either, and
+ * the cases that can come in a random order all the same.
+ */
+
+/* the levels kept for each case, and how many make an epsilon (a power
+   of two, so that they add up to it exactly). */
+#define LEXICASE_LEVELS   16
+#define LEXICASE_SPLIT    4
+
+/* cases whose errors are laid out together, a few cache lines of each
+   row at a time. */
+#define LEXICASE_BLOCK    64
+
+/* how few candidates make it worth setting aside the cases that can't
+   drop any of them. */
+#define LEXICASE_TAIL     8
+
+/* how far a case's context has been worked out. */
+#define CASE_NONE         0
+#define CASE_EPSILON      1
+#define CASE_LEVELS       2
+
+int case_error_format = CASE_ERRORS_NONE;
+
+/* the length of a row. */
+static int error_cases = 0;
+
+/* the error each quantized key stands for. */
+static double *quantized_error = NULL;
+
+/* statistics. */
+static long lexicase_selections = 0;
+static long lexicase_cases_used = 0;
+static long lexicase_scans = 0;
+
+typedef struct
+{
+     int mad;
+     double epsilon;
+     int n;
+     int words;        /* in a bitset of the population */
+     uint32_t *key;    /* the errors as ordered keys, case by case */
+     double *eps;      /* each case's epsilon */
+     int levels;
+     int split;
+     uint32_t *top;    /* each case's largest key on each level */
+     uint64_t *level;  /* each case's bitsets of the individuals on each
+                          level (or a lower one) */
+     char *laid;       /* each block of cases:  are its keys laid out? */
+     char *ready;      /* each case:  CASE_NONE, _EPSILON or _LEVELS */
+     int *order;       /* the cases, shuffled as they are used */
+     uint64_t *pool;   /* the candidates, as a bitset... */
+     int *list;        /* ...or, when few, a list */
+     uint32_t *scratch;
+} lexicase_data;
+
+/* bit_count()
+ *
+ * returns the number of bits set in a word.
+ */
+
+static int bit_count ( uint64_t m )
+{
+#ifdef __GNUC__
+     return __builtin_popcountll ( m );
+#else
+     int b = 0;
+     while ( m )
+     {
+          m &= m - 1;
+          ++b;
+     }
+     return b;
+#endif
+}
+
+/* lowest_bit()
+ *
+ * returns the index of the lowest set bit of a nonzero word.
+ */
+
+static int lowest_bit ( uint64_t m )
+{
+#ifdef __GNUC__
+     return __builtin_ctzll ( m );
+#else
+     int b = 0;
+     while ( !( m & 1 ) )
+     {
+          m >>= 1;
+          ++b;
+     }
+     return b;
+#endif
+}
+
+/* initialize_case_errors()
+ *
+ * reads the "case_errors" parameter.  called once the fitness cases
+ * are registered.
+ */
+
+void initialize_case_errors ( void )
+{
+     char *param = get_parameter ( "case_errors" );
+     int i;
+
+     if ( param == NULL || strcmp ( param, "none" ) == 0 )
+          case_error_format = CASE_ERRORS_NONE;
+     else if ( strcmp ( param, "float" ) == 0 )
+          case_error_format = CASE_ERRORS_FLOAT;
+     else if ( strcmp ( param, "quantized" ) == 0 )
+          case_error_format = CASE_ERRORS_QUANTIZED;
+     else
+          error ( E_FATAL_ERROR, "\"case_errors\" must be none, float or quantized." );
+
+     if ( case_error_format == CASE_ERRORS_NONE )
+          return;
+
+     /* streamed cases are numbered through the whole dataset. */
+     error_cases = eval_engine == EVAL_ENGINE_STREAM ? stream_rows() : cases.cases;
+     if ( error_cases <= 0 )
+          error ( E_FATAL_ERROR, "\"case_errors\" needs fitness cases registered." );
+     if ( case_error_format == CASE_ERRORS_QUANTIZED && !quantized_error )
+     {
+          quantized_error = (double *)MALLOC ( 65536 * sizeof ( double ) );
+          for ( i = 0; i < 65536; ++i )
+               quantized_error[i] = expm1 ( i / CASE_ERROR_QSCALE );
+     }
+     oprintf ( OUT_SYS, 30, "    per-case errors kept:  %d cases, %s.\n",
+              error_cases, param );
+}
+
+/* alloc_case_errors()
+ *
+ * returns a new row for an individual, or NULL if none are kept.
+ */
+
+void *alloc_case_errors ( void )
+{
+     switch ( case_error_format )
+     {
+        case CASE_ERRORS_FLOAT:
+          return MALLOC ( error_cases * sizeof ( float ) );
+        case CASE_ERRORS_QUANTIZED:
+          return MALLOC ( error_cases * sizeof ( uint16_t ) );
+     }
+     return NULL;
+}
+
+/* copy_case_errors()
+ *
+ * copies one individual's row into another's.
+ */
+
+void copy_case_errors ( individual *to, individual *from )
+{
+     if ( to->errors == NULL || from->errors == NULL )
+          return;
+     memcpy ( to->errors, from->errors, error_cases *
+             ( case_error_format == CASE_ERRORS_FLOAT ? sizeof ( float ) :
+              sizeof ( uint16_t ) ) );
+}
+
+/* quantize()
+ *
+ * the 16-bit code for an error.
+ */
+
+static uint16_t quantize ( double e )
+{
+     double q = log1p ( e ) * CASE_ERROR_QSCALE;
+
+     if ( !( q > 0.0 ) )
+          return 0;
+     if ( q >= 65535.0 )
+          return 65535;
+     return (uint16_t)( q + 0.5 );
+}
+
+/* case_error()
+ *
+ * records an individual's error on case c.  called by the app as it
+ * scores each case; does nothing if errors aren't kept.  streamed cases
+ * are numbered within their chunk, and are stored by dataset row.
+ */
+
+void case_error ( individual *ind, int c, double e )
+{
+     if ( ind->errors == NULL )
+          return;
+     if ( eval_engine == EVAL_ENGINE_STREAM )
+          c += stream_offset();
+     if ( case_error_format == CASE_ERRORS_FLOAT )
+          ((float *)ind->errors)[c] = e;
+     else
+          ((uint16_t *)ind->errors)[c] = quantize ( e );
+}
+
+/* worst_case_errors()
+ *
+ * gives an individual that isn't evaluated the worst error on every
+ * case.
+ */
+
+void worst_case_errors ( individual *ind )
+{
+     int c;
+
+     for ( c = 0; c < error_cases && ind->errors; ++c )
+          case_error ( ind, c, HUGE_VAL );
+}
+
+/* restore_case_errors()
+ *
+ * gives the individuals of a population read from a checkpoint their
+ * rows, and scores them again to fill them in.  their fitness comes out
+ * the same.
+ */
+
+void restore_case_errors ( multipop *mpop, int gen )
+{
+     individual *ind;
+     int i, k;
+
+     if ( case_error_format == CASE_ERRORS_NONE )
+          return;
+
+     generation_No = gen;
+     for ( i = 0; i < mpop->size; ++i )
+          for ( k = 0; k < mpop->pop[i]->size; ++k )
+          {
+               ind = mpop->pop[i]->ind+k;
+               if ( ind->errors == NULL )
+                    ind->errors = alloc_case_errors();
+               if ( ind->flags & FLAG_TARPEIAN )
+                    worst_case_errors ( ind );
+               else if ( ind->evald == EVAL_CACHE_VALID )
+               {
+                    population_No = k;
+                    app_eval_fitness ( ind );
+               }
+          }
+}
+
+/* error_key()
+ *
+ * individual i's error on case c, as an unsigned key in the same order
+ * as the errors.  (the bits of a non-negative float already are.)
+ */
+
+static uint32_t error_key ( individual *ind, int c )
+{
+     uint32_t k;
+
+     if ( case_error_format == CASE_ERRORS_FLOAT )
+     {
+          memcpy ( &k, (float *)ind->errors + c, sizeof ( k ) );
+          return k;
+     }
+     return ((uint16_t *)ind->errors)[c];
+}
+
+/* key_error()
+ *
+ * the error a key stands for.
+ */
+
+static double key_error ( uint32_t k )
+{
+     float f;
+
+     if ( case_error_format == CASE_ERRORS_FLOAT )
+     {
+          memcpy ( &f, &k, sizeof ( f ) );
+          return f;
+     }
+     return quantized_error[k];
+}
+
+/* threshold()
+ *
+ * the largest key within epsilon of the key low:  a key above it
+ * stands for an error more than epsilon above low's.
+ */
+
+static uint32_t threshold ( uint32_t low, double eps )
+{
+     double e;
+     float f;
+     uint32_t k;
+
+     if ( eps <= 0.0 )
+          return low;
+     e = key_error ( low ) + eps;
+     if ( case_error_format == CASE_ERRORS_FLOAT )
+     {
+          f = e;
+          if ( f > e )
+               f = nextafterf ( f, 0.0f );
+          memcpy ( &k, &f, sizeof ( k ) );
+          return k;
+     }
+     e = floor ( log1p ( e ) * CASE_ERROR_QSCALE + 1e-9 );
+     return e >= 65535.0 ? 65535 : (uint32_t)e;
+}
+
+/* kth_smallest()
+ *
+ * the k-th smallest of a[0..n-1] (counting from 0), a byte at a time
+ * from the top:  the values sharing the digits found so far are packed
+ * to the front and counted by their next byte.  reorders a.
+ */
+
+static uint32_t kth_smallest ( uint32_t *a, int n, int k )
+{
+     int count[256];
+     uint32_t prefix = 0, mask = 0;
+     int shift, b, i, m;
+
+     for ( shift = 24; shift >= 0; shift -= 8 )
+     {
+          for ( i = m = 0; i < n; ++i )
+          {
+               a[m] = a[i];
+               m += ( a[i] & mask ) == prefix;
+          }
+          n = m;
+          memset ( count, 0, sizeof ( count ) );
+          for ( i = 0; i < n; ++i )
+               ++count[( a[i] >> shift ) & 255];
+          for ( b = 0; k >= count[b]; ++b )
+               k -= count[b];
+          prefix |= (uint32_t)b << shift;
+          mask |= (uint32_t)255 << shift;
+     }
+     return prefix;
+}
+
+/* lay_out()
+ *
+ * copies the keys of the block of cases holding case c out of the
+ * individuals' rows, case by case.
+ */
+
+static void lay_out ( lexicase_data *ld, population *p, int c )
+{
+     int c0 = c - c % LEXICASE_BLOCK, c1 = c0 + LEXICASE_BLOCK;
+     int i;
+
+     if ( c1 > error_cases )
+          c1 = error_cases;
+     for ( i = 0; i < ld->n; ++i )
+          for ( c = c0; c < c1; ++c )
+               ld->key[(size_t)c * ld->n + i] = error_key ( p->ind+i, c );
+     ld->laid[c0 / LEXICASE_BLOCK] = 1;
+}
+
+/* case_epsilon()
+ *
+ * works out case c's epsilon.
+ */
+
+static void case_epsilon ( lexicase_data *ld, population *p, int c )
+{
+     uint32_t *key, k;
+     double median;
+     float d;
+     int i;
+
+     if ( !ld->laid[c / LEXICASE_BLOCK] )
+          lay_out ( ld, p, c );
+     ld->ready[c] = CASE_EPSILON;
+     if ( !ld->mad )
+     {
+          ld->eps[c] = ld->epsilon;
+          return;
+     }
+
+     /* the median absolute deviation, found among keys (the bits of
+	the non-negative deviations order them too). */
+     key = ld->key + (size_t)c * ld->n;
+     memcpy ( ld->scratch, key, ld->n * sizeof ( uint32_t ) );
+     median = key_error ( kth_smallest ( ld->scratch, ld->n, ld->n / 2 ) );
+     for ( i = 0; i < ld->n; ++i )
+     {
+          d = fabs ( key_error ( key[i] ) - median );
+	  /* (two unevaluated individuals' infinite errors.) */
+          if ( d != d )
+               d = 0.0f;
+          memcpy ( ld->scratch+i, &d, sizeof ( d ) );
+     }
+     k = kth_smallest ( ld->scratch, ld->n, ld->n / 2 );
+     memcpy ( &d, &k, sizeof ( d ) );
+     ld->eps[c] = d < HUGE_VAL ? d : 0.0;
+}
+
+/* case_levels()
+ *
+ * works out case c's levels:  each individual goes on the lowest
+ * level it is within (guessed from its error, then checked against
+ * the levels' keys), and each level then takes in the one below.
+ */
+
+static void case_levels ( lexicase_data *ld, population *p, int c )
+{
+     uint32_t *key, *top;
+     uint64_t *level;
+     uint32_t low;
+     double base, scale, d;
+     int i, j, last;
+
+     if ( ld->ready[c] == CASE_NONE )
+          case_epsilon ( ld, p, c );
+     key = ld->key + (size_t)c * ld->n;
+     top = ld->top + c * ld->levels;
+     level = ld->level + (size_t)c * ld->levels * ld->words;
+
+     low = key[0];
+     for ( i = 1; i < ld->n; ++i )
+          if ( key[i] < low )
+               low = key[i];
+     for ( j = 0; j < ld->levels; ++j )
+          top[j] = threshold ( low, j * ld->eps[c] / ld->split );
+
+     memset ( level, 0, ld->levels * ld->words * sizeof ( uint64_t ) );
+     last = ld->levels - 1;
+     base = key_error ( low );
+     scale = ld->eps[c] > 0.0 ? ld->split / ld->eps[c] : 0.0;
+     for ( i = 0; i < ld->n; ++i )
+     {
+          if ( key[i] > top[last] )
+               continue;
+          d = ( key_error ( key[i] ) - base ) * scale;
+          j = d >= 0.0 && d < last ? (int)d : last;
+          while ( j > 0 && key[i] <= top[j-1] )
+               --j;
+          while ( key[i] > top[j] )
+               ++j;
+          level[j*ld->words + i/64] |= (uint64_t)1 << ( i % 64 );
+     }
+     for ( j = 1; j < ld->levels; ++j )
+          for ( i = 0; i < ld->words; ++i )
+               level[j*ld->words+i] |= level[(j-1)*ld->words+i];
+     ld->ready[c] = CASE_LEVELS;
+}
+
+/* lexicase_update()
+ *
+ * takes account of a new individual in slot i.  a new best on a case
+ * has the case worked out again when it is next drawn; otherwise the
+ * slot's bits are set afresh, and the case's epsilon stays as it was.
+ * cases not laid out yet are read from the rows when they are.
+ */
+
+static void lexicase_update ( lexicase_data *ld, population *p, int i )
+{
+     uint64_t bit = (uint64_t)1 << ( i % 64 );
+     uint64_t *level;
+     uint32_t k;
+     int c, j;
+
+     for ( c = 0; c < error_cases; ++c )
+     {
+          if ( !ld->laid[c / LEXICASE_BLOCK] )
+               continue;
+          k = error_key ( p->ind+i, c );
+          ld->key[(size_t)c * ld->n + i] = k;
+          if ( ld->ready[c] != CASE_LEVELS )
+               continue;
+          if ( k < ld->top[c * ld->levels] )
+          {
+               ld->ready[c] = CASE_NONE;
+               continue;
+          }
+	  /* if this was a case's only best, level 0 is left empty, and
+	     the best left is found on a higher level. */
+          level = ld->level + (size_t)c * ld->levels * ld->words + i / 64;
+          for ( j = 0; j < ld->levels; ++j )
+               if ( k <= ld->top[c * ld->levels + j] )
+                    level[j*ld->words] |= bit;
+               else
+                    level[j*ld->words] &= ~bit;
+     }
+}
+
+/* select_lexicase_context()
+ *
+ * returns a selection context for the lexicase method.
+ */
+
+sel_context *select_lexicase_context ( int op, sel_context *sc,
+                                      population *p, char *string )
+{
+     char **argv;
+     int i, j, c;
+     lexicase_data *ld;
+
+     switch ( op )
+     {
+        case SELECT_INIT:
+
+          if ( case_error_format == CASE_ERRORS_NONE )
+               error ( E_FATAL_ERROR,
+                      "lexicase selection needs \"case_errors\" set.  (%s)",
+                      string );
+
+          sc = (sel_context *)MALLOC ( sizeof ( sel_context ) );
+          sc->p = p;
+          sc->select_method = select_lexicase;
+          sc->context_method = select_lexicase_context;
+
+          ld = (lexicase_data *)MALLOC ( sizeof ( lexicase_data ) );
+          ld->mad = 0;
+          ld->epsilon = 0.0;
+          j = parse_o_rama ( string, &argv );
+          for ( i = 1; i < j; ++i )
+          {
+               if ( strcmp ( argv[i], "epsilon" ) == 0 )
+               {
+                    ++i;
+                    ld->mad = strcmp ( argv[i], "mad" ) == 0;
+                    if ( !ld->mad )
+                         ld->epsilon = strtod ( argv[i], NULL );
+               }
+               else
+                    error ( E_FATAL_ERROR, "unknown lexicase option \"%s\".",
+                           argv[i] );
+          }
+	  free_o_rama ( j, &argv );
+
+          if ( ld->epsilon < 0.0 )
+               error ( E_FATAL_ERROR,
+                      "lexicase epsilon can't be negative.  (%s)", string );
+
+          ld->n = p->size;
+          ld->words = ( p->size + 63 ) / 64;
+          ld->key = (uint32_t *)MALLOC ( (size_t)error_cases * ld->n *
+                                        sizeof ( uint32_t ) );
+          ld->eps = (double *)MALLOC ( error_cases * sizeof ( double ) );
+	  /* with no epsilon, the levels would all be level 0. */
+          if ( ld->mad || ld->epsilon > 0.0 )
+          {
+               ld->levels = LEXICASE_LEVELS;
+               ld->split = LEXICASE_SPLIT;
+          }
+          else
+          {
+               ld->levels = 2;
+               ld->split = 1;
+          }
+          ld->top = (uint32_t *)MALLOC ( error_cases * ld->levels *
+                                        sizeof ( uint32_t ) );
+          ld->level = (uint64_t *)MALLOC ( (size_t)error_cases * ld->levels *
+                                          ld->words * sizeof ( uint64_t ) );
+          ld->laid = (char *)MALLOC ( error_cases / LEXICASE_BLOCK + 1 );
+          ld->ready = (char *)MALLOC ( error_cases );
+          ld->order = (int *)MALLOC ( error_cases * sizeof ( int ) );
+          ld->pool = (uint64_t *)MALLOC ( ld->words * sizeof ( uint64_t ) );
+          ld->list = (int *)MALLOC ( ld->words * sizeof ( int ) );
+          ld->scratch = (uint32_t *)MALLOC ( ld->n * sizeof ( uint32_t ) );
+
+	  /* the cases are worked out as they are drawn. */
+          memset ( ld->laid, 0, error_cases / LEXICASE_BLOCK + 1 );
+          memset ( ld->ready, CASE_NONE, error_cases );
+          for ( c = 0; c < error_cases; ++c )
+               ld->order[c] = c;
+
+          sc->data = (void *)ld;
+          return sc;
+          break;
+
+        case SELECT_UPDATE:
+
+          lexicase_update ( (lexicase_data *)(sc->data), p, sc->changed );
+          return sc;
+          break;
+
+        case SELECT_CLEAN:
+
+          ld = (lexicase_data *)(sc->data);
+          FREE ( ld->key );
+          FREE ( ld->eps );
+          FREE ( ld->top );
+          FREE ( ld->level );
+          FREE ( ld->laid );
+          FREE ( ld->ready );
+          FREE ( ld->order );
+          FREE ( ld->pool );
+          FREE ( ld->list );
+          FREE ( ld->scratch );
+          FREE ( sc->data );
+          FREE ( sc );
+          return NULL;
+          break;
+     }
+
+     return NULL;
+}
+
+/* select_epsilon_lexicase_context()
+ *
+ * returns a selection context for the epsilon_lexicase method:
+ * lexicase with epsilon defaulting to "mad".
+ */
+
+sel_context *select_epsilon_lexicase_context ( int op, sel_context *sc,
+                                              population *p, char *string )
+{
+     char *s;
+
+     switch ( op )
+     {
+        case SELECT_INIT:
+	  /* a later "epsilon" in the string overrides this one. */
+          s = (char *)MALLOC ( strlen ( string ) + 20 );
+          strcpy ( s, "lexicase, epsilon=mad" );
+          for ( ; *string && *string != ','; ++string );
+          strcat ( s, string );
+          sc = select_lexicase_context ( SELECT_INIT, NULL, p, s );
+          FREE ( s );
+          sc->context_method = select_epsilon_lexicase_context;
+          return sc;
+          break;
+
+        case SELECT_UPDATE:
+        case SELECT_CLEAN:
+          return select_lexicase_context ( op, sc, p, string );
+          break;
+     }
+
+     return NULL;
+}
+
+/* select_bitset()
+ *
+ * filters the candidates in the pool on case c, whose levels are worked
+ * out, updating their count.
+ */
+
+static void select_bitset ( lexicase_data *ld, int c, uint32_t *key,
+                           int *countp )
+{
+     uint64_t *pool = ld->pool, *level, *band, *stay, *edge, keep, m;
+     uint32_t low = 0, top;
+     int count = 0;
+     int i, j, w, n;
+
+     /* the lowest level with a candidate on it. */
+     level = ld->level + (size_t)c * ld->levels * ld->words;
+     for ( j = 0; j < ld->levels; ++j )
+     {
+          band = level + j * ld->words;
+          for ( w = 0; w < ld->words && !( pool[w] & band[w] ); ++w );
+          if ( w < ld->words )
+               break;
+     }
+
+     if ( j == 0 )
+     {
+	  /* one of the case's best is a candidate, so the best of
+	     the candidates is the case's best. */
+          stay = level + ld->split * ld->words;
+          for ( w = count = 0; w < ld->words; ++w )
+          {
+               pool[w] &= stay[w];
+               count += bit_count ( pool[w] );
+          }
+     }
+     else if ( j + ld->split < ld->levels )
+     {
+	  /* the candidates on level j+split-1 all stay, and those
+	     past level j+split all go.  if none are between, the
+	     case needs no closer look. */
+          stay = level + ( j + ld->split - 1 ) * ld->words;
+          edge = stay + ld->words;
+          for ( w = 0; w < ld->words && !( pool[w] & edge[w] & ~stay[w] ); ++w );
+          if ( w == ld->words )
+          {
+               for ( w = 0; w < ld->words && !( pool[w] & ~stay[w] ); ++w );
+               if ( w == ld->words )
+                    return;
+               for ( w = count = 0; w < ld->words; ++w )
+               {
+                    pool[w] &= stay[w];
+                    count += bit_count ( pool[w] );
+               }
+          }
+          else
+          {
+	       /* the best of the candidates is on level j but not
+		  below it, and sets which of those between stay. */
+               band = level + j * ld->words;
+               n = 0;
+               for ( w = 0; w < ld->words; ++w )
+                    for ( m = pool[w] & band[w] & ~band[w-ld->words];
+                         m; m &= m - 1 )
+                    {
+                         i = w * 64 + lowest_bit ( m );
+                         if ( n++ == 0 || key[i] < low )
+                              low = key[i];
+                    }
+               top = threshold ( low, ld->eps[c] );
+               for ( w = count = 0; w < ld->words; ++w )
+               {
+                    keep = pool[w] & stay[w];
+                    for ( m = pool[w] & edge[w] & ~stay[w]; m; m &= m - 1 )
+                    {
+                         i = lowest_bit ( m );
+                         if ( key[w*64+i] <= top )
+                              keep |= (uint64_t)1 << i;
+                    }
+                    pool[w] = keep;
+                    count += bit_count ( keep );
+               }
+          }
+     }
+     else
+     {
+	  /* the candidates are all far from the case's best:  look
+	     at all their errors. */
+          ++lexicase_scans;
+          n = 0;
+          for ( w = 0; w < ld->words; ++w )
+               for ( m = pool[w]; m; m &= m - 1 )
+               {
+                    i = w * 64 + lowest_bit ( m );
+                    if ( n++ == 0 || key[i] < low )
+                         low = key[i];
+               }
+          top = threshold ( low, ld->eps[c] );
+          for ( w = count = 0; w < ld->words; ++w )
+          {
+               for ( m = pool[w]; m; m &= m - 1 )
+               {
+                    i = lowest_bit ( m );
+                    if ( key[w*64+i] > top )
+                         pool[w] &= ~( (uint64_t)1 << i );
+               }
+               count += bit_count ( pool[w] );
+          }
+     }
+
+     *countp = count;
+}
+
+/* set_aside()
+ *
+ * puts the cases among order[t..end-1] that could drop one of the
+ * count candidates in the list first, and returns where they end.  a
+ * case can if the candidates' errors on it spread further than its
+ * epsilon (less a rounding margin, so that one kept to be sure may
+ * turn out not to).
+ */
+
+static int set_aside ( lexicase_data *ld, population *p, int t, int end,
+                      int count )
+{
+     uint32_t low, high, k;
+     int i, j, c, n;
+
+     for ( j = n = t; j < end; ++j )
+     {
+          c = ld->order[j];
+          if ( ld->ready[c] == CASE_NONE )
+               case_epsilon ( ld, p, c );
+          low = high = error_key ( p->ind+ld->list[0], c );
+          for ( i = 1; i < count; ++i )
+          {
+               k = error_key ( p->ind+ld->list[i], c );
+               low = k < low ? k : low;
+               high = k > high ? k : high;
+          }
+	  /* (two infinite errors spread by NaN, and drop nobody.) */
+          if ( key_error ( high ) - key_error ( low ) >
+               ld->eps[c] * ( 1.0 - 1e-6 ) )
+          {
+               ld->order[j] = ld->order[n];
+               ld->order[n++] = c;
+          }
+     }
+     return n;
+}
+
+/* select_lexicase()
+ *
+ * does a lexicase selection.
+ */
+
+int select_lexicase ( sel_context *sc )
+{
+     lexicase_data *ld = (lexicase_data *)(sc->data);
+     individual *ind = sc->p->ind;
+     uint64_t *pool = ld->pool, m;
+     uint32_t *key, low, top, k;
+     int count = ld->n, listed = 0, end = error_cases, aside = 0;
+     int t, c, i, j, w, n;
+
+     for ( w = 0; w < ld->words; ++w )
+          pool[w] = ~(uint64_t)0;
+     if ( ld->n % 64 )
+          pool[ld->words-1] = ( (uint64_t)1 << ( ld->n % 64 ) ) - 1;
+
+     for ( t = 0; t < end && count > 1; ++t )
+     {
+	  /* the next case, shuffling as we go. */
+          j = t + random_int ( end - t );
+          c = ld->order[j];
+          ld->order[j] = ld->order[t];
+          ld->order[t] = c;
+
+          if ( listed )
+          {
+               if ( ld->ready[c] == CASE_NONE )
+                    case_epsilon ( ld, sc->p, c );
+               low = error_key ( ind+ld->list[0], c );
+               for ( i = 1; i < count; ++i )
+                    if ( ( k = error_key ( ind+ld->list[i], c ) ) < low )
+                         low = k;
+               top = threshold ( low, ld->eps[c] );
+               for ( i = n = 0; i < count; ++i )
+                    if ( error_key ( ind+ld->list[i], c ) <= top )
+                         ld->list[n++] = ld->list[i];
+               count = n;
+          }
+          else
+          {
+               if ( ld->ready[c] != CASE_LEVELS )
+                    case_levels ( ld, sc->p, c );
+               key = ld->key + (size_t)c * ld->n;
+               select_bitset ( ld, c, key, &count );
+          }
+
+	  /* few enough left to keep as a list. */
+          if ( !listed && count <= ld->words )
+          {
+               for ( w = n = 0; w < ld->words; ++w )
+                    for ( m = pool[w]; m; m &= m - 1 )
+                         ld->list[n++] = w * 64 + lowest_bit ( m );
+               listed = 1;
+          }
+
+	  /* set aside the cases left that can't drop any of the last few
+	     candidates, again each time one goes. */
+          if ( listed && count <= LEXICASE_TAIL && count > 1 &&
+               count != aside )
+          {
+               end = set_aside ( ld, sc->p, t + 1, end, count );
+               aside = count;
+          }
+     }
+
+     ++lexicase_selections;
+     lexicase_cases_used += t;
+
+     /* one of those left, at random. */
+     j = random_int ( count );
+     if ( listed )
+          return ld->list[j];
+     for ( w = 0; ; ++w )
+     {
+          n = bit_count ( pool[w] );
+          if ( j < n )
+               break;
+          j -= n;
+     }
+     for ( m = pool[w]; j > 0; --j )
+          m &= m - 1;
+     return w * 64 + lowest_bit ( m );
+}
+
+/* output_lexicase_stats()
+ *
+ * prints how much work lexicase selection did.
+ */
+
+void output_lexicase_stats ( void )
+{
+     if ( lexicase_selections == 0 )
+          return;
+
+     oprintf ( OUT_SYS, 30, "\n------- lexicase -------\n" );
+     oprintf ( OUT_SYS, 30, "          selections:      %ld\n", lexicase_selections );
+     oprintf ( OUT_SYS, 30, " cases per selection:      %.2f\n",
+              (double)lexicase_cases_used / lexicase_selections );
+     oprintf ( OUT_SYS, 30, "          full scans:      %ld\n", lexicase_scans );
+}
@@ -36,6 +36,7 @@
 #include <limits.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stdint.h>
 #ifdef USEVFORK
 #include <unistd.h>
 #endif
@@ -40,6 +40,10 @@ genspace gensp[GENSPACE_COUNT];
 /* internal copy of function set(s). */
 function_set *fset;
 int fset_count;
+function **function_table = NULL;
+int function_table_size = 0;
+int fset_has_ercs = 0;
+int fset_has_expr = 0;
 
 /* information about each tree--which function set it uses,
    its name, size limits, etc. */
@@ -59,6 +63,7 @@ int main ( int argc, char **argv )
 	extern event start, end, diff;
 	extern event eval, breed;
 	extern int startfromcheckpoint;
+	int runs;
 
 #ifdef MEMORY_LOG
      /* dump all memory allocations to a file. */
@@ -72,6 +77,10 @@ int main ( int argc, char **argv )
      event_zero ( &eval );
      event_zero ( &breed );
 
+     /* a SIGTERM or SIGUSR1 sent while the run is being set up is
+	acted on at the end of the first generation. */
+     budget_signals();
+
      if ( app_create_output_streams() )
           error ( E_FATAL_ERROR, "app_create_output_streams() failure." );
      initialize_output_streams();
@@ -87,9 +96,16 @@ int main ( int argc, char **argv )
      /* process the command line.  if starting from a checkpoint file, this
 	function will load the population. */
      startfromcheckpoint = process_commandline ( argc, argv, &startgen, &mpop );
+     /* (when restarting, this was done as the checkpoint was read.) */
+     if ( !startfromcheckpoint )
+	  ephem_configure();
 
      /* open the files associated with each stream. */
      open_output_streams();
+     initialize_profiling();
+     initialize_jit();
+     initialize_simplify();
+     initialize_eval_engine();
      
      /* make internal copies of function set(s), if it hasn't already been
 	done. */
@@ -106,30 +122,60 @@ int main ( int argc, char **argv )
      
      if ( app_initialize ( startfromcheckpoint ) )
           error ( E_FATAL_ERROR, "app_initialize() failure." );
+     initialize_case_errors();
+     fitcache_open();
 
-     /* if not starting from a checkpoint, create a random population. */
-     if ( !startfromcheckpoint )
-          mpop = initial_multi_population();
-
-     /* build the breeding table and the subpop exchange table from
-	the parameter database. */
-     initialize_topology ( mpop );
-     initialize_breeding ( mpop );
-
-     /* do the GP. */
-     run_gp ( mpop, startgen, &eval, &breed, startfromcheckpoint );
-
-     /* free app stuff. */
-    // app_uninitialize();
-
-     /* free lots of stuff. */
-     free_breeding ( mpop );
-     free_topology ( mpop );
-     free_multi_population ( mpop );
+     if ( benchmode )
+     {
+	  /* run the benchmark suite instead of evolving. */
+	  if ( startfromcheckpoint )
+	       error ( E_FATAL_ERROR, "can't run benchmarks from a checkpoint." );
+	  run_benchmarks();
+     }
+     else if ( !startfromcheckpoint && ( runs = batch_runs() ) > 0 )
+     {
+	  /* several runs, one after another, sharing the fitness cases,
+	     the function sets and the evaluation threads.  (a batch run's
+	     checkpoint restarts as a single run.) */
+	  sched_begin();
+	  run_gp_batch ( runs, &eval, &breed );
+	  sched_end();
+     }
+     else
+     {
+	  /* if not starting from a checkpoint, create a random population. */
+	  if ( !startfromcheckpoint )
+	       mpop = initial_multi_population();
+
+	  /* build the breeding table and the subpop exchange table from
+	     the parameter database. */
+	  initialize_topology ( mpop );
+	  initialize_breeding ( mpop );
+
+	  /* do the GP. */
+	  sched_begin();
+	  run_gp ( mpop, startgen, &eval, &breed, startfromcheckpoint );
+	  sched_end();
+
+	  /* free app stuff. */
+	  // app_uninitialize();
+
+	  /* free lots of stuff. */
+	  free_breeding ( mpop );
+	  free_topology ( mpop );
+	  free_multi_population ( mpop );
+     }
      free_parameters();
+     free_simplify();
      free_ephem_const();
      free_genspace();
      free_function_sets();
+     free_jit();
+     free_dag();
+     free_tile();
+     free_stream();
+     free_fitcache();
+     free_bloat();
 
      /* mark the finish time. */
      event_mark ( &end );
@@ -231,6 +277,8 @@ int function_sets_init ( function_set *user_fset, int user_fcount,
                     cur->arity = user_fset[i].cset[j].arity;
                     cur->type = user_fset[i].cset[j].type;
                     cur->evaltree = user_fset[i].cset[j].evaltree;
+                    cur->prim = user_fset[i].cset[j].prim;
+                    cur->input = user_fset[i].cset[j].input;
 
 		    /* copy the name string. */
                     n = strlen ( user_fset[i].cset[j].string );
@@ -263,6 +311,11 @@ int function_sets_init ( function_set *user_fset, int user_fcount,
                          error ( E_ERROR, "function has non-NULL ephem_gen and/or ephem_str field(s)." );
                     }
 
+		    /* trees with EXPR functions carry skip nodes, which the
+		       fast tree scans in tree.c don't handle. */
+                    if ( cur->type == FUNC_EXPR || cur->type == EVAL_EXPR )
+                         fset_has_expr = 1;
+
 		    /* do some type-specific checking. */
                     switch ( cur->type )
                     {
@@ -322,6 +375,8 @@ int function_sets_init ( function_set *user_fset, int user_fcount,
                     cur->arity = user_fset[i].cset[j].arity;
                     cur->type = user_fset[i].cset[j].type;
                     cur->evaltree = user_fset[i].cset[j].evaltree;
+                    cur->prim = user_fset[i].cset[j].prim;
+                    cur->input = user_fset[i].cset[j].input;
 
 		    /* copy terminal name. */
                     n = strlen ( user_fset[i].cset[j].string );
@@ -342,7 +397,7 @@ int function_sets_init ( function_set *user_fset, int user_fcount,
                     switch ( cur->type )
                     {
                        case TERM_NORM:
-                         if ( cur->code == NULL )
+                         if ( cur->code == NULL && cur->prim != PRIM_INPUT )
                          {
                               ++errors;
                               error ( E_ERROR, "normal terminal has NULL code field." );
@@ -358,6 +413,7 @@ int function_sets_init ( function_set *user_fset, int user_fcount,
                          }
                          break;
                        case TERM_ERC:
+                         fset_has_ercs = 1;
                          if ( cur->code != NULL )
                          {
                               ++errors;
@@ -459,6 +515,11 @@ int function_sets_init ( function_set *user_fset, int user_fcount,
 	  localSort ( fset[i].cset, fset[i].size, sizeof ( function ),
                  function_compare );
      }
+
+     /* number every function, for compact trees. */
+     for ( i = 0; i < fset_count; ++i )
+          for ( j = 0; j < fset[i].size; ++j )
+               register_function ( fset[i].cset+j );
           
 
 #ifdef DEBUG
@@ -522,9 +583,27 @@ void free_function_sets ( void )
      for ( i = 0; i < tree_count; ++i )
           FREE ( tree_map[i].name );
      FREE ( tree_map );
+     FREE ( function_table );
      
      fset = NULL;
      tree_map = NULL;
+     function_table = NULL;
+     function_table_size = 0;
+}
+
+/* register_function()
+ *
+ * adds a function to function_table, and records its index there in
+ * its id field.
+ */
+
+void register_function ( function *f )
+{
+     function_table = (function **)REALLOC ( function_table,
+                                            (function_table_size+1) *
+                                            sizeof ( function * ) );
+     f->id = function_table_size;
+     function_table[function_table_size++] = f;
 }
 
 /* read_tree_limits()
@@ -632,6 +711,10 @@ void pre_parameter_defaults ( void )
      add_parameter ( "output.detail",            "50", PARAM_COPY_NONE );
      add_parameter ( "output.bestn",             "1", PARAM_COPY_NONE );
      add_parameter ( "output.digits",            "4", PARAM_COPY_NONE );
+     add_parameter ( "output.records",           "none", PARAM_COPY_NONE );
+
+     add_parameter ( "eval.engine",              "tree", PARAM_COPY_NONE );
+     add_parameter ( "eval.threads",             "1", PARAM_COPY_NONE );
      
      add_parameter ( "init.method",              "half_and_half",
                     PARAM_COPY_NONE );
@@ -640,6 +723,15 @@ void pre_parameter_defaults ( void )
      
      add_parameter ( "checkpoint.filename",      "gp%06d.ckp",
                     PARAM_COPY_NONE );
+     add_parameter ( "checkpoint.format",        "text", PARAM_COPY_NONE );
+
+     add_parameter ( "steady_state.replace",     "inverse_tournament",
+                    PARAM_COPY_NONE );
+     add_parameter ( "async.workers",            "0", PARAM_COPY_NONE );
+     add_parameter ( "batch.runs",               "0", PARAM_COPY_NONE );
+     add_parameter ( "stop.adapt",               "none", PARAM_COPY_NONE );
+     add_parameter ( "stop.plateau",             "3", PARAM_COPY_NONE );
+     add_parameter ( "case_errors",              "none", PARAM_COPY_NONE );
      
      /* default problem uses a single population. */
      add_parameter ( "multiple.subpops", "1", PARAM_COPY_NONE );
@@ -655,6 +747,13 @@ void pre_parameter_defaults ( void )
 void post_parameter_defaults ( void )
 {
      binary_parameter ( "probabilistic_operators", 1 );
+     binary_parameter ( "output.profile", 0 );
+     binary_parameter ( "output.trace", 0 );
+     binary_parameter ( "inline_ercs", 0 );
+     binary_parameter ( "jit", 0 );
+     binary_parameter ( "simplify", 0 );
+     binary_parameter ( "steady_state", 0 );
+     binary_parameter ( "eval.float", 0 );
 }
 
 /* process_commandline()
@@ -681,6 +780,7 @@ int process_commandline ( int argc, char **argv, int *gen,
 	  fprintf ( stderr, "      [-c checkpointfile]    restart from name checkpoint file\n" );
 	  fprintf ( stderr, "      [-p name=value]        set parameter name to value\n" );
 	  fprintf ( stderr, "      [-q]                   run in quiet mode\n" );
+	  fprintf ( stderr, "      [-b]                   run the benchmark suite\n" );
 	  fprintf ( stderr, "      [-d symbol]            define symbol\n" );
 	  fprintf ( stderr, "      [-u symbol]            undefine symbol\n" );
           exit(1);
@@ -731,6 +831,10 @@ int process_commandline ( int argc, char **argv, int *gen,
 	       /* turn on quiet mode (don't dup OUT_SYS to stdout). */
                quietmode = 1;
                break;
+             case 'b':
+	       /* run the benchmarks instead of evolving. */
+               benchmode = 1;
+               break;
              case 'd':
 	       /* define a symbol. */
                if ( argv[i][2] )
@@ -807,6 +911,20 @@ void output_system_stats ( event *t_total, event *t_eval, event *t_breed )
               event_string ( t_breed ) );
 #endif     
 
+     /* per-phase timing, if it was asked for. */
+     output_profile_stats();
+     output_jit_stats();
+     output_simplify_stats();
+     output_dag_stats();
+     output_tile_stats();
+     output_casestream_stats();
+     output_fitcache_stats();
+     output_budget_stats();
+     output_bloat_stats();
+     output_lexicase_stats();
+     output_async_stats();
+     output_sched_stats();
+
      /* show how large the generation spaces grew. */
      oprintf ( OUT_SYS, 30, "\n------- generation spaces -------\n" );
      for ( i = 0; i < GENSPACE_COUNT; ++i )
@@ -39,6 +39,27 @@ static int malloccalls = 0;
 static int freecalls = 0;
 static int realloccalls = 0;
 
+/* note_peak()
+ *
+ * records a new high-water mark.  the counters are updated atomically,
+ * since evaluation threads allocate too.
+ */
+
+static void note_peak ( int cur )
+{
+     int max;
+
+     while ( cur > ( max = ATOMIC_ADD ( maxalloc, 0 ) ) )
+     {
+#ifdef THREADS_AVAILABLE
+          if ( __sync_bool_compare_and_swap ( &maxalloc, max, cur ) )
+               break;
+#else
+          maxalloc = cur;
+#endif
+     }
+}
+
 /* get_memory_stats()
  *
  * returns the memory statistics stored in static global
@@ -71,11 +92,9 @@ void *track_malloc ( int size )
      p = (unsigned char *)malloc ( size+EXTRAMEM );
      if ( p == NULL )
           return NULL;
-     ++malloccalls;
-     totalalloc += size;
-     curalloc += size;
-     if ( curalloc > maxalloc )
-          maxalloc = curalloc;
+     ATOMIC_ADD ( malloccalls, 1 );
+     ATOMIC_ADD ( totalalloc, size );
+     note_peak ( ATOMIC_ADD ( curalloc, size ) );
      *(int *)p = size;
 #ifdef MEMORY_LOG
      fprintf ( mlog, "MALLOC %d %08x\n", size, (void *)(p+EXTRAMEM) );
@@ -104,9 +123,9 @@ void track_free ( void *p )
      
      size = *(int *)((unsigned char *)p-EXTRAMEM);
 
-     ++freecalls;
-     curalloc -= size;
-     freealloc += size;
+     ATOMIC_ADD ( freecalls, 1 );
+     ATOMIC_ADD ( curalloc, -size );
+     ATOMIC_ADD ( freealloc, size );
 
      free ( (unsigned char *)p-EXTRAMEM );
 }
@@ -127,14 +146,12 @@ void *track_realloc ( void *p, int newsize )
      size = *(int *)((unsigned char *)p-EXTRAMEM);
 
      change = newsize-size;
-     curalloc += change;
-     if ( curalloc > maxalloc )
-          maxalloc = curalloc;
+     note_peak ( ATOMIC_ADD ( curalloc, change ) );
      if ( change > 0 )
-          totalalloc += change;
+          ATOMIC_ADD ( totalalloc, change );
      else
-          freealloc -= change;
-     ++realloccalls;
+          ATOMIC_ADD ( freealloc, -change );
+     ATOMIC_ADD ( realloccalls, 1 );
 
 #ifdef MEMORY_LOG
      fprintf ( mlog, "REALLOC %08x", p );
@@ -64,6 +64,7 @@ int operator_mutate_init ( char *options, breedphase *bp )
      bp->operator_start = operator_mutate_start;
      bp->operator_end = operator_mutate_end;
      bp->operator_operate = operator_mutate;
+     bp->operator_update = operator_mutate_update;
 
      /* default values for the mutation-specific data structure. */
      md->keep_trying = 0;
@@ -301,11 +302,9 @@ void operator_mutate_free ( void *data )
 void operator_mutate_start ( population *oldpop, void *data )
 {
      mutate_data * md;
-     select_context_func_ptr select_con;
 
      md = (mutate_data *)data;
-     select_con = get_select_context ( md->sname );
-     md->sc = select_con ( SELECT_INIT, NULL, oldpop, md->sname );
+     md->sc = select_context_init ( md->sname, oldpop );
 }
 
 /* operator_mutate_end()
@@ -321,6 +320,19 @@ void operator_mutate_end ( void *data )
      md->sc->context_method ( SELECT_CLEAN, md->sc, NULL, NULL );
 }
 
+/* operator_mutate_update()
+ *
+ * update selection context for mutation operator.
+ */
+
+void operator_mutate_update ( int index, void *data )
+{
+     mutate_data * md;
+
+     md = (mutate_data *)data;
+     select_context_update ( md->sc, index );
+}
+
 /* operator_mutate()
  *
  * do the mutation.
@@ -353,7 +365,7 @@ void operator_mutate ( population *oldpop, population *newpop,
 
      /* select an individual to mutate. */
      p = md->sc->select_method ( md->sc ); 
-     ps = tree_nodes ( oldpop->ind[p].tr[t].data );
+     ps = oldpop->ind[p].tr[t].nodes;
      forceany = (ps==1||total==0.0);
 
 #ifdef DEBUG_MUTATE
@@ -374,13 +386,13 @@ void operator_mutate ( population *oldpop, population *newpop,
 	  else if ( total*random_double() < md->internal )
 	  {
 	       /* choose an internal point. */
-	       l = random_int ( tree_nodes_internal ( oldpop->ind[p].tr[t].data ) );
+	       l = random_int ( oldpop->ind[p].tr[t].internal );
 	       replace[0] = get_subtree_internal ( oldpop->ind[p].tr[t].data, l );
 	  }
 	  else
 	  {
 	       /* choose an external point. */
-	       l = random_int ( tree_nodes_external ( oldpop->ind[p].tr[t].data ) );
+	       l = random_int ( oldpop->ind[p].tr[t].external );
 	       replace[0] = get_subtree_external ( oldpop->ind[p].tr[t].data, l );
 	  }
 	  
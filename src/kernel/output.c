@@ -35,6 +35,7 @@ typedef struct
      int reset;
      char *mode;
      int autoflush;
+     int optional;
      
      FILE *f;
      int valid;
@@ -43,12 +44,15 @@ typedef struct
 } output;
 
 output streams[MAXOUTPUTSTREAMS] =
-     { { OUT_SYS, ".sys", 0, "w", 1, NULL, 0 },
-       { OUT_GEN, ".gen", 0, "w", 0, NULL, 0 },
-       { OUT_PRG, ".prg", 0, "w", 0, NULL, 0 },
-       { OUT_STT, ".stt", 0, "w", 0, NULL, 0 },
-       { OUT_BST, ".bst", 1, "w", 0, NULL, 0 },
-       { OUT_HIS, ".his", 0, "w", 0, NULL, 0 } };
+     { { OUT_SYS, ".sys", 0, "w", 1, 0, NULL, 0 },
+       { OUT_GEN, ".gen", 0, "w", 0, 0, NULL, 0 },
+       { OUT_PRG, ".prg", 0, "w", 0, 0, NULL, 0 },
+       { OUT_STT, ".stt", 0, "w", 0, 0, NULL, 0 },
+       { OUT_BST, ".bst", 1, "w", 0, 0, NULL, 0 },
+       { OUT_HIS, ".his", 0, "w", 0, 0, NULL, 0 },
+       { OUT_REC, ".rec", 0, "wb", 0, 1, NULL, 0 },
+       { OUT_JSL, ".jsl", 0, "w", 0, 1, NULL, 0 },
+       { OUT_TRC, ".trace.json", 0, "w", 0, 1, NULL, 0 } };
      
 int output_stream_count = SYSOUTPUTSTREAMS;
 int toolate = 0;
@@ -58,6 +62,7 @@ int detail_level = DEFDETAILLEVEL;
 char error_type[3][20] = { "WARNING: ", "ERROR: ", "FATAL ERROR: " };
 
 extern int quietmode;
+extern int startfromcheckpoint;
 
 /* create_output_stream()
  *
@@ -95,6 +100,7 @@ int create_output_stream ( int id, char *ext, int reset, char *mode,
      streams[output_stream_count].mode = (char *)malloc ( strlen(mode)+1 );
      strcpy ( streams[output_stream_count].mode, mode );
      streams[output_stream_count].autoflush = autoflush;
+     streams[output_stream_count].optional = 0;
      
      streams[output_stream_count].f = NULL;
      streams[output_stream_count].valid = 0;
@@ -124,7 +130,10 @@ void initialize_output_streams ( void )
 /* open_output_streams()
  *
  * open files associated with each output stream.  dump anything buffered
- * in memory to the file.
+ * in memory to the file.  in a batch only OUT_SYS and the profiler's
+ * trace are opened here; the rest stay buffered until the first run
+ * opens them under its own basename, so that files under this one
+ * aren't truncated.
  */
 
 void open_output_streams ( void )
@@ -132,13 +141,24 @@ void open_output_streams ( void )
      int i;
      char *fn;
      char *basename;
+     int batch;
 
      basename = get_parameter ( "output.basename" );
+     batch = !startfromcheckpoint && !benchmode && batch_runs() > 0;
      
      fn = (char *)malloc ( strlen(basename)+50 );
 
      for ( i = 0; i < output_stream_count; ++i )
      {
+          if ( batch && streams[i].id != OUT_SYS && streams[i].id != OUT_TRC )
+               continue;
+          
+          /* optional streams are only created when asked for. */
+          if ( streams[i].optional &&
+               !record_stream_wanted ( streams[i].id ) &&
+               !prof_stream_wanted ( streams[i].id ) )
+               continue;
+          
           strcpy ( fn, basename );
           strcat ( fn, streams[i].ext );
           streams[i].f = fopen ( fn, streams[i].mode );
@@ -162,6 +182,56 @@ void open_output_streams ( void )
      set_detail_level ( atoi ( get_parameter ( "output.detail" ) ) );
 }
 
+/* switch_output_streams()
+ *
+ * closes the output streams and opens them again under a new basename,
+ * for the next run of a batch.  OUT_SYS and the profiler's trace cover
+ * the whole batch, and stay where they are.  anything buffered before
+ * the first run goes to its files.
+ */
+
+void switch_output_streams ( char *basename )
+{
+     int i;
+     char *fn;
+
+     fn = (char *)malloc ( strlen(basename)+50 );
+
+     for ( i = 0; i < output_stream_count; ++i )
+     {
+          if ( streams[i].id == OUT_SYS || streams[i].id == OUT_TRC )
+               continue;
+          if ( streams[i].valid )
+          {
+               fclose ( streams[i].f );
+               streams[i].valid = 0;
+          }
+          if ( streams[i].optional &&
+               !record_stream_wanted ( streams[i].id ) &&
+               !prof_stream_wanted ( streams[i].id ) )
+               continue;
+          
+          strcpy ( fn, basename );
+          strcat ( fn, streams[i].ext );
+          streams[i].f = fopen ( fn, streams[i].mode );
+          if ( streams[i].f == NULL )
+	       error ( E_ERROR, "can't open output file \"%s\".", fn );
+          else
+          {
+               streams[i].valid = 1;
+	       if ( streams[i].buffer )
+		    fputs ( streams[i].buffer, streams[i].f );
+	       FREE ( streams[i].buffer );
+	       streams[i].buffer = NULL;
+          }
+     }
+     free ( fn );
+
+     free ( global_basename );
+     global_basename = (char *)malloc ( strlen(basename)+1 );
+     strcpy ( global_basename, basename );
+}
+
 /* oputs()
  *
  * prints a string to an output stream.
@@ -229,6 +299,33 @@ void oprintf ( int streamid, int detail, char *format, ... )
      oputs ( streamid, detail, buffer );
 }
 
+/* owrite()
+ *
+ * writes a block of raw bytes to an output stream.  used for binary
+ * streams, which are never buffered in memory -- anything written
+ * before the stream is opened is dropped.
+ */
+
+void owrite ( int streamid, int detail, void *data, int size )
+{
+     int i;
+
+     if ( detail_level < detail )
+          return;
+
+     for ( i = 0; i < output_stream_count; ++i )
+          if ( streamid == streams[i].id )
+          {
+               if ( streams[i].valid )
+               {
+                    fwrite ( data, 1, size, streams[i].f );
+                    if ( streams[i].autoflush )
+                         fflush ( streams[i].f );
+               }
+               break;
+          }
+}
+
 /* output_filehandle()
  *
  * returns the filehandle associated with a given stream.
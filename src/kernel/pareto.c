@@ -0,0 +1,357 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+#include "lilgp.h"
+
+/* pareto selection.
+ *
+ * the "pareto" method ranks the population on two objectives, both to
+ * be minimized:  error (the standardized fitness) and size (nodes), so
+ * that a small tree that is nearly as good as a big one survives
+ * alongside it.  the ranking is NSGA-II's:  each individual's rank is
+ * its non-dominated front (0 for the individuals no other beats on
+ * both objectives, 1 for those beaten only by front 0, and so on), and
+ * within a front individuals in sparsely populated stretches of the
+ * front (large crowding distance) are preferred.  selection is a
+ * tournament on (rank, crowding distance).  options:
+ *
+ *   "size"       the tournament size (default 2).
+ *   "refresh"    in steady-state runs, the ranking is redone after this
+ *                many replacements (default the population size / 20,
+ *                at least 1).  between times newly placed individuals
+ *                carry their predecessor's rank.
+ *
+ * "inverse_pareto" takes the same options and picks the worst of the
+ * tournament, for use as steady_state.replace.
+ *
+ * with two objectives the fronts are found by one sort and a sweep:
+ * individuals are taken in order of error, and each goes onto the
+ * first front whose last member does not dominate it, found by binary
+ * search.  ranking costs O(n log n).
+ */
+
+typedef struct
+{
+     int count;
+     int refresh;
+     int stale;
+     int *rank;
+     double *crowd;
+     double *error;
+     int *size;
+     int *order;
+} pareto_data;
+
+static pareto_data *sortdata = NULL;
+
+/* pareto_compare()
+ *
+ * comparison function for qsort() to sort a list of indices by error,
+ * then size.
+ */
+
+static int pareto_compare ( const void *a, const void *b )
+{
+     int i = *(int *)a, j = *(int *)b;
+
+     if ( sortdata->error[i] < sortdata->error[j] )
+          return -1;
+     if ( sortdata->error[i] > sortdata->error[j] )
+          return 1;
+     if ( sortdata->size[i] != sortdata->size[j] )
+          return sortdata->size[i] - sortdata->size[j];
+     return i - j;
+}
+
+/* pareto_dominates()
+ *
+ * does individual i dominate individual j?  i is known to come before j
+ * in the sorted order, so it is no worse on error.  an individual the
+ * same as i on both objectives counts as dominated:  copies of one tree
+ * go on successive fronts instead of crowding the first.
+ */
+
+static int pareto_dominates ( pareto_data *pd, int i, int j )
+{
+     return pd->size[i] <= pd->size[j];
+}
+
+/* pareto_rank()
+ *
+ * computes every individual's front and crowding distance.
+ */
+
+static void pareto_rank ( pareto_data *pd, population *p )
+{
+     int *last, *first, *next;
+     int fronts, i, j, k, lo, hi, prev;
+     double derr, dsize;
+
+     for ( i = 0; i < p->size; ++i )
+     {
+          pd->error[i] = p->ind[i].s_fitness;
+          pd->size[i] = individual_size ( p->ind+i );
+          pd->order[i] = i;
+     }
+     sortdata = pd;
+     qsort ( pd->order, p->size, sizeof ( int ), pareto_compare );
+     sortdata = NULL;
+
+     /* last[k] is the most recent member of front k (the smallest in
+	it), first[k] its first member, and next[] links each front's
+	members in order of error. */
+     last = (int *)MALLOC ( p->size * sizeof ( int ) );
+     first = (int *)MALLOC ( p->size * sizeof ( int ) );
+     next = (int *)MALLOC ( p->size * sizeof ( int ) );
+
+     /* the fronts' last members get bigger from one front to the next,
+	so the first front not dominating an individual can be found by
+	binary search. */
+     fronts = 0;
+     for ( j = 0; j < p->size; ++j )
+     {
+          i = pd->order[j];
+          lo = 0;
+          hi = fronts;
+          while ( lo < hi )
+          {
+               k = ( lo + hi ) / 2;
+               if ( pareto_dominates ( pd, last[k], i ) )
+                    lo = k + 1;
+               else
+                    hi = k;
+          }
+          if ( lo == fronts )
+          {
+               first[fronts++] = i;
+          }
+          else
+               next[last[lo]] = i;
+          last[lo] = i;
+          next[i] = -1;
+          pd->rank[i] = lo;
+     }
+
+     /* crowding distance:  the gap between each member's neighbours on
+	its front, as a fraction of the front's spread in each
+	objective.  the ends of a front are always kept. */
+     for ( k = 0; k < fronts; ++k )
+     {
+          derr = pd->error[last[k]] - pd->error[first[k]];
+          dsize = pd->size[first[k]] - pd->size[last[k]];
+          prev = -1;
+          for ( i = first[k]; i != -1; i = next[i] )
+          {
+               if ( prev == -1 || next[i] == -1 )
+                    pd->crowd[i] = HUGE_VAL;
+               else
+               {
+                    pd->crowd[i] = 0.0;
+                    if ( derr > 0.0 && derr < HUGE_VAL )
+                         pd->crowd[i] += ( pd->error[next[i]] -
+                                          pd->error[prev] ) / derr;
+                    if ( dsize > 0.0 )
+                         pd->crowd[i] += ( pd->size[prev] -
+                                          pd->size[next[i]] ) / dsize;
+               }
+               prev = i;
+          }
+     }
+
+     FREE ( last );
+     FREE ( first );
+     FREE ( next );
+     pd->stale = 0;
+}
+
+/* pareto_better()
+ *
+ * the crowded comparison:  is individual i preferred to individual j?
+ */
+
+static int pareto_better ( pareto_data *pd, int i, int j )
+{
+     if ( pd->rank[i] != pd->rank[j] )
+          return pd->rank[i] < pd->rank[j];
+     return pd->crowd[i] > pd->crowd[j];
+}
+
+/* select_pareto_context()
+ *
+ * returns a selection context for the pareto method.
+ */
+
+sel_context *select_pareto_context ( int op, sel_context *sc,
+                                    population *p, char *string )
+{
+     char **argv;
+     int i, j;
+     pareto_data *pd;
+
+     switch ( op )
+     {
+        case SELECT_INIT:
+
+          sc = (sel_context *)MALLOC ( sizeof ( sel_context ) );
+          sc->p = p;
+          sc->select_method = select_pareto;
+          sc->context_method = select_pareto_context;
+
+          pd = (pareto_data *)MALLOC ( sizeof ( pareto_data ) );
+          pd->count = 2;
+          pd->refresh = p->size / 20;
+          j = parse_o_rama ( string, &argv );
+          for ( i = 1; i < j; ++i )
+          {
+               if ( strcmp ( argv[i], "size" ) == 0 )
+                    pd->count = atoi ( argv[++i] );
+               else if ( strcmp ( argv[i], "refresh" ) == 0 )
+                    pd->refresh = atoi ( argv[++i] );
+               else
+                    error ( E_FATAL_ERROR, "unknown pareto option \"%s\".",
+                           argv[i] );
+          }
+	  free_o_rama ( j, &argv );
+
+          if ( pd->count <= 0 )
+               error ( E_FATAL_ERROR,
+                      "tournament size must be at least 1.  (%s)", string );
+          if ( pd->refresh < 1 )
+               pd->refresh = 1;
+
+          pd->rank = (int *)MALLOC ( p->size * sizeof ( int ) );
+          pd->crowd = (double *)MALLOC ( p->size * sizeof ( double ) );
+          pd->error = (double *)MALLOC ( p->size * sizeof ( double ) );
+          pd->size = (int *)MALLOC ( p->size * sizeof ( int ) );
+          pd->order = (int *)MALLOC ( p->size * sizeof ( int ) );
+          pareto_rank ( pd, p );
+
+          sc->data = (void *)pd;
+          return sc;
+          break;
+
+        case SELECT_UPDATE:
+
+	  /* rank afresh once enough of the population has changed. */
+          pd = (pareto_data *)(sc->data);
+          if ( ++pd->stale >= pd->refresh )
+               pareto_rank ( pd, p );
+          return sc;
+          break;
+
+        case SELECT_CLEAN:
+
+          pd = (pareto_data *)(sc->data);
+          FREE ( pd->rank );
+          FREE ( pd->crowd );
+          FREE ( pd->error );
+          FREE ( pd->size );
+          FREE ( pd->order );
+          FREE ( sc->data );
+          FREE ( sc );
+          return NULL;
+          break;
+     }
+
+     return NULL;
+}
+
+/* select_pareto()
+ *
+ * a tournament on the crowded comparison:  the contestant on the
+ * lowest front wins, and between members of one front the one with
+ * the larger crowding distance.
+ */
+
+int select_pareto ( sel_context *sc )
+{
+     int i, j, k;
+     pareto_data *pd;
+
+     pd = (pareto_data *)(sc->data);
+
+     j = -1;
+     for ( i = 0; i < pd->count; ++i )
+     {
+          k = random_int ( sc->p->size );
+          if ( j == -1 || pareto_better ( pd, k, j ) )
+               j = k;
+     }
+
+     return j;
+}
+
+/* select_inverse_pareto_context()
+ *
+ * returns a selection context for the inverse_pareto method, which
+ * takes the same options as pareto but picks the worst contestant.
+ */
+
+sel_context *select_inverse_pareto_context ( int op, sel_context *sc,
+                                            population *p, char *string )
+{
+     switch ( op )
+     {
+        case SELECT_INIT:
+          sc = select_pareto_context ( SELECT_INIT, NULL, p, string );
+          sc->select_method = select_inverse_pareto;
+          sc->context_method = select_inverse_pareto_context;
+          return sc;
+          break;
+
+        case SELECT_UPDATE:
+        case SELECT_CLEAN:
+          return select_pareto_context ( op, sc, p, string );
+          break;
+     }
+
+     return NULL;
+}
+
+/* select_inverse_pareto()
+ *
+ * does an inverse pareto tournament:  the worst of (size) uniformly
+ * chosen individuals is selected.
+ */
+
+int select_inverse_pareto ( sel_context *sc )
+{
+     int i, j, k;
+     pareto_data *pd;
+
+     pd = (pareto_data *)(sc->data);
+
+     j = -1;
+     for ( i = 0; i < pd->count; ++i )
+     {
+          k = random_int ( sc->p->size );
+          if ( j == -1 || pareto_better ( pd, j, k ) )
+               j = k;
+     }
+
+     return j;
+}
@@ -40,6 +40,7 @@ void generate_random_population ( population *p, int *mindepth,
      int depth;
      int attempts_generation;
      tree *temp;
+     treeshape s;
      int totalnodes = 0;
      int flag;
 
@@ -97,7 +98,8 @@ void generate_random_population ( population *p, int *mindepth,
 
                /* first check the node limits. */
                flag = 0;
-               m = tree_nodes ( gensp[0].data );
+               tree_shape ( gensp[0].data, &s );
+               m = s.nodes;
                if ( tree_map[j].nodelimit > -1 && m > tree_map[j].nodelimit )
                {
                     --j;
@@ -105,7 +107,7 @@ void generate_random_population ( population *p, int *mindepth,
                }
 
 	       /* now change the depth limits. */
-               if ( tree_map[j].depthlimit > -1 && tree_depth ( gensp[0].data ) > tree_map[j].depthlimit )
+               if ( tree_map[j].depthlimit > -1 && s.depth > tree_map[j].depthlimit )
                {
                     --j;
                     continue;
@@ -217,6 +219,7 @@ population *allocate_population ( int size )
           p->ind[i].tr = (tree *)MALLOC ( tree_count * sizeof ( tree ) );
           p->ind[i].evald = EVAL_CACHE_INVALID;
           p->ind[i].flags = FLAG_NONE;
+          p->ind[i].errors = alloc_case_errors();
      }
 
      return p;
@@ -244,15 +247,30 @@ void free_multi_population ( multipop *mp )
 void free_population ( population *p )
 {
      int i, j;
+
+     /* dereference ERCs. */
      for ( i = 0; i < p->size; ++i )
-     {
           for ( j = 0; j < tree_count; ++j )
-          {
-	       /* dereference ERCs. */
                reference_ephem_constants ( p->ind[i].tr[j].data, -1 );
+     
+     release_population ( p );
+}
+
+/* release_population()
+ *
+ * frees a population without touching the ERC reference counts; the
+ * caller has already accounted for them.
+ */
+
+void release_population ( population *p )
+{
+     int i, j;
+     for ( i = 0; i < p->size; ++i )
+     {
+          for ( j = 0; j < tree_count; ++j )
                free_tree ( &(p->ind[i].tr[j]) );
-          }
           FREE ( p->ind[i].tr );
+          FREE ( p->ind[i].errors );
      }
      FREE ( p->ind );
      FREE ( p );
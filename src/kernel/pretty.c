@@ -67,7 +67,7 @@ void pretty_print_tree_recurse ( lnode **l, int **is, FILE *fil )
      int i;
      function *f;
 
-     f = (**l).f;
+     f = LNODE_F(**l);
 
      /** a positive indentation value means move to the next line and
        print that many spaces before the function name. */
@@ -86,7 +86,7 @@ void pretty_print_tree_recurse ( lnode **l, int **is, FILE *fil )
           if ( f->ephem_gen )
           {
 	       /* show value of ERCs. */
-               fprintf ( fil, " %s", (f->ephem_str)((**l).d->d) );
+               fprintf ( fil, " %s", (f->ephem_str)(ERC_VALUE(**l)) );
                ++*l;
           }
           else
@@ -136,7 +136,7 @@ void pretty_print_tree_recurse ( lnode **l, int **is, FILE *fil )
 
 void gen_indents ( lnode **l, int **is, int start, int sameline )
 {
-     function *f = (**l).f;
+     function *f = LNODE_F(**l);
      int i;
 
      /** sameline is true for the first child of a function.   first
@@ -0,0 +1,397 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+
+#include "lilgp.h"
+
+/* nanosecond-resolution phase timing.
+ *
+ * each phase of a run has a counter; prof_begin() and prof_end() bracket
+ * one interval of that phase.  the coarse phases (evaluation, breeding,
+ * exchange, statistics, checkpointing, ERC collection) are always timed,
+ * since it is cheap and the generation records use the numbers.  the
+ * fine-grained ones -- each breeding operator, each selection context
+ * setup, and the per-individual evaluation cost histogram -- are only
+ * collected when "output.profile" is on, and are reported in the .sys
+ * file after every generation and at the end of the run.  evaluation
+ * threads ("eval.threads", "async.workers") count into a profshare of
+ * their own, which the main thread adds in when it knows the thread
+ * isn't touching it:  after each round of the scheduler, and as
+ * finished offspring are collected.
+ *
+ * if "output.trace" is on, every interval of the coarse phases (and the
+ * per-operator breeding totals) is also written to <basename>.trace.json
+ * in the Chrome trace event format, for viewing in chrome://tracing or
+ * Perfetto.  only the main thread's intervals are traced.
+ */
+
+int prof_enabled = 0;
+
+/* the share the calling thread counts into; the main thread has none. */
+static THREAD_LOCAL profshare *my_share = NULL;
+
+static int trace_enabled = 0;
+static int trace_events = 0;
+static uint64_t prof_epoch = 0;
+
+static profcounter counters[PROF_MAXCOUNTERS] =
+{ { "evaluation", 1 },
+  { "breeding", 1 },
+  { "exchange", 1 },
+  { "statistics", 1 },
+  { "checkpoint", 1 },
+  { "ERC gc", 1 } };
+static int counter_count = PROF_FIXED;
+
+static long eval_hist_gen[PROF_HISTBUCKETS];
+static long eval_hist_run[PROF_HISTBUCKETS];
+
+/* prof_now()
+ *
+ * returns a monotonic timestamp in nanoseconds.
+ */
+
+uint64_t prof_now ( void )
+{
+     struct timespec ts;
+     clock_gettime ( CLOCK_MONOTONIC, &ts );
+     return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* prof_stream_wanted()
+ *
+ * called when the output streams are opened; says whether the trace
+ * stream should be created.
+ */
+
+int prof_stream_wanted ( int streamid )
+{
+     char *param = get_parameter ( "output.trace" );
+     return ( streamid == OUT_TRC && param && atoi ( param ) );
+}
+
+/* initialize_profiling()
+ *
+ * reads the profiling parameters.  must be called after the output
+ * streams are opened.
+ */
+
+void initialize_profiling ( void )
+{
+     char *param;
+
+     /* checkpoints from older versions may not have these. */
+     param = get_parameter ( "output.profile" );
+     prof_enabled = ( param && atoi ( param ) );
+     trace_enabled = prof_stream_wanted ( OUT_TRC );
+     if ( prof_epoch == 0 )
+          prof_epoch = prof_now();
+     if ( trace_enabled )
+          oputs ( OUT_TRC, 0, "[\n" );
+}
+
+/* prof_counter()
+ *
+ * returns the id of the named counter, creating it if necessary.  trace
+ * says whether its intervals go to the trace file.
+ */
+
+int prof_counter ( char *name, int trace )
+{
+     int i;
+
+     for ( i = 0; i < counter_count; ++i )
+          if ( strcmp ( counters[i].name, name ) == 0 )
+               return i;
+
+     if ( counter_count >= PROF_MAXCOUNTERS )
+     {
+          error ( E_WARNING, "too many profiling counters; \"%s\" not timed.",
+                 name );
+          return -1;
+     }
+
+     strncpy ( counters[i].name, name, PROF_NAMELENGTH-1 );
+     counters[i].trace = trace;
+     ++counter_count;
+     return i;
+}
+
+/* prof_begin()
+ *
+ * starts an interval for a counter.
+ */
+
+void prof_begin ( int id )
+{
+     if ( id >= 0 )
+          counters[id].start = prof_now();
+}
+
+/* prof_end()
+ *
+ * ends an interval for a counter, returning its length in nanoseconds.
+ */
+
+uint64_t prof_end ( int id )
+{
+     profcounter *c;
+     uint64_t now;
+
+     if ( id < 0 )
+          return 0;
+
+     c = counters + id;
+     now = prof_now();
+     c->last = now - c->start;
+     c->gen_ns += c->last;
+     c->run_ns += c->last;
+     ++c->gen_calls;
+     ++c->run_calls;
+
+     if ( trace_enabled && c->trace )
+     {
+          oprintf ( OUT_TRC, 0,
+                   "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                   trace_events++ ? ",\n" : "", c->name,
+                   ( c->start - prof_epoch ) / 1000.0, c->last / 1000.0 );
+     }
+     
+     return c->last;
+}
+
+/* prof_add()
+ *
+ * adds an externally measured interval to a counter.  used where many
+ * short intervals are summed and should appear as one trace event.
+ */
+
+void prof_add ( int id, uint64_t start, uint64_t ns, long calls )
+{
+     profcounter *c;
+
+     if ( id < 0 )
+          return;
+     if ( my_share )
+     {
+          my_share->ns[id] += ns;
+          my_share->calls[id] += calls;
+          return;
+     }
+
+     c = counters + id;
+     c->last = ns;
+     c->gen_ns += ns;
+     c->run_ns += ns;
+     c->gen_calls += calls;
+     c->run_calls += calls;
+     
+     if ( trace_enabled && c->trace && calls )
+     {
+          oprintf ( OUT_TRC, 0,
+                   "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"calls\":%ld}}",
+                   trace_events++ ? ",\n" : "", c->name,
+                   ( start - prof_epoch ) / 1000.0, ns / 1000.0, calls );
+     }
+}
+
+/* prof_last()
+ *
+ * the length of the most recent interval of a counter, in seconds.
+ */
+
+double prof_last ( int id )
+{
+     return counters[id].last / 1e9;
+}
+
+/* prof_eval_sample()
+ *
+ * records the cost of evaluating one individual in the histogram.
+ * buckets are powers of two nanoseconds.
+ */
+
+void prof_eval_sample ( uint64_t ns )
+{
+     int b = 0;
+     
+     while ( ns > 1 && b < PROF_HISTBUCKETS-1 )
+     {
+          ns >>= 1;
+          ++b;
+     }
+     if ( my_share )
+     {
+          ++my_share->hist[b];
+          return;
+     }
+     ++eval_hist_gen[b];
+     ++eval_hist_run[b];
+}
+
+/* prof_share_new()
+ *
+ * returns an empty share, for an evaluation thread.
+ */
+
+profshare *prof_share_new ( void )
+{
+     profshare *s = (profshare *)MALLOC ( sizeof ( profshare ) );
+     memset ( s, 0, sizeof ( profshare ) );
+     return s;
+}
+
+/* prof_share_use()
+ *
+ * makes the calling thread count into s.
+ */
+
+void prof_share_use ( profshare *s )
+{
+     my_share = s;
+}
+
+/* prof_share_add()
+ *
+ * moves the counts in from into to.
+ */
+
+void prof_share_add ( profshare *to, profshare *from )
+{
+     int i;
+
+     for ( i = 0; i < PROF_MAXCOUNTERS; ++i )
+     {
+          to->ns[i] += from->ns[i];
+          to->calls[i] += from->calls[i];
+     }
+     for ( i = 0; i < PROF_HISTBUCKETS; ++i )
+          to->hist[i] += from->hist[i];
+     memset ( from, 0, sizeof ( profshare ) );
+}
+
+/* prof_share_merge()
+ *
+ * moves the counts in s into the profile.  main thread only.
+ */
+
+void prof_share_merge ( profshare *s )
+{
+     int i;
+
+     for ( i = 0; i < counter_count; ++i )
+     {
+          counters[i].gen_ns += s->ns[i];
+          counters[i].run_ns += s->ns[i];
+          counters[i].gen_calls += s->calls[i];
+          counters[i].run_calls += s->calls[i];
+     }
+     for ( i = 0; i < PROF_HISTBUCKETS; ++i )
+     {
+          eval_hist_gen[i] += s->hist[i];
+          eval_hist_run[i] += s->hist[i];
+     }
+     memset ( s, 0, sizeof ( profshare ) );
+}
+
+/* print_profile()
+ *
+ * prints one table of counters and the evaluation histogram to the
+ * .sys file.
+ */
+
+static void print_profile ( int run, long *hist )
+{
+     int i;
+     uint64_t ns;
+     long calls;
+
+     for ( i = 0; i < counter_count; ++i )
+     {
+          ns = run ? counters[i].run_ns : counters[i].gen_ns;
+          calls = run ? counters[i].run_calls : counters[i].gen_calls;
+          if ( calls == 0 )
+               continue;
+          oprintf ( OUT_SYS, 50, "    %20s: %12.3lf ms  %8ld calls  %10.1lf us/call\n",
+                   counters[i].name, ns / 1e6, calls, ns / 1e3 / calls );
+     }
+
+     for ( i = 0; i < PROF_HISTBUCKETS; ++i )
+          if ( hist[i] )
+               break;
+     if ( i == PROF_HISTBUCKETS )
+          return;
+     
+     oprintf ( OUT_SYS, 50, "    evaluation cost per individual:\n" );
+     for ( ; i < PROF_HISTBUCKETS; ++i )
+          if ( hist[i] )
+               oprintf ( OUT_SYS, 50, "    %12.0lf - %12.0lf ns: %ld\n",
+                        ldexp ( 1.0, i ), ldexp ( 1.0, i+1 ), hist[i] );
+}
+
+/* prof_end_generation()
+ *
+ * prints the per-generation profile (if profiling is on) and resets the
+ * per-generation accumulators.
+ */
+
+void prof_end_generation ( int gen )
+{
+     int i;
+     
+     if ( prof_enabled )
+     {
+          oprintf ( OUT_SYS, 50, "    profile for generation %d:\n", gen );
+          print_profile ( 0, eval_hist_gen );
+     }
+
+     for ( i = 0; i < counter_count; ++i )
+     {
+          counters[i].gen_ns = 0;
+          counters[i].gen_calls = 0;
+     }
+     memset ( eval_hist_gen, 0, sizeof ( eval_hist_gen ) );
+}
+
+/* output_profile_stats()
+ *
+ * prints the whole-run profile, and finishes the trace file.
+ */
+
+void output_profile_stats ( void )
+{
+     if ( prof_enabled )
+     {
+          oprintf ( OUT_SYS, 30, "\n------- profile -------\n" );
+          print_profile ( 1, eval_hist_run );
+     }
+     if ( trace_enabled )
+     {
+          oputs ( OUT_TRC, 0, "\n]\n" );
+          trace_enabled = 0;
+     }
+}
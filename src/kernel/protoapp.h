@@ -30,6 +30,11 @@
 
 int app_build_function_sets ( void );
 void app_eval_fitness ( individual * );
+void app_begin_cases ( individual * );
+void app_score_case ( individual *, int, DATATYPE );
+void app_end_cases ( individual * );
+double app_cache_extra ( individual * );
+void app_cache_hit ( individual *, double );
 int app_create_output_streams ( void );
 int app_initialize ( int );
 void app_uninitialize ( void );
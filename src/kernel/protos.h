@@ -38,6 +38,7 @@ void rebuild_exchange_topology ( multipop *mpop );
 /*** change.c ***/
 
 population *change_population ( population *pop, breedphase * );
+void steady_state_population ( multipop *mpop, int sub );
 void show_population ( population *p );
 breedphase * initialize_one_breeding ( char *prefix );
 void initialize_breeding ( multipop * );
@@ -59,10 +60,13 @@ void write_individual ( individual *ind, ephem_index *eind, FILE *f );
 
 void read_tree_recurse ( int space, ephem_const **eind, FILE *fil, int tree,
 			char *string );
-function * get_function_by_name ( int tree, char *string, ephem_const **ep,
+function * get_function_by_name ( int tree, char *string, lnode *erc,
 				 ephem_const **eind );
 void write_population ( population *pop, ephem_index *eind, FILE *f );
 void write_tree_recurse ( lnode **l, ephem_index *eind, FILE *fil );
+void write_population_block ( multipop *mpop, ephem_index *eind, FILE *f );
+void read_population_block ( multipop *mpop, ephem_const **eind,
+                            int ecount, FILE *f );
 
 void write_hex_block ( void *, int, FILE * );
 void read_hex_block ( void *, int, FILE * );
@@ -74,18 +78,26 @@ void initialize_ephem_const ( void );
 void free_ephem_const ( void );
 void enlarge_ephem_space ( void );
 void ephem_const_gc ( void );
+void ephem_configure ( void );
 ephem_const *new_ephemeral_const ( function *f );
-int ephem_index_comp ( const void *a, const void *b );
+void new_ephem_node ( lnode *l, function *f );
+void ephem_release ( ephem_const *e );
+ephem_const *ephem_hold ( function *f, DATATYPE d );
+void ephem_drop ( ephem_const *e );
 ephem_index *write_ephem_list ( FILE *f );
 int lookup_ephem ( ephem_index *ind, ephem_const *e );
-ephem_const **read_ephem_list ( FILE *f );
+ephem_const **read_ephem_list ( FILE *f, int *count_out );
 void get_ephem_stats ( int *used, int *free, int *blocks, int *alloc );
 
 
 
 /*** eval.c ***/
 
+void initialize_eval_engine ( void );
+void register_caseset ( int count, int inputs, DATATYPE **input,
+                       DATATYPE *target );
 void set_current_individual ( individual * );
+void set_input_row ( const DATATYPE *row );
 DATATYPE evaluate_tree ( lnode *, int );
 DATATYPE evaluate_tree_recurse ( lnode **, int );
 
@@ -96,6 +108,7 @@ void run_gp ( multipop *mpop, int startgen,
              event *t_eval, event *t_breed, int startfromcheckpoint );
 int generation_information ( int gen, multipop *mpop, int stt_interval,
                             int bestn );
+void run_best ( double *fitness, int *hits, int *gen );
 void evaluate_pop ( population *pop );
 int accumulate_pop_stats ( popstats *total, popstats *n );
 void calculate_pop_stats ( popstats *s, population *pop, int gen, int subpop );
@@ -111,6 +124,7 @@ void read_stats_checkpoint ( multipop *mpop, ephem_const **eind, FILE *f );
 int function_sets_init ( function_set *, int, int *, char **, int );
 int function_compare ( const void *a, const void *b );
 void free_function_sets ( void );
+void register_function ( function *f );
 void read_tree_limits ( void );
 void initialize_random ( void );
 void pre_parameter_defaults ( void );
@@ -151,9 +165,11 @@ void initialize_output_streams ( void );
 void open_output_streams ( void );
 void oputs ( int streamid, int detail, char *string );
 void oprintf ( int streamid, int detail, char *format, ... );
+void owrite ( int streamid, int detail, void *data, int size );
 FILE *output_filehandle ( int streamid );
 void output_stream_close ( int streamid );
 void output_stream_open ( int streamid );
+void switch_output_streams ( char *basename );
 void output_stream_flush ( int streamid );
 void close_output_streams ( void );
 void error ( int severity, char *format, ... );
@@ -163,6 +179,131 @@ void flush_output_streams ( void );
 
 
 
+/*** record.c ***/
+
+int record_stream_wanted ( int streamid );
+void write_generation_records ( int gen, int subpops, popstats *stats,
+                               double eval_time, double breed_time );
+
+
+
+/*** jit.c ***/
+
+void initialize_jit ( void );
+void free_jit ( void );
+int jit_wanted ( int cases );
+void output_jit_stats ( void );
+jit_function jit_compile ( lnode *data, int whichtree );
+
+/*** simplify.c ***/
+
+void initialize_simplify ( void );
+void free_simplify ( void );
+void free_simplify_thread ( void );
+void simplify_register ( void );
+void output_simplify_stats ( void );
+lnode *simplify_tree ( lnode *data, int whichtree );
+
+/*** async.c ***/
+
+void async_lock ( void );
+void async_unlock ( void );
+int async_running ( void );
+int async_room ( void );
+int async_free_slot ( int sub, int slot, int size );
+void async_submit ( individual *k, int sub, int slot );
+async_job *async_collect ( int wait );
+void async_release ( async_job *job );
+void async_begin ( multipop *mpop );
+void async_end ( void );
+void output_async_stats ( void );
+
+/*** sched.c ***/
+
+int sched_running ( void );
+void sched_evaluate_pop ( population *pop );
+void sched_begin ( void );
+void sched_end ( void );
+void output_sched_stats ( void );
+
+/*** dag.c ***/
+
+void free_dag ( void );
+void output_dag_stats ( void );
+void dag_evaluate_pop ( population *pop );
+
+/*** fcache.c ***/
+
+void fitcache_open ( void );
+int fitcache_fetch ( individual *ind );
+void fitcache_store ( individual *ind );
+void fitcache_fetch_pop ( population *pop );
+void fitcache_store_pop ( population *pop );
+void free_fitcache ( void );
+void output_fitcache_stats ( void );
+
+/*** stream.c ***/
+
+void stream_open ( void );
+void free_stream ( void );
+void output_casestream_stats ( void );
+int stream_file_inputs ( void );
+int stream_rows ( void );
+int stream_offset ( void );
+int stream_first ( void );
+int stream_next ( void );
+
+/*** tile.c ***/
+
+void free_tile ( void );
+void output_tile_stats ( void );
+void tile_evaluate_pop ( population *pop );
+
+/*** prof.c ***/
+
+uint64_t prof_now ( void );
+int prof_stream_wanted ( int streamid );
+void initialize_profiling ( void );
+int prof_counter ( char *name, int trace );
+void prof_begin ( int id );
+uint64_t prof_end ( int id );
+void prof_add ( int id, uint64_t start, uint64_t ns, long calls );
+double prof_last ( int id );
+void prof_eval_sample ( uint64_t ns );
+profshare *prof_share_new ( void );
+void prof_share_use ( profshare *s );
+void prof_share_add ( profshare *to, profshare *from );
+void prof_share_merge ( profshare *s );
+void prof_end_generation ( int gen );
+void output_profile_stats ( void );
+
+
+
+/*** budget.c ***/
+
+void budget_signals ( void );
+void budget_begin ( int startfromcheckpoint );
+void budget_end ( void );
+void budget_charge ( individual *ind );
+void budget_charge_pop ( population *pop );
+int budget_stop ( int gen, int *maxgen, multipop *mpop );
+int budget_pop_size ( int size );
+int budget_preempted ( void );
+int budget_checkpoint_due ( void );
+void budget_save ( void );
+void output_budget_stats ( void );
+
+/*** batch.c ***/
+
+int batch_runs ( void );
+void run_gp_batch ( int runs, event *t_eval, event *t_breed );
+
+/*** bench.c ***/
+
+void run_benchmarks ( void );
+
+
+
 /*** params.c ***/
 
 void initialize_parameters ( void );
@@ -191,6 +332,7 @@ void generate_random_population ( population *p, int *mindepth,
                                  int *maxdepth, int *method );
 population *allocate_population ( int size );
 void free_population ( population *p );
+void release_population ( population *p );
 void free_multi_population ( multipop *mp );
 population *initial_population ( int *, int *, int * );
 multipop *initial_multi_population ( void );
@@ -219,6 +361,8 @@ void random_set_state ( void * );
 
 int exists_select_method ( char *string );
 select_context_func_ptr get_select_context ( char *string );
+sel_context *select_context_init ( char *string, population *pop );
+void select_context_update ( sel_context *sc, int index );
 void free_o_rama ( int, char *** );
 int parse_o_rama ( char *string, char *** argv );
 int rev_ind_compare ( const void *a, const void *b );
@@ -241,6 +385,51 @@ int select_afit_overselect ( sel_context *sc );
 sel_context *select_tournament_context ( int op, sel_context *sc,
                                         population *p, char *string );
 int select_tournament ( sel_context *sc );
+sel_context *select_inverse_tournament_context ( int op, sel_context *sc,
+                                                population *p, char *string );
+int select_inverse_tournament ( sel_context *sc );
+
+/*** bloat.c ***/
+
+double bloat_mean_size ( population *pop );
+double bloat_tarpeian_begin ( population *pop );
+int bloat_tarpeian ( individual *ind, double mean );
+void bloat_tarpeian_pop ( population *pop );
+void bloat_tarpeian_end ( population *pop );
+sel_context *select_double_tournament_context ( int op, sel_context *sc,
+                                               population *p, char *string );
+int select_double_tournament ( sel_context *sc );
+lnode *bloat_fair_subtree ( lnode *data, int nodes, lnode *data1,
+                           lnode *st1, int fair );
+int bloat_opeq_begin ( population *oldpop, int size );
+void bloat_opeq_filter ( population *newpop, int first );
+void bloat_opeq_end ( void );
+void free_bloat ( void );
+void output_bloat_stats ( void );
+
+/*** pareto.c ***/
+
+sel_context *select_pareto_context ( int op, sel_context *sc,
+                                    population *p, char *string );
+int select_pareto ( sel_context *sc );
+sel_context *select_inverse_pareto_context ( int op, sel_context *sc,
+                                            population *p, char *string );
+int select_inverse_pareto ( sel_context *sc );
+
+/*** lexicase.c ***/
+
+void initialize_case_errors ( void );
+void *alloc_case_errors ( void );
+void copy_case_errors ( individual *to, individual *from );
+void case_error ( individual *ind, int c, double e );
+void worst_case_errors ( individual *ind );
+void restore_case_errors ( multipop *mpop, int gen );
+sel_context *select_lexicase_context ( int op, sel_context *sc,
+                                      population *p, char *string );
+sel_context *select_epsilon_lexicase_context ( int op, sel_context *sc,
+                                              population *p, char *string );
+int select_lexicase ( sel_context *sc );
+void output_lexicase_stats ( void );
 
 /*** bestworst.c ***/
 
@@ -257,22 +446,20 @@ int select_random ( sel_context *sc );
 
 /*** tree.c ***/
 
-int tree_nodes ( lnode *tree );
-int tree_nodes_recurse ( lnode ** );
+void tree_shape ( lnode *, treeshape * );
+void tree_hash ( lnode *, uint64_t * );
 
+int tree_nodes ( lnode *tree );
 int tree_nodes_internal ( lnode * );
-int tree_nodes_internal_recurse ( lnode ** );
-
 int tree_nodes_external ( lnode * );
-int tree_nodes_external_recurse ( lnode ** );
 
 void generate_random_full_tree ( int space, int depth, function_set * );
 void generate_random_grow_tree ( int space, int depth, function_set * );
 
 int tree_depth ( lnode * );
-int tree_depth_recurse ( lnode ** );
 
 int tree_depth_to_subtree ( lnode *, lnode * );
+void tree_subtrees ( lnode *, lnode **, int *, int * );
 int tree_depth_to_subtree_recurse ( lnode **, lnode *, int );
 
 void print_tree ( lnode *, FILE * );
@@ -281,28 +468,19 @@ void print_tree_array ( lnode * );
 void print_tree_array_recurse ( lnode **, int * );
 
 lnode *get_subtree ( lnode *, int );
-lnode *get_subtree_recurse ( lnode **, int * );
-
 lnode *get_subtree_internal ( lnode *, int );
-lnode *get_subtree_internal_recurse ( lnode **, int * );
-
 lnode *get_subtree_external ( lnode *, int );
-lnode *get_subtree_external_recurse ( lnode **, int * );
 
 void copy_tree ( tree *to, tree *from );
 void free_tree ( tree * );
 
 int tree_size ( lnode * );
-int tree_size_recurse ( lnode ** );
 
 void copy_tree_replace_many ( int space, lnode *parent, lnode **replace,
                             lnode **with, int count, int *repcount );
-void copy_tree_replace_many_recurse ( int space, lnode **lp, lnode **lr,
-                                    lnode **lw, int count, int *repcount );
 void skip_over_subtree ( lnode ** );
 
 void reference_ephem_constants ( lnode *, int );
-void reference_ephem_constants_recurse ( lnode **, int );
 
 
 /*** pretty.c ***/
@@ -317,6 +495,7 @@ void initialize_genspace ( void );
 void free_genspace ( void );
 lnode * gensp_next ( int space );
 int gensp_next_int ( int space );
+lnode * gensp_next_block ( int space, int n );
 void gensp_dup_tree ( int space, tree *t );
 void gensp_reset ( int space );
 
@@ -334,6 +513,7 @@ int operator_crossover_init ( char *options, breedphase *bp );
 void operator_crossover_free ( void * );
 void operator_crossover_start ( population *oldpop, void *data );
 void operator_crossover_end ( void *data );
+void operator_crossover_update ( int index, void *data );
 void operator_crossover ( population *oldpop, population *newpop, void *data );
 
 /*** reproduce.c ***/
@@ -342,6 +522,7 @@ int operator_reproduce_init ( char *options, breedphase *bp );
 void operator_reproduce_free ( void * );
 void operator_reproduce_start ( population *oldpop, void *data );
 void operator_reproduce_end ( void *data );
+void operator_reproduce_update ( int index, void *data );
 void operator_reproduce ( population *oldpop, population *newpop, void *data );
 
 /*** mutate.c ***/
@@ -350,14 +531,31 @@ int operator_mutate_init ( char *options, breedphase *bp );
 void operator_mutate_free ( void * );
 void operator_mutate_start ( population *oldpop, void *data );
 void operator_mutate_end ( void *data );
+void operator_mutate_update ( int index, void *data );
 void operator_mutate ( population *oldpop, population *newpop, void *data );
 
 
 extern genspace gensp[GENSPACE_COUNT];
 extern function_set *fset;
 extern int fset_count;
+extern int fset_has_ercs;
+extern int fset_has_expr;
+extern function **function_table;
+extern int function_table_size;
+extern ephem_const **ephem_chunks;
+extern int ephem_inline;
 extern treeinfo *tree_map;
 extern int tree_count;
 extern int ind_nodelimit;
+extern int prof_enabled;
+extern int jit_enabled;
+extern int simplify_enabled;
+extern int eval_engine;
+extern caseset cases;
+extern int benchmode;
+extern int eval_threads;
+extern int batch_run;
+extern int plateau_window;
+extern int case_error_format;
 
 #endif
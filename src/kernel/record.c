@@ -0,0 +1,203 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+
+#include "lilgp.h"
+
+/* the generation record streams carry the same per-generation statistics
+ * as the .stt file, but in a form meant to be read by programs instead
+ * of people.  "output.records" selects the format:
+ *
+ *    none     no records are written (the default).
+ *    binary   fixed-size genrecord structures in <basename>.rec, after
+ *             a genrecord_header.
+ *    json     one JSON object per line in <basename>.jsl.
+ *
+ * one record is written per subpopulation (when there is more than one)
+ * and one for the whole population (subpop 0), every generation.
+ */
+
+static int record_format = -1;
+
+/* get_record_format()
+ *
+ * parses the "output.records" parameter, once.
+ */
+
+static int get_record_format ( void )
+{
+     char *param;
+     
+     if ( record_format != -1 )
+          return record_format;
+     
+     param = get_parameter ( "output.records" );
+     if ( param == NULL || strcmp ( param, "none" ) == 0 )
+          record_format = RECORD_NONE;
+     else if ( strcmp ( param, "binary" ) == 0 )
+          record_format = RECORD_BINARY;
+     else if ( strcmp ( param, "json" ) == 0 )
+          record_format = RECORD_JSON;
+     else
+     {
+          error ( E_WARNING, "\"output.records\" must be \"none\", \"binary\", or \"json\".  defaulting to \"none\"." );
+          record_format = RECORD_NONE;
+     }
+
+     return record_format;
+}
+
+/* record_stream_wanted()
+ *
+ * called when the output streams are opened, to decide whether the
+ * optional record stream with the given id should be created.
+ */
+
+int record_stream_wanted ( int streamid )
+{
+     switch ( get_record_format() )
+     {
+        case RECORD_BINARY:
+          return streamid == OUT_REC;
+        case RECORD_JSON:
+          return streamid == OUT_JSL;
+     }
+     return 0;
+}
+
+/* fill_record()
+ *
+ * copies a popstats structure into a genrecord.
+ */
+
+static void fill_record ( genrecord *r, int gen, int subpop, popstats *s,
+                         double eval_time, double breed_time )
+{
+     memset ( r, 0, sizeof ( genrecord ) );
+     
+     r->gen = gen;
+     r->subpop = subpop;
+     r->size = s->size;
+     r->maxnodes = s->maxnodes;
+     r->minnodes = s->minnodes;
+     r->totalnodes = s->totalnodes;
+     r->bestnodes = s->bestnodes;
+     r->worstnodes = s->worstnodes;
+     r->maxdepth = s->maxdepth;
+     r->mindepth = s->mindepth;
+     r->totaldepth = s->totaldepth;
+     r->bestdepth = s->bestdepth;
+     r->worstdepth = s->worstdepth;
+     r->maxhits = s->maxhits;
+     r->minhits = s->minhits;
+     r->totalhits = s->totalhits;
+     r->besthits = s->besthits;
+     r->worsthits = s->worsthits;
+     r->bestgen = s->bestgen;
+     r->worstgen = s->worstgen;
+     r->bestpop = s->bestpop;
+     r->worstpop = s->worstpop;
+     r->bestfit = s->bestfit;
+     r->worstfit = s->worstfit;
+     r->totalfit = s->totalfit;
+     r->eval_time = eval_time;
+     r->breed_time = breed_time;
+}
+
+/* print_json_record()
+ *
+ * writes one record as a line of JSON.  fitness values are printed with
+ * %.17g so they survive the round trip exactly.
+ */
+
+static void print_json_record ( genrecord *r )
+{
+     oprintf ( OUT_JSL, 0, "{\"gen\":%d,\"subpop\":%d,\"size\":%d,",
+              r->gen, r->subpop, r->size );
+     oprintf ( OUT_JSL, 0, "\"nodes\":{\"max\":%d,\"min\":%d,\"total\":%d,\"best\":%d,\"worst\":%d},",
+              r->maxnodes, r->minnodes, r->totalnodes, r->bestnodes,
+              r->worstnodes );
+     oprintf ( OUT_JSL, 0, "\"depth\":{\"max\":%d,\"min\":%d,\"total\":%d,\"best\":%d,\"worst\":%d},",
+              r->maxdepth, r->mindepth, r->totaldepth, r->bestdepth,
+              r->worstdepth );
+     oprintf ( OUT_JSL, 0, "\"hits\":{\"max\":%d,\"min\":%d,\"total\":%d,\"best\":%d,\"worst\":%d},",
+              r->maxhits, r->minhits, r->totalhits, r->besthits,
+              r->worsthits );
+     oprintf ( OUT_JSL, 0, "\"fitness\":{\"best\":%.17g,\"worst\":%.17g,\"total\":%.17g},",
+              r->bestfit, r->worstfit, r->totalfit );
+     oprintf ( OUT_JSL, 0, "\"bestgen\":%d,\"worstgen\":%d,\"bestpop\":%d,\"worstpop\":%d,",
+              r->bestgen, r->worstgen, r->bestpop, r->worstpop );
+     oprintf ( OUT_JSL, 0, "\"time\":{\"eval\":%.9g,\"breed\":%.9g}}\n",
+              r->eval_time, r->breed_time );
+}
+
+/* write_generation_records()
+ *
+ * writes the records for one generation.  stats is the gen_stats array
+ * built by generation_information() (index 0 is the whole population).
+ * eval_time is the time spent evaluating this generation; breed_time is
+ * the time spent breeding it from the previous one.
+ */
+
+void write_generation_records ( int gen, int subpops, popstats *stats,
+                               double eval_time, double breed_time )
+{
+     /* the run the header was written for:  each run of a batch has its
+	own file. */
+     static int header_done = -1;
+     genrecord_header h;
+     genrecord r;
+     int i;
+     
+     if ( get_record_format() == RECORD_NONE )
+          return;
+
+     if ( record_format == RECORD_BINARY && header_done != batch_run )
+     {
+          memset ( &h, 0, sizeof ( genrecord_header ) );
+          memcpy ( h.magic, RECORD_MAGIC, 8 );
+          h.version = RECORD_VERSION;
+          h.recsize = sizeof ( genrecord );
+          owrite ( OUT_REC, 0, &h, sizeof ( genrecord_header ) );
+          header_done = batch_run;
+     }
+
+     /* per-subpopulation records are only written if there is more
+        than one; the whole-population record always comes last. */
+     for ( i = ( subpops > 1 ? 1 : subpops + 1 ); i <= subpops + 1; ++i )
+     {
+          if ( i > subpops )
+               fill_record ( &r, gen, 0, stats, eval_time, breed_time );
+          else
+               fill_record ( &r, gen, i, stats + i, eval_time, breed_time );
+
+          if ( record_format == RECORD_BINARY )
+               owrite ( OUT_REC, 0, &r, sizeof ( genrecord ) );
+          else
+               print_json_record ( &r );
+     }
+}
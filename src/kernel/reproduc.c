@@ -54,6 +54,7 @@ int operator_reproduce_init ( char *options, breedphase *bp )
      bp->operator_start = operator_reproduce_start;
      bp->operator_end = operator_reproduce_end;
      bp->operator_operate = operator_reproduce;
+     bp->operator_update = operator_reproduce_update;
 
      rd->sname = NULL;
 
@@ -124,12 +125,10 @@ void operator_reproduce_free ( void *data )
 void operator_reproduce_start ( population *oldpop, void *data )
 {
      reproduce_data * rd;
-     select_context_func_ptr select_con;
 
      rd = (reproduce_data *)data;
      
-     select_con = get_select_context ( rd->sname );
-     rd->sc = select_con ( SELECT_INIT, NULL, oldpop, rd->sname );
+     rd->sc = select_context_init ( rd->sname, oldpop );
 }
 
 /* operator_reproduce_end()
@@ -145,6 +144,18 @@ void operator_reproduce_end ( void *data )
      rd->sc->context_method ( SELECT_CLEAN, rd->sc, NULL, NULL );
 }
 
+/* operator_reproduce_update()
+ *
+ * updates the selection context for this phase.
+ */
+
+void operator_reproduce_update ( int index, void *data )
+{
+     reproduce_data * rd;
+
+     rd = (reproduce_data *)data;
+     select_context_update ( rd->sc, index );
+}
 
 /* operator_reproduce()
  *
@@ -0,0 +1,489 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+#include "lilgp.h"
+
+#ifdef THREADS_AVAILABLE
+#include <pthread.h>
+#endif
+
+/* the evaluation scheduler.
+ *
+ * with "eval.threads" above 1, evaluate_pop() shares the population out
+ * among that many threads (the main one included).  an individual's
+ * cost is taken to be its node count, from the counts cached in its
+ * trees.  the individuals that need evaluating are sorted by cost, the
+ * large ones made tasks of their own and the small ones batched
+ * together, and the tasks dealt out largest first, each to the thread
+ * with the least work so far.  each thread works through its own deque
+ * from the large end; one that runs dry steals from the small end of
+ * another's.  so the largest individuals are started first, and the
+ * threads finish together even when sizes vary a hundredfold.
+ */
+
+/* tasks aimed at per thread; smaller individuals are batched up to
+   this share of the total. */
+#define SCHED_TASKS_PER_THREAD   8
+
+static int participants = 0;
+
+/* the round being evaluated. */
+static population *round_pop;
+static int round_gen;
+
+/* individuals needing evaluation, in decreasing order of cost. */
+static int *order;
+static long *cost;
+static int order_size;
+
+/* each task is a stretch of order[]. */
+static int *task_start;
+static int *task_end;
+static int task_count;
+
+/* one deque of tasks per thread:  entries head .. tail-1 of its row
+   of deque_task. */
+static int *deque_task;
+static int *deque_head;
+static int *deque_tail;
+static long *deque_load;
+
+/* each thread's share of the profile (the main thread's is unused). */
+static profshare **shares;
+
+/* statistics. */
+static int used_threads = 0;
+static long sched_rounds = 0;
+static long sched_tasks = 0;
+static long sched_steals = 0;
+
+#ifdef THREADS_AVAILABLE
+
+static pthread_t *threads;
+static pthread_mutex_t *deque_lock;
+
+static pthread_mutex_t round_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+static int round_number;
+static int round_busy;
+static int quit;
+
+#endif
+
+/* sched_running()
+ *
+ * nonzero if evaluate_pop() should use the scheduler.
+ */
+
+int sched_running ( void )
+{
+     return participants > 1;
+}
+
+/* by_cost()
+ *
+ * qsort comparison:  most expensive first, ties in population order.
+ */
+
+static int by_cost ( const void *a, const void *b )
+{
+     long ca = cost[*(const int *)a];
+     long cb = cost[*(const int *)b];
+
+     if ( ca != cb )
+          return ca > cb ? -1 : 1;
+     return *(const int *)a - *(const int *)b;
+}
+
+/* individual_cost()
+ *
+ * the cost estimate:  the total node count of the trees.
+ */
+
+static long individual_cost ( individual *ind )
+{
+     long c = 0;
+     int j;
+
+     for ( j = 0; j < tree_count; ++j )
+          c += ind->tr[j].nodes >= 0 ? ind->tr[j].nodes :
+               tree_nodes ( ind->tr[j].data );
+     return c;
+}
+
+/* plan()
+ *
+ * sort the individuals needing evaluation, cut them into tasks, and
+ * deal the tasks out to the deques.  returns the number of individuals
+ * to evaluate.
+ */
+
+static int plan ( population *pop )
+{
+     long total = 0;
+     long grain, c;
+     int i, n, t, p, best;
+
+     if ( pop->size > order_size )
+     {
+          order_size = pop->size;
+          order = (int *)REALLOC ( order, order_size * sizeof ( int ) );
+          cost = (long *)REALLOC ( cost, order_size * sizeof ( long ) );
+          task_start = (int *)REALLOC ( task_start, order_size * sizeof ( int ) );
+          task_end = (int *)REALLOC ( task_end, order_size * sizeof ( int ) );
+          FREE ( deque_task );
+          deque_task = (int *)MALLOC ( participants * order_size *
+                                       sizeof ( int ) );
+     }
+
+     n = 0;
+     for ( i = 0; i < pop->size; ++i )
+          if ( pop->ind[i].evald != EVAL_CACHE_VALID )
+          {
+               cost[i] = individual_cost ( pop->ind+i );
+               total += cost[i];
+               order[n++] = i;
+          }
+     if ( n == 0 )
+          return 0;
+     qsort ( order, n, sizeof ( int ), by_cost );
+
+     grain = total / ( participants * SCHED_TASKS_PER_THREAD );
+     if ( grain < 1 )
+          grain = 1;
+     
+     for ( i = 0; i < participants; ++i )
+     {
+          deque_head[i] = deque_tail[i] = 0;
+          deque_load[i] = 0;
+     }
+
+     task_count = 0;
+     for ( i = 0; i < n; )
+     {
+          t = task_count++;
+          task_start[t] = i;
+          c = 0;
+          do
+               c += cost[order[i++]];
+          while ( i < n && c < grain );
+          task_end[t] = i;
+
+	  /* to the least loaded deque. */
+          best = 0;
+          for ( p = 1; p < participants; ++p )
+               if ( deque_load[p] < deque_load[best] )
+                    best = p;
+          deque_load[best] += c;
+          deque_task[best*order_size+deque_tail[best]++] = t;
+     }
+     
+     sched_tasks += task_count;
+     return n;
+}
+
+/* take()
+ *
+ * the next task from a thread's own deque, largest first, or -1.
+ */
+
+static int take ( int me )
+{
+     int t = -1;
+
+#ifdef THREADS_AVAILABLE
+     pthread_mutex_lock ( deque_lock+me );
+#endif
+     if ( deque_head[me] < deque_tail[me] )
+          t = deque_task[me*order_size+deque_head[me]++];
+#ifdef THREADS_AVAILABLE
+     pthread_mutex_unlock ( deque_lock+me );
+#endif
+     return t;
+}
+
+/* steal()
+ *
+ * the smallest task left in any other thread's deque, or -1 if all
+ * are empty.
+ */
+
+static int steal ( int me )
+{
+     int t = -1;
+     int i, v;
+
+     for ( i = 1; i < participants && t == -1; ++i )
+     {
+          v = ( me + i ) % participants;
+#ifdef THREADS_AVAILABLE
+          pthread_mutex_lock ( deque_lock+v );
+#endif
+          if ( deque_head[v] < deque_tail[v] )
+               t = deque_task[v*order_size+--deque_tail[v]];
+#ifdef THREADS_AVAILABLE
+          pthread_mutex_unlock ( deque_lock+v );
+#endif
+     }
+     if ( t != -1 )
+          ATOMIC_ADD ( sched_steals, 1 );
+     return t;
+}
+
+/* work()
+ *
+ * evaluate tasks until there are none left anywhere.  each individual
+ * is evaluated under its own number and the round's generation.
+ */
+
+static void work ( int me )
+{
+     int t, i, k;
+     uint64_t s;
+
+     generation_No = round_gen;
+     while ( ( t = take ( me ) ) != -1 || ( t = steal ( me ) ) != -1 )
+          for ( i = task_start[t]; i < task_end[t]; ++i )
+          {
+               k = order[i];
+               population_No = k;
+               if ( prof_enabled )
+               {
+                    s = prof_now();
+                    app_eval_fitness ( round_pop->ind+k );
+                    prof_eval_sample ( prof_now() - s );
+               }
+               else
+                    app_eval_fitness ( round_pop->ind+k );
+          }
+}
+
+#ifdef THREADS_AVAILABLE
+
+/* worker()
+ *
+ * the scheduler's threads wait for a round, help with it, and report
+ * back.  thread n works from deque n; the main thread has deque 0.
+ */
+
+static void *worker ( void *arg )
+{
+     int me = (int)(intptr_t)arg;
+     int seen = 0;
+
+     prof_share_use ( shares[me] );
+     pthread_mutex_lock ( &round_mutex );
+     while ( 1 )
+     {
+          while ( round_number == seen && !quit )
+               pthread_cond_wait ( &start_cond, &round_mutex );
+          if ( quit )
+               break;
+          seen = round_number;
+          pthread_mutex_unlock ( &round_mutex );
+
+          work ( me );
+
+          pthread_mutex_lock ( &round_mutex );
+          if ( --round_busy == 0 )
+               pthread_cond_signal ( &done_cond );
+     }
+     pthread_mutex_unlock ( &round_mutex );
+
+     free_simplify_thread();
+     free_jit();
+     return NULL;
+}
+
+#endif
+
+/* sched_evaluate_pop()
+ *
+ * evaluate the individuals of a population that need it, using all
+ * the scheduler's threads.
+ */
+
+void sched_evaluate_pop ( population *pop )
+{
+#ifdef THREADS_AVAILABLE
+     int i;
+#endif
+     
+     round_pop = pop;
+     round_gen = generation_No;
+     if ( plan ( pop ) == 0 )
+          return;
+     ++sched_rounds;
+
+#ifdef THREADS_AVAILABLE
+     pthread_mutex_lock ( &round_mutex );
+     ++round_number;
+     round_busy = participants - 1;
+     pthread_cond_broadcast ( &start_cond );
+     pthread_mutex_unlock ( &round_mutex );
+#endif
+
+     work ( 0 );
+
+#ifdef THREADS_AVAILABLE
+     pthread_mutex_lock ( &round_mutex );
+     while ( round_busy > 0 )
+          pthread_cond_wait ( &done_cond, &round_mutex );
+     pthread_mutex_unlock ( &round_mutex );
+
+     /* the other threads are idle until the next round. */
+     for ( i = 1; i < participants; ++i )
+          prof_share_merge ( shares[i] );
+#endif
+}
+
+/* sched_begin()
+ *
+ * start the scheduler's threads, if "eval.threads" asks for more than
+ * one.
+ */
+
+void sched_begin ( void )
+{
+     char *param = get_parameter ( "eval.threads" );
+     int i, j, n;
+
+     n = param ? atoi ( param ) : 1;
+     if ( n <= 1 )
+          return;
+
+#ifdef THREADS_AVAILABLE
+     /* ADF evaluation passes arguments through tree_map, which the
+	threads would share. */
+     for ( i = 0; i < fset_count; ++i )
+          for ( j = 0; j < fset[i].size; ++j )
+               if ( fset[i].cset[j].type == EVAL_DATA ||
+                    fset[i].cset[j].type == EVAL_EXPR ||
+                    fset[i].cset[j].type == EVAL_TERM )
+               {
+                    error ( E_WARNING, "eval.threads can't be used with evaluation tokens; evaluating in the main thread." );
+                    return;
+               }
+
+     deque_head = (int *)MALLOC ( n * sizeof ( int ) );
+     deque_tail = (int *)MALLOC ( n * sizeof ( int ) );
+     deque_load = (long *)MALLOC ( n * sizeof ( long ) );
+     deque_lock = (pthread_mutex_t *)MALLOC ( n * sizeof ( pthread_mutex_t ) );
+     shares = (profshare **)MALLOC ( n * sizeof ( profshare * ) );
+     for ( i = 0; i < n; ++i )
+     {
+          pthread_mutex_init ( deque_lock+i, NULL );
+          shares[i] = prof_share_new();
+     }
+     order_size = 0;
+     round_number = 0;
+     quit = 0;
+
+     /* the folded-constant function must be registered before any
+	thread simplifies. */
+     simplify_register();
+
+     /* the main thread is participant 0. */
+     participants = n;
+     eval_threads += n - 1;
+     threads = (pthread_t *)MALLOC ( n * sizeof ( pthread_t ) );
+     for ( i = 1; i < n; ++i )
+          if ( pthread_create ( threads+i, NULL, worker, (void *)(intptr_t)i ) )
+               break;
+     eval_threads -= n - i;
+     participants = i;
+     for ( ; i < n; ++i )
+          FREE ( shares[i] );
+     if ( participants > used_threads )
+          used_threads = participants;
+     oprintf ( OUT_SYS, 30, "    %d evaluation threads.\n", participants );
+#else
+     error ( E_WARNING, "no threads on this platform; evaluating in the main thread." );
+#endif
+}
+
+/* sched_end()
+ *
+ * stop the scheduler's threads.
+ */
+
+void sched_end ( void )
+{
+#ifdef THREADS_AVAILABLE
+     int i;
+
+     if ( deque_head == NULL )
+          return;
+
+     pthread_mutex_lock ( &round_mutex );
+     quit = 1;
+     pthread_cond_broadcast ( &start_cond );
+     pthread_mutex_unlock ( &round_mutex );
+     for ( i = 1; i < participants; ++i )
+          pthread_join ( threads[i], NULL );
+     eval_threads -= participants - 1;
+
+     for ( i = 0; i < participants; ++i )
+          pthread_mutex_destroy ( deque_lock+i );
+     for ( i = 0; i < participants; ++i )
+          FREE ( shares[i] );
+     FREE ( shares );
+     FREE ( threads );
+     FREE ( deque_lock );
+     FREE ( deque_head );
+     FREE ( deque_tail );
+     FREE ( deque_load );
+     FREE ( deque_task );
+     FREE ( order );
+     FREE ( cost );
+     FREE ( task_start );
+     FREE ( task_end );
+     deque_head = deque_tail = deque_task = NULL;
+     deque_load = NULL;
+     order = task_start = task_end = NULL;
+     cost = NULL;
+     order_size = 0;
+     participants = 0;
+#endif
+}
+
+/* output_sched_stats()
+ *
+ * report the scheduler's totals at the end of the run.
+ */
+
+void output_sched_stats ( void )
+{
+     if ( used_threads <= 1 )
+          return;
+     oprintf ( OUT_SYS, 30, "\n------- evaluation scheduler -------\n" );
+     oprintf ( OUT_SYS, 30, "             threads:      %d\n", used_threads );
+     oprintf ( OUT_SYS, 30, "              rounds:      %ld\n", sched_rounds );
+     oprintf ( OUT_SYS, 30, "               tasks:      %ld\n", sched_tasks );
+     oprintf ( OUT_SYS, 30, "              steals:      %ld\n", sched_steals );
+}
@@ -34,6 +34,12 @@ select_method select_method_table[] =
 { { "fitness",            select_afit_context },
   { "fitness_overselect", select_afit_overselect_context },
   { "tournament",         select_tournament_context },
+  { "inverse_tournament", select_inverse_tournament_context },
+  { "double_tournament",  select_double_tournament_context },
+  { "pareto",             select_pareto_context },
+  { "inverse_pareto",     select_inverse_pareto_context },
+  { "lexicase",           select_lexicase_context },
+  { "epsilon_lexicase",   select_epsilon_lexicase_context },
   { "inverse_fitness",    select_inverse_afit_context },
   { "best",               select_best_context },
   { "worst",              select_worst_context },
@@ -75,6 +81,51 @@ select_context_func_ptr get_select_context ( char *string )
      return s->func;
 }
 
+/* select_context_init()
+ *
+ * creates a selection context from a method string for the given
+ * population.  when profiling, the setup time is charged to a counter
+ * for the selection method.
+ */
+
+sel_context *select_context_init ( char *string, population *pop )
+{
+     select_context_func_ptr select_con;
+     select_method *s;
+     sel_context *sc;
+     char name[PROF_NAMELENGTH+20];
+     int id;
+     
+     select_con = get_select_context ( string );
+     if ( !prof_enabled )
+          return select_con ( SELECT_INIT, NULL, pop, string );
+
+     for ( s = select_method_table; s->func != select_con; ++s );
+     sprintf ( name, "select.%s", s->name );
+     id = prof_counter ( name, 0 );
+     
+     prof_begin ( id );
+     sc = select_con ( SELECT_INIT, NULL, pop, string );
+     prof_end ( id );
+
+     return sc;
+}
+
+/* select_context_update()
+ *
+ * tells a selection context that individual "index" of its population
+ * has been replaced (by the steady-state engine), so that it can bring
+ * its tables up to date in place instead of being rebuilt.  methods
+ * that look at the fitness values directly when selecting have nothing
+ * to do.
+ */
+
+void select_context_update ( sel_context *sc, int index )
+{
+     sc->changed = index;
+     sc->context_method ( SELECT_UPDATE, sc, sc->p, NULL );
+}
+
 /* exists_select_method()
  *
  * returns 1 if the named selection method exists, 0 otherwise.
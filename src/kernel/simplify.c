@@ -0,0 +1,437 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+
+#include "lilgp.h"
+
+/* evaluation-time simplification.
+ *
+ * before an individual is evaluated, its tree can be rewritten into a
+ * smaller program that computes exactly the same value for every
+ * fitness case.  the individual's own tree (its genotype) is untouched;
+ * only the program handed to evaluate_tree() or the jit changes.
+ *
+ * the rewriting relies on the prim field of the function table to know
+ * what a function computes:
+ *
+ *   - a primitive applied to constants is folded to a constant, by
+ *     calling its code, so folding is exact.
+ *   - x+0, 0+x, x-0, x*1, 1*x, x/1 become x.
+ *   - x/0 becomes 1 (protected division).
+ *   - x-x and x*0 become 0, and x/x becomes 1, when x is known to be
+ *     finite (inf-inf and inf*0 are NaN).
+ *   - the operands of + and * are ordered with any constant second.
+ *
+ * a subtree is only dropped if it is made entirely of primitives, so a
+ * user function with side effects is never skipped.  only identities
+ * that hold bit-for-bit in IEEE arithmetic are used -- rlog(exp(x)) is
+ * not x after rounding, so it is left alone.  input terminals are
+ * assumed to be finite.
+ *
+ * trees containing anything other than data functions, normal terminals
+ * and ERCs are returned unchanged.
+ */
+
+int simplify_enabled = 0;
+
+static void const_gen ( DATATYPE *d );
+static char *const_str ( DATATYPE d );
+
+/* folded constants need an ERC function to sit under.  (the tree
+   walkers recognize ERCs by a non-NULL ephem_gen.) */
+static function simplify_const = { NULL, const_gen, const_str, 0, "const",
+                                   TERM_ERC, -1, 0, PRIM_NONE, 0, -1 };
+
+/* each evaluation thread simplifies into its own buffer, and holds a
+   reference to each constant folded into its latest program. */
+static THREAD_LOCAL lnode *prog = NULL;
+static THREAD_LOCAL int prog_size = 0;
+static THREAD_LOCAL int used;
+static THREAD_LOCAL ephem_const **held = NULL;
+static THREAD_LOCAL int held_count = 0;
+static THREAD_LOCAL int held_size = 0;
+
+static long simplify_lnodes_in = 0;
+static long simplify_lnodes_out = 0;
+static long simplify_trees = 0;
+
+static void const_gen ( DATATYPE *d )
+{
+     *d = 0;
+}
+
+static char *const_str ( DATATYPE d )
+{
+     static char buffer[32];
+     sprintf ( buffer, "%.17g", (double)d );
+     return buffer;
+}
+
+/* initialize_simplify()
+ *
+ * reads the simplify parameter.
+ */
+
+void initialize_simplify ( void )
+{
+     char *param = get_parameter ( "simplify" );
+     simplify_enabled = ( param && atoi ( param ) );
+}
+
+/* simplify_register()
+ *
+ * folded constants sit under simplify_const, which needs an id for
+ * compact trees.  this is done before the first simplification, and
+ * before any evaluation threads start.
+ */
+
+void simplify_register ( void )
+{
+     if ( simplify_enabled && simplify_const.id == -1 )
+          register_function ( &simplify_const );
+}
+
+/* release_held()
+ *
+ * give up the constants folded into the last program.
+ */
+
+static void release_held ( void )
+{
+     while ( held_count > 0 )
+          ephem_drop ( held[--held_count] );
+}
+
+/* free_simplify_thread()
+ *
+ * free the calling thread's program buffers.
+ */
+
+void free_simplify_thread ( void )
+{
+     release_held();
+     FREE ( held );
+     held = NULL;
+     held_size = 0;
+     FREE ( prog );
+     prog = NULL;
+     prog_size = 0;
+}
+
+/* free_simplify()
+ *
+ * free the program buffers.  called before the ERC pool is freed.
+ */
+
+void free_simplify ( void )
+{
+     free_simplify_thread();
+     simplify_const.id = -1;
+}
+
+/* output_simplify_stats()
+ *
+ * print how much the simplifier removed, at the end of the run.
+ */
+
+void output_simplify_stats ( void )
+{
+     if ( !simplify_enabled )
+          return;
+     oprintf ( OUT_SYS, 30, "\n------- simplification -------\n" );
+     oprintf ( OUT_SYS, 30, "               trees:      %ld\n", simplify_trees );
+     oprintf ( OUT_SYS, 30, "        lnodes input:      %ld\n", simplify_lnodes_in );
+     oprintf ( OUT_SYS, 30, "       lnodes output:      %ld\n", simplify_lnodes_out );
+}
+
+/* emit()
+ *
+ * append an lnode to the program.
+ */
+
+static lnode *emit ( void )
+{
+     if ( used == prog_size )
+     {
+          prog_size = prog_size ? prog_size * 2 : SIMPLIFY_STARTSIZE;
+          prog = (lnode *)REALLOC ( prog, prog_size * sizeof ( lnode ) );
+     }
+     return prog + used++;
+}
+
+/* emit_const()
+ *
+ * append a constant to the program, stored the way the rest of the
+ * ERCs are.  a pooled constant is held until the next program is made,
+ * so a collection can't take it while the program is being evaluated.
+ */
+
+static void emit_const ( DATATYPE d )
+{
+     ephem_const *e;
+
+     LNODE_SETF ( *emit(), &simplify_const );
+#ifndef COMPACT_TREES
+     if ( ephem_inline )
+     {
+          emit()->v = d;
+          return;
+     }
+#endif
+     e = ephem_hold ( &simplify_const, d );
+     if ( held_count == held_size )
+     {
+          held_size = held_size ? held_size * 2 : SIMPLIFY_STARTSIZE;
+          held = (ephem_const **)REALLOC ( held, held_size *
+                                           sizeof ( ephem_const * ) );
+     }
+     held[held_count++] = e;
+     LNODE_SETD ( *emit(), e );
+}
+
+/* same_program()
+ *
+ * compares two stretches of the program.  they contain only data
+ * functions and terminals, so there are no skip nodes to worry about.
+ */
+
+static int same_program ( int a, int alen, int b, int blen )
+{
+     int i;
+     function *f;
+
+     if ( alen != blen )
+          return 0;
+     for ( i = 0; i < alen; ++i )
+     {
+          f = LNODE_F(prog[a+i]);
+          if ( f->type == TERM_ERC )
+          {
+               if ( LNODE_F(prog[b+i])->type != TERM_ERC ||
+                    ERC_VALUE(prog[a+i+1]) != ERC_VALUE(prog[b+i+1]) )
+                    return 0;
+               ++i;
+          }
+          else if ( f != LNODE_F(prog[b+i]) )
+               return 0;
+     }
+     return 1;
+}
+
+/* replace()
+ *
+ * replaces the node starting at start with one of its children.
+ */
+
+static void replace ( int start, int child, int len, simplify_info *info,
+                     simplify_info *cinfo )
+{
+     memmove ( prog+start, prog+child, len * sizeof ( lnode ) );
+     used = start + len;
+     *info = *cinfo;
+}
+
+/* replace_const()
+ *
+ * replaces the node starting at start with a constant.
+ */
+
+static void replace_const ( int start, DATATYPE d, simplify_info *info )
+{
+     used = start;
+     emit_const ( d );
+     info->constant = 1;
+     info->value = d;
+     info->finite = isfinite ( d );
+     info->pure = 1;
+}
+
+/* simplify_recurse()
+ *
+ * copies the subtree at *l into the program, simplifying as it goes.
+ * returns 0 if the subtree can't be handled.
+ */
+
+static int simplify_recurse ( lnode **l, simplify_info *info, int whichtree )
+{
+     function *f = LNODE_F(**l);
+     simplify_info cinfo[MAXARGS], tmp;
+     int cstart[MAXARGS+1];
+     farg args[MAXARGS];
+     lnode *swap;
+     int start = used;
+     int i, n;
+
+     ++*l;
+     LNODE_SETF ( *emit(), f );
+
+     switch ( f->type )
+     {
+        case TERM_ERC:
+          info->constant = 1;
+          info->value = ERC_VALUE(**l);
+          info->finite = isfinite ( info->value );
+          info->pure = 1;
+          *emit() = **l;
+          ++*l;
+          return 1;
+        case TERM_NORM:
+          info->constant = 0;
+          info->pure = info->finite = ( f->prim == PRIM_INPUT );
+          return 1;
+        case FUNC_DATA:
+          break;
+        default:
+          return 0;
+     }
+
+     info->constant = 1;
+     info->pure = ( f->prim != PRIM_NONE );
+     for ( i = 0; i < f->arity; ++i )
+     {
+          cstart[i] = used;
+          if ( !simplify_recurse ( l, cinfo+i, whichtree ) )
+               return 0;
+          info->constant &= cinfo[i].constant;
+          info->pure &= cinfo[i].pure;
+     }
+     cstart[i] = used;
+
+     /* fold primitives of constants. */
+     if ( info->constant && f->prim != PRIM_NONE )
+     {
+          for ( i = 0; i < f->arity; ++i )
+               args[i].d = cinfo[i].value;
+          replace_const ( start, (f->code)(whichtree, args), info );
+          return 1;
+     }
+     info->constant = 0;
+
+     switch ( f->prim )
+     {
+        case PRIM_SIN:
+        case PRIM_COS:
+        case PRIM_RLOG:
+          info->finite = cinfo[0].finite;
+          return 1;
+        case PRIM_ADD:
+        case PRIM_SUB:
+        case PRIM_MUL:
+        case PRIM_PDIV:
+          info->finite = 0;
+          if ( f->arity == 2 )
+               break;
+          return 1;
+        default:
+          info->finite = 0;
+          return 1;
+     }
+
+     /* put a constant operand of a commutative primitive second. */
+     if ( ( f->prim == PRIM_ADD || f->prim == PRIM_MUL ) &&
+          cinfo[0].constant )
+     {
+          n = cstart[1] - cstart[0];
+          swap = (lnode *)MALLOC ( n * sizeof ( lnode ) );
+          memcpy ( swap, prog+cstart[0], n * sizeof ( lnode ) );
+          memmove ( prog+cstart[0], prog+cstart[1],
+                   ( cstart[2] - cstart[1] ) * sizeof ( lnode ) );
+          memcpy ( prog+cstart[0]+(cstart[2]-cstart[1]), swap,
+                  n * sizeof ( lnode ) );
+          FREE ( swap );
+          cstart[1] = cstart[0] + ( cstart[2] - cstart[1] );
+          tmp = cinfo[0];
+          cinfo[0] = cinfo[1];
+          cinfo[1] = tmp;
+     }
+
+#define RIGHT_IS(c)  ( cinfo[1].constant && cinfo[1].value == (c) )
+     
+     switch ( f->prim )
+     {
+        case PRIM_ADD:
+        case PRIM_SUB:
+          if ( RIGHT_IS(0.0) )
+               replace ( start, cstart[0], cstart[1]-cstart[0], info, cinfo );
+          else if ( f->prim == PRIM_SUB && cinfo[0].pure && cinfo[0].finite &&
+                    same_program ( cstart[0], cstart[1]-cstart[0],
+                                  cstart[1], cstart[2]-cstart[1] ) )
+               replace_const ( start, 0.0, info );
+          break;
+        case PRIM_MUL:
+          if ( RIGHT_IS(1.0) )
+               replace ( start, cstart[0], cstart[1]-cstart[0], info, cinfo );
+          else if ( RIGHT_IS(0.0) && cinfo[0].pure && cinfo[0].finite )
+               replace_const ( start, 0.0, info );
+          break;
+        case PRIM_PDIV:
+          if ( RIGHT_IS(1.0) )
+               replace ( start, cstart[0], cstart[1]-cstart[0], info, cinfo );
+          else if ( RIGHT_IS(0.0) && cinfo[0].pure )
+               replace_const ( start, 1.0, info );
+          else if ( cinfo[0].pure && cinfo[0].finite &&
+                    same_program ( cstart[0], cstart[1]-cstart[0],
+                                  cstart[1], cstart[2]-cstart[1] ) )
+               replace_const ( start, 1.0, info );
+          break;
+     }
+
+#undef RIGHT_IS
+     
+     return 1;
+}
+
+/* simplify_tree()
+ *
+ * returns the simplified program for a tree, or the tree itself if
+ * simplification is off or the tree can't be simplified.  the program
+ * returned is valid until the next call.
+ */
+
+lnode *simplify_tree ( lnode *data, int whichtree )
+{
+     simplify_info info;
+     lnode *l = data;
+     int n;
+
+     if ( !simplify_enabled )
+          return data;
+
+     simplify_register();
+     release_held();
+     
+     n = tree_size ( data );
+     used = 0;
+
+     if ( !simplify_recurse ( &l, &info, whichtree ) )
+          return data;
+
+     ATOMIC_ADD ( simplify_trees, 1 );
+     ATOMIC_ADD ( simplify_lnodes_in, n );
+     ATOMIC_ADD ( simplify_lnodes_out, used );
+     return prog;
+}
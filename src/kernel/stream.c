@@ -0,0 +1,429 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+#include "lilgp.h"
+
+#ifdef THREADS_AVAILABLE
+#include <pthread.h>
+#endif
+
+/* out-of-core fitness cases.
+ *
+ * with eval.engine = stream, the fitness cases are not held in memory.
+ * they are read from the binary dataset named by "eval.stream.file" (a
+ * stream_header, then the rows) "eval.stream.rows" rows at a time, and
+ * the tiled engine runs the whole population over each chunk in turn,
+ * each individual's error accumulating across the chunks.
+ *
+ * there are two chunk buffers.  a reader thread fills one while the
+ * population is evaluated on the other, and once a pass over the
+ * dataset is finished it starts on the first chunk of the next pass,
+ * so the read overlaps breeding as well.  without threads the chunks
+ * are read as they are needed.
+ *
+ * every individual must be something the tiled engine can run:  there
+ * is no copy of the cases for app_eval_fitness() to use.
+ */
+
+static FILE *stream_file = NULL;
+static char *stream_name;
+static int width;
+static int64_t total_rows;
+static int chunk_rows;
+static int chunk_count;
+
+/* each buffer holds the rows as read, and then by column. */
+static DATATYPE *raw[2];
+static DATATYPE *column[2];
+static DATATYPE **input_ptr[2];
+static int loaded[2];
+
+/* the chunk being evaluated, the dataset row it starts at, and
+   whether the first chunk of the next pass has been asked for. */
+static int current;
+static int current_row = 0;
+static int prefetched;
+
+static long stream_chunks = 0;
+static long stream_waits = 0;
+static double stream_bytes = 0.0;
+
+#ifdef THREADS_AVAILABLE
+
+static pthread_t reader_thread;
+static int reader_running = 0;
+static pthread_mutex_t stream_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t request_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t loaded_cond = PTHREAD_COND_INITIALIZER;
+
+/* chunks asked for, oldest first. */
+static int requests[2];
+static int request_count;
+static int reader_quit;
+
+#endif
+
+/* chunk_length()
+ *
+ * the number of rows in a chunk.
+ */
+
+static int chunk_length ( int chunk )
+{
+     int64_t left = total_rows - (int64_t)chunk * chunk_rows;
+     
+     return left < chunk_rows ? (int)left : chunk_rows;
+}
+
+/* load_chunk()
+ *
+ * read a chunk into its buffer, and store it by column.
+ */
+
+static void load_chunk ( int chunk )
+{
+     int b = chunk % 2;
+     int n = chunk_length ( chunk );
+     int i, j;
+     DATATYPE *r, *c;
+
+     if ( fseeko ( stream_file, (off_t)sizeof ( stream_header ) +
+                  (off_t)chunk * chunk_rows * width * sizeof ( DATATYPE ),
+                  SEEK_SET ) ||
+          fread ( raw[b], width * sizeof ( DATATYPE ), n, stream_file ) != n )
+          error ( E_FATAL_ERROR, "can't read chunk %d of \"%s\".", chunk,
+                 stream_name );
+
+     for ( j = 0; j < width; ++j )
+     {
+          r = raw[b] + j;
+          c = column[b] + (size_t)j * chunk_rows;
+          for ( i = 0; i < n; ++i, r += width )
+               c[i] = *r;
+     }
+
+     ++stream_chunks;
+     stream_bytes += (double)n * width * sizeof ( DATATYPE );
+}
+
+#ifdef THREADS_AVAILABLE
+
+/* reader()
+ *
+ * the reader thread:  load the chunks asked for, one at a time.
+ */
+
+static void *reader ( void *arg )
+{
+     int chunk;
+
+     pthread_mutex_lock ( &stream_mutex );
+     while ( 1 )
+     {
+          while ( request_count == 0 && !reader_quit )
+               pthread_cond_wait ( &request_cond, &stream_mutex );
+          if ( reader_quit )
+               break;
+          chunk = requests[0];
+          pthread_mutex_unlock ( &stream_mutex );
+
+          load_chunk ( chunk );
+
+          pthread_mutex_lock ( &stream_mutex );
+          requests[0] = requests[1];
+          --request_count;
+          loaded[chunk%2] = chunk;
+          pthread_cond_broadcast ( &loaded_cond );
+     }
+     pthread_mutex_unlock ( &stream_mutex );
+     return NULL;
+}
+
+#endif
+
+/* request()
+ *
+ * ask for a chunk to be loaded.  its buffer must be free.
+ */
+
+static void request ( int chunk )
+{
+#ifdef THREADS_AVAILABLE
+     if ( reader_running )
+     {
+          pthread_mutex_lock ( &stream_mutex );
+          loaded[chunk%2] = -1;
+          requests[request_count++] = chunk;
+          pthread_cond_signal ( &request_cond );
+          pthread_mutex_unlock ( &stream_mutex );
+          return;
+     }
+#endif
+     load_chunk ( chunk );
+     loaded[chunk%2] = chunk;
+}
+
+/* use_chunk()
+ *
+ * wait for a chunk to be loaded, and point the caseset at it.  returns
+ * its number of rows.
+ */
+
+static int use_chunk ( int chunk )
+{
+     int b = chunk % 2;
+
+#ifdef THREADS_AVAILABLE
+     pthread_mutex_lock ( &stream_mutex );
+     if ( loaded[b] != chunk )
+     {
+          ++stream_waits;
+          while ( loaded[b] != chunk )
+               pthread_cond_wait ( &loaded_cond, &stream_mutex );
+     }
+     pthread_mutex_unlock ( &stream_mutex );
+#endif
+     
+     current = chunk;
+     current_row = chunk * chunk_rows;
+     cases.cases = chunk_length ( chunk );
+     cases.input = input_ptr[b];
+     cases.target = column[b] + (size_t)( width - 1 ) * chunk_rows;
+     return cases.cases;
+}
+
+/* stream_rows()
+ *
+ * the number of cases in the dataset.
+ */
+
+int stream_rows ( void )
+{
+     return (int)total_rows;
+}
+
+/* stream_offset()
+ *
+ * the dataset row that case 0 of the chunk being evaluated is, or 0
+ * between passes.
+ */
+
+int stream_offset ( void )
+{
+     return current_row;
+}
+
+/* stream_first()
+ *
+ * start a pass over the dataset.  points the caseset at the first
+ * chunk and returns its number of rows.
+ */
+
+int stream_first ( void )
+{
+     if ( !prefetched )
+          request ( 0 );
+     prefetched = 0;
+     if ( chunk_count > 1 )
+          request ( 1 );
+     return use_chunk ( 0 );
+}
+
+/* stream_next()
+ *
+ * move on to the next chunk, asking for the one after it.  returns the
+ * chunk's number of rows, or 0 at the end of the pass (when the
+ * caseset describes the whole dataset again, and the next pass's first
+ * chunk is asked for).
+ */
+
+int stream_next ( void )
+{
+     int next = current + 1;
+
+     if ( next == chunk_count )
+     {
+          cases.cases = (int)total_rows;
+          cases.input = NULL;
+          cases.target = NULL;
+          current_row = 0;
+          request ( 0 );
+          prefetched = 1;
+          return 0;
+     }
+
+     /* the buffer of the chunk just finished takes the one after
+	next. */
+     if ( next + 1 < chunk_count )
+          request ( next + 1 );
+     return use_chunk ( next );
+}
+
+/* read_header()
+ *
+ * read and check a dataset's header.
+ */
+
+static void read_header ( FILE *f, char *name, stream_header *h )
+{
+     if ( fread ( h, sizeof ( stream_header ), 1, f ) != 1 ||
+          memcmp ( h->magic, STREAM_MAGIC, 8 ) )
+          error ( E_FATAL_ERROR, "\"%s\" is not a dataset.", name );
+     if ( h->inputs < 1 || h->rows < 1 || h->rows > INT_MAX )
+          error ( E_FATAL_ERROR, "dataset \"%s\" has a bad header.", name );
+}
+
+/* stream_file_inputs()
+ *
+ * the number of inputs in the dataset named by "eval.stream.file".
+ * the application needs this to build its input terminals, which it
+ * may do before the dataset is opened (when restarting from a
+ * checkpoint).
+ */
+
+int stream_file_inputs ( void )
+{
+     stream_header h;
+     char *name;
+     FILE *f;
+
+     name = get_parameter ( "eval.stream.file" );
+     if ( name == NULL )
+          error ( E_FATAL_ERROR, "eval.engine = stream needs \"eval.stream.file\"." );
+     f = fopen ( name, "rb" );
+     if ( f == NULL )
+          error ( E_FATAL_ERROR, "can't open dataset \"%s\".", name );
+     read_header ( f, name, &h );
+     fclose ( f );
+     return h.inputs;
+}
+
+/* stream_open()
+ *
+ * open the dataset, check its header, and set up the buffers and the
+ * reader thread.
+ */
+
+void stream_open ( void )
+{
+     stream_header h;
+     char *param;
+     int b, i;
+
+     stream_name = get_parameter ( "eval.stream.file" );
+     if ( stream_name == NULL )
+          error ( E_FATAL_ERROR, "eval.engine = stream needs \"eval.stream.file\"." );
+     stream_file = fopen ( stream_name, "rb" );
+     if ( stream_file == NULL )
+          error ( E_FATAL_ERROR, "can't open dataset \"%s\".", stream_name );
+     read_header ( stream_file, stream_name, &h );
+
+     param = get_parameter ( "eval.stream.rows" );
+     chunk_rows = param ? atoi ( param ) : STREAM_ROWS;
+     if ( chunk_rows < 1 )
+          chunk_rows = STREAM_ROWS;
+     
+     width = h.inputs + 1;
+     total_rows = h.rows;
+     if ( chunk_rows > total_rows )
+          chunk_rows = (int)total_rows;
+     chunk_count = (int)( ( total_rows + chunk_rows - 1 ) / chunk_rows );
+
+     for ( b = 0; b < 2; ++b )
+     {
+          raw[b] = (DATATYPE *)MALLOC ( (size_t)chunk_rows * width *
+                                       sizeof ( DATATYPE ) );
+          column[b] = (DATATYPE *)MALLOC ( (size_t)chunk_rows * width *
+                                          sizeof ( DATATYPE ) );
+          input_ptr[b] = (DATATYPE **)MALLOC ( h.inputs * sizeof ( DATATYPE * ) );
+          for ( i = 0; i < h.inputs; ++i )
+               input_ptr[b][i] = column[b] + (size_t)i * chunk_rows;
+          loaded[b] = -1;
+     }
+     prefetched = 0;
+
+     cases.cases = (int)total_rows;
+     cases.inputs = h.inputs;
+     cases.input = NULL;
+     cases.target = NULL;
+
+#ifdef THREADS_AVAILABLE
+     request_count = 0;
+     reader_quit = 0;
+     reader_running = !pthread_create ( &reader_thread, NULL, reader, NULL );
+#endif
+     
+     oprintf ( OUT_SYS, 30, "    dataset %s:  %d inputs, %lld rows in %d chunks.\n",
+              stream_name, h.inputs, (long long)total_rows, chunk_count );
+}
+
+/* free_stream()
+ *
+ * stop the reader and close the dataset.
+ */
+
+void free_stream ( void )
+{
+     int b;
+     
+     if ( stream_file == NULL )
+          return;
+#ifdef THREADS_AVAILABLE
+     if ( reader_running )
+     {
+          pthread_mutex_lock ( &stream_mutex );
+          reader_quit = 1;
+          pthread_cond_signal ( &request_cond );
+          pthread_mutex_unlock ( &stream_mutex );
+          pthread_join ( reader_thread, NULL );
+          reader_running = 0;
+     }
+#endif
+     fclose ( stream_file );
+     stream_file = NULL;
+     for ( b = 0; b < 2; ++b )
+     {
+          FREE ( raw[b] );
+          FREE ( column[b] );
+          FREE ( input_ptr[b] );
+     }
+}
+
+/* output_casestream_stats()
+ *
+ * report the dataset reads at the end of the run.
+ */
+
+void output_casestream_stats ( void )
+{
+     if ( eval_engine != EVAL_ENGINE_STREAM )
+          return;
+     oprintf ( OUT_SYS, 30, "\n------- streamed cases -------\n" );
+     oprintf ( OUT_SYS, 30, "         chunks read:      %ld\n", stream_chunks );
+     oprintf ( OUT_SYS, 30, "          bytes read:      %.0f\n", stream_bytes );
+     oprintf ( OUT_SYS, 30, "      waits for read:      %ld\n", stream_waits );
+}
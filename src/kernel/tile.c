@@ -0,0 +1,595 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ * 
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ * 
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *  
+ */
+
+#include "lilgp.h"
+
+/* case-blocked evaluation.
+ *
+ * with eval.engine = tiled, the population is evaluated a batch of
+ * individuals at a time.  each individual's tree is turned into a
+ * postfix program; then the fitness cases are run through the whole
+ * batch one block at a time, every program computing its values for
+ * the block before the next block is touched.  a block of inputs (and
+ * the stack of values the programs work on) stays in cache while the
+ * batch runs over it, instead of all the cases streaming through once
+ * per individual.  each individual's error accumulates in its own
+ * record through the app's case scoring functions.
+ *
+ * "eval.tile.cases" sets the block size and "eval.tile.ops" the total
+ * program length of a batch.
+ *
+ * with "eval.float" on, the programs run in single precision, on float
+ * copies of the inputs:  twice the values per vector register and half
+ * the bandwidth.  sin, cos, exp and rlog use the float library
+ * functions.  individuals scored this way are flagged FLAG_FLOATFIT,
+ * and after each population is evaluated the best "output.bestn" of
+ * them are scored again in double, so the fitness reported for the
+ * best individuals (and written to the .bst and .fn files) is exact.
+ *
+ * like the dag engine, this needs the fitness cases registered with
+ * register_caseset(); individuals with anything but primitives, ERCs
+ * and input terminals, or with more than one tree, are evaluated with
+ * app_eval_fitness().
+ *
+ * the streaming engine (stream.c) runs here too, with the cases read a
+ * chunk at a time:  the whole population is one batch, run over each
+ * chunk in turn.
+ */
+
+static tileop *ops = NULL;
+static int ops_size = 0;
+static int op_count;
+
+/* the individuals of the current batch:  their numbers, where their
+   programs start, and the deepest stack any of them needs. */
+static int *batch = NULL;
+static int *batch_start = NULL;
+static int batch_size = 0;
+static int batch_count;
+static int batch_depth;
+
+static DATATYPE *stack = NULL;
+static size_t stack_size = 0;
+
+/* single precision:  the stack, and float copies of the inputs. */
+static int use_float;
+static float *fstack = NULL;
+static size_t fstack_size = 0;
+static float **finput = NULL;
+static int finput_count = 0;
+
+static int block_cases;
+static int batch_ops;
+
+static long tile_trees = 0;
+static long tile_fallback = 0;
+static long tile_blocks = 0;
+static long tile_rescored = 0;
+
+/* emit_op()
+ *
+ * append an instruction to the batch's programs.
+ */
+
+static tileop *emit_op ( function *f )
+{
+     if ( op_count == ops_size )
+     {
+          ops_size = ops_size ? ops_size * 2 : TILE_OPS;
+          ops = (tileop *)REALLOC ( ops, ops_size * sizeof ( tileop ) );
+     }
+     ops[op_count].f = f;
+     return ops + op_count++;
+}
+
+/* compile_recurse()
+ *
+ * appends the postfix program for the subtree at *l.  returns the stack
+ * depth it needs, or 0 if the subtree contains anything the engine
+ * can't evaluate.
+ */
+
+static int compile_recurse ( lnode **l )
+{
+     function *f = LNODE_F(**l);
+     int i, d, depth = 0;
+
+     ++*l;
+     switch ( f->type )
+     {
+        case TERM_ERC:
+          emit_op ( f )->value = ERC_VALUE(**l);
+          ++*l;
+          return 1;
+        case TERM_NORM:
+          if ( f->prim != PRIM_INPUT || f->input >= cases.inputs )
+               return 0;
+          emit_op ( f );
+          return 1;
+        case FUNC_DATA:
+          if ( f->prim == PRIM_NONE )
+               return 0;
+	  /* child i sits on top of i values already pushed. */
+          for ( i = 0; i < f->arity; ++i )
+          {
+               if ( ( d = compile_recurse ( l ) ) == 0 )
+                    return 0;
+               if ( i + d > depth )
+                    depth = i + d;
+          }
+          emit_op ( f );
+          return depth;
+     }
+     return 0;
+}
+
+/* run_program()
+ *
+ * runs one program over cases c0 .. c0+b-1, returning its values.
+ */
+
+static DATATYPE *run_program ( tileop *op, tileop *end, int c0, int b )
+{
+     DATATYPE *top = stack - b;
+     DATATYPE *v, *y;
+     farg args[MAXARGS];
+     function *f;
+     int j, k, a;
+
+     for ( ; op < end; ++op )
+     {
+          f = op->f;
+          switch ( f->type )
+          {
+             case TERM_ERC:
+               top += b;
+               for ( j = 0; j < b; ++j )
+                    top[j] = op->value;
+               continue;
+             case TERM_NORM:
+               top += b;
+               memcpy ( top, cases.input[f->input]+c0, b * sizeof ( DATATYPE ) );
+               continue;
+          }
+
+	  /* the arguments are the top arity vectors; the result replaces
+	     the first. */
+          a = f->arity;
+          v = top - (size_t)( a - 1 ) * b;
+          y = v + b;
+          switch ( f->prim )
+          {
+             case PRIM_ADD:
+               for ( j = 0; j < b; ++j )
+                    v[j] = v[j] + y[j];
+               break;
+             case PRIM_SUB:
+               for ( j = 0; j < b; ++j )
+                    v[j] = v[j] - y[j];
+               break;
+             case PRIM_MUL:
+               for ( j = 0; j < b; ++j )
+                    v[j] = v[j] * y[j];
+               break;
+             case PRIM_PDIV:
+               for ( j = 0; j < b; ++j )
+                    v[j] = ( y[j] == 0.0 ) ? 1.0 : v[j] / y[j];
+               break;
+             default:
+	       /* other primitives are called case by case. */
+               for ( j = 0; j < b; ++j )
+               {
+                    for ( k = 0; k < a; ++k )
+                         args[k].d = v[(size_t)k * b + j];
+                    v[j] = (f->code)(0, args);
+               }
+               break;
+          }
+          top = v;
+     }
+     return top;
+}
+
+/* run_program_float()
+ *
+ * run_program() in single precision.
+ */
+
+static float *run_program_float ( tileop *op, tileop *end, int c0, int b )
+{
+     float *top = fstack - b;
+     float *v, *y;
+     float d;
+     farg args[MAXARGS];
+     function *f;
+     int j, k, a;
+
+     for ( ; op < end; ++op )
+     {
+          f = op->f;
+          switch ( f->type )
+          {
+             case TERM_ERC:
+               top += b;
+               d = (float)op->value;
+               for ( j = 0; j < b; ++j )
+                    top[j] = d;
+               continue;
+             case TERM_NORM:
+               top += b;
+               memcpy ( top, finput[f->input]+c0, b * sizeof ( float ) );
+               continue;
+          }
+
+          a = f->arity;
+          v = top - (size_t)( a - 1 ) * b;
+          y = v + b;
+          switch ( f->prim )
+          {
+             case PRIM_ADD:
+               for ( j = 0; j < b; ++j )
+                    v[j] = v[j] + y[j];
+               break;
+             case PRIM_SUB:
+               for ( j = 0; j < b; ++j )
+                    v[j] = v[j] - y[j];
+               break;
+             case PRIM_MUL:
+               for ( j = 0; j < b; ++j )
+                    v[j] = v[j] * y[j];
+               break;
+             case PRIM_PDIV:
+               for ( j = 0; j < b; ++j )
+                    v[j] = ( y[j] == 0.0f ) ? 1.0f : v[j] / y[j];
+               break;
+             case PRIM_SIN:
+               for ( j = 0; j < b; ++j )
+                    v[j] = sinf ( v[j] );
+               break;
+             case PRIM_COS:
+               for ( j = 0; j < b; ++j )
+                    v[j] = cosf ( v[j] );
+               break;
+             case PRIM_EXP:
+               for ( j = 0; j < b; ++j )
+                    v[j] = expf ( v[j] );
+               break;
+             case PRIM_RLOG:
+               for ( j = 0; j < b; ++j )
+                    v[j] = ( v[j] == 0.0f ) ? 0.0f : logf ( fabsf ( v[j] ) );
+               break;
+             default:
+               for ( j = 0; j < b; ++j )
+               {
+                    for ( k = 0; k < a; ++k )
+                         args[k].d = v[(size_t)k * b + j];
+                    v[j] = (float)(f->code)(0, args);
+               }
+               break;
+          }
+          top = v;
+     }
+     return top;
+}
+
+/* make_finput()
+ *
+ * the float copies of the inputs, made once.
+ */
+
+static void make_finput ( void )
+{
+     int i, c;
+
+     if ( finput )
+          return;
+     finput_count = cases.inputs;
+     finput = (float **)MALLOC ( finput_count * sizeof ( float * ) );
+     for ( i = 0; i < finput_count; ++i )
+     {
+          finput[i] = (float *)MALLOC ( cases.cases * sizeof ( float ) );
+          for ( c = 0; c < cases.cases; ++c )
+               finput[i][c] = (float)cases.input[i][c];
+     }
+}
+
+/* run_block()
+ *
+ * run every program of the batch over one block of cases, and score
+ * the values.
+ */
+
+static void run_block ( population *pop, int c0, int b )
+{
+     DATATYPE *v;
+     float *fv;
+     int i, j, k;
+     
+     for ( i = 0; i < batch_count; ++i )
+     {
+          k = batch[i];
+          population_No = k;
+          if ( use_float )
+          {
+               fv = run_program_float ( ops+batch_start[i],
+                                       ops+batch_start[i+1], c0, b );
+               for ( j = 0; j < b; ++j )
+                    app_score_case ( pop->ind+k, c0+j, fv[j] );
+          }
+          else
+          {
+               v = run_program ( ops+batch_start[i], ops+batch_start[i+1],
+                                c0, b );
+               for ( j = 0; j < b; ++j )
+                    app_score_case ( pop->ind+k, c0+j, v[j] );
+          }
+     }
+     ++tile_blocks;
+}
+
+/* run_batch()
+ *
+ * score the batch on every case, a block at a time, and finish it.
+ */
+
+static void run_batch ( population *pop )
+{
+     size_t need;
+     int c0, b, i, n;
+
+     if ( batch_count == 0 )
+          return;
+
+     b = block_cases;
+     if ( b > cases.cases )
+          b = cases.cases;
+     need = (size_t)batch_depth * b;
+     if ( use_float && need > fstack_size )
+     {
+          fstack_size = need;
+          fstack = (float *)REALLOC ( fstack, fstack_size * sizeof ( float ) );
+     }
+     else if ( !use_float && need > stack_size )
+     {
+          stack_size = need;
+          stack = (DATATYPE *)REALLOC ( stack, stack_size * sizeof ( DATATYPE ) );
+     }
+
+     for ( i = 0; i < batch_count; ++i )
+     {
+          population_No = batch[i];
+          app_begin_cases ( pop->ind+batch[i] );
+     }
+     
+     /* streamed cases come a chunk at a time; case numbers are within
+	the chunk. */
+     n = eval_engine == EVAL_ENGINE_STREAM ? stream_first() : cases.cases;
+     while ( n > 0 )
+     {
+          b = block_cases < n ? block_cases : n;
+          for ( c0 = 0; c0 < n; c0 += b )
+          {
+               if ( c0 + b > n )
+                    b = n - c0;
+               run_block ( pop, c0, b );
+          }
+          n = eval_engine == EVAL_ENGINE_STREAM ? stream_next() : 0;
+     }
+
+     for ( i = 0; i < batch_count; ++i )
+     {
+          population_No = batch[i];
+          app_end_cases ( pop->ind+batch[i] );
+          if ( use_float )
+               pop->ind[batch[i]].flags |= FLAG_FLOATFIT;
+     }
+
+     batch_count = 0;
+     batch_depth = 0;
+     op_count = 0;
+}
+
+/* rescore_best()
+ *
+ * score the best n individuals of the population in double, until none
+ * of the best n has a single-precision fitness.
+ */
+
+static void rescore_best ( population *pop, int n )
+{
+     individual **best;
+     individual *ind;
+     int i, j, k, m, again;
+
+     if ( n > pop->size )
+          n = pop->size;
+     best = (individual **)MALLOC ( n * sizeof ( individual * ) );
+
+     do
+     {
+	  /* insertion into a short list, best first. */
+          m = 0;
+          for ( k = 0; k < pop->size; ++k )
+          {
+               ind = pop->ind+k;
+               if ( m == n && ind->a_fitness <= best[m-1]->a_fitness )
+                    continue;
+               for ( j = ( m < n ? m++ : m-1 );
+                     j > 0 && best[j-1]->a_fitness < ind->a_fitness; --j )
+                    best[j] = best[j-1];
+               best[j] = ind;
+          }
+
+          again = 0;
+          for ( i = 0; i < m; ++i )
+               if ( best[i]->flags & FLAG_FLOATFIT )
+               {
+                    population_No = best[i] - pop->ind;
+                    app_eval_fitness ( best[i] );
+                    best[i]->flags &= ~FLAG_FLOATFIT;
+                    ++tile_rescored;
+                    again = 1;
+               }
+     }
+     while ( again );
+
+     FREE ( best );
+}
+
+/* tile_evaluate_pop()
+ *
+ * evaluates the individuals of a population that need it.
+ */
+
+void tile_evaluate_pop ( population *pop )
+{
+     char *param;
+     lnode *l;
+     int k, d, start, streaming;
+
+     param = get_parameter ( "eval.tile.cases" );
+     block_cases = param ? atoi ( param ) : TILE_CASES;
+     if ( block_cases < 1 )
+          block_cases = TILE_CASES;
+     param = get_parameter ( "eval.tile.ops" );
+     batch_ops = param ? atoi ( param ) : TILE_OPS;
+     if ( batch_ops < 1 )
+          batch_ops = TILE_OPS;
+     param = get_parameter ( "eval.float" );
+     use_float = param ? atoi ( param ) : 0;
+     streaming = eval_engine == EVAL_ENGINE_STREAM;
+     if ( streaming )
+     {
+	  /* one pass over the dataset for the whole population, and no
+	     double copy of the cases to rescore from. */
+          batch_ops = INT_MAX;
+          use_float = 0;
+     }
+     if ( use_float )
+          make_finput();
+
+     if ( pop->size + 1 > batch_size )
+     {
+          batch_size = pop->size + 1;
+          batch = (int *)REALLOC ( batch, batch_size * sizeof ( int ) );
+          batch_start = (int *)REALLOC ( batch_start, batch_size * sizeof ( int ) );
+     }
+     batch_count = 0;
+     batch_depth = 0;
+     op_count = 0;
+
+     for ( k = 0; k < pop->size; ++k )
+     {
+          if ( pop->ind[k].evald == EVAL_CACHE_VALID )
+               continue;
+
+	  /* the program copies the simplified tree's constants, so it
+	     outlives the simplifier's buffer. */
+          start = op_count;
+          d = 0;
+          if ( tree_count == 1 )
+          {
+               l = simplify_tree ( pop->ind[k].tr[0].data, 0 );
+               d = compile_recurse ( &l );
+          }
+          if ( d == 0 )
+          {
+               if ( streaming )
+                    error ( E_FATAL_ERROR, "eval.engine = stream can't evaluate individual %d.", k );
+               op_count = start;
+               population_No = k;
+               app_eval_fitness ( pop->ind+k );
+               pop->ind[k].flags &= ~FLAG_FLOATFIT;
+               ++tile_fallback;
+               continue;
+          }
+          
+          batch[batch_count] = k;
+          batch_start[batch_count++] = start;
+          batch_start[batch_count] = op_count;
+          if ( d > batch_depth )
+               batch_depth = d;
+          ++tile_trees;
+
+          if ( op_count >= batch_ops )
+               run_batch ( pop );
+     }
+     run_batch ( pop );
+
+     if ( use_float )
+     {
+          param = get_parameter ( "output.bestn" );
+          rescore_best ( pop, param ? atoi ( param ) : 1 );
+     }
+}
+
+/* free_tile()
+ *
+ * frees the engine's storage.
+ */
+
+void free_tile ( void )
+{
+     int i;
+     
+     FREE ( ops );
+     FREE ( batch );
+     FREE ( batch_start );
+     FREE ( stack );
+     FREE ( fstack );
+     for ( i = 0; i < finput_count; ++i )
+          FREE ( finput[i] );
+     FREE ( finput );
+     ops = NULL;
+     fstack = NULL;
+     finput = NULL;
+     fstack_size = 0;
+     finput_count = 0;
+     batch = batch_start = NULL;
+     stack = NULL;
+     ops_size = batch_size = 0;
+     stack_size = 0;
+}
+
+/* output_tile_stats()
+ *
+ * print how the tiled engine's work went, at the end of the run.
+ */
+
+void output_tile_stats ( void )
+{
+     if ( eval_engine != EVAL_ENGINE_TILED &&
+          eval_engine != EVAL_ENGINE_STREAM )
+          return;
+     oprintf ( OUT_SYS, 30, "\n------- tiled evaluation -------\n" );
+     oprintf ( OUT_SYS, 30, "               trees:      %ld\n", tile_trees );
+     oprintf ( OUT_SYS, 30, "           not tiled:      %ld\n", tile_fallback );
+     oprintf ( OUT_SYS, 30, "        batch-blocks:      %ld\n", tile_blocks );
+     if ( tile_rescored )
+          oprintf ( OUT_SYS, 30, "  rescored in double:      %ld\n",
+                   tile_rescored );
+}
@@ -119,4 +119,58 @@ int select_tournament ( sel_context *sc )
      return j;
 }
 
+/* select_inverse_tournament_context()
+ *
+ * returns a selection context for the inverse_tournament method, which
+ * takes the same options as tournament but picks the worst contestant.
+ * it is meant for choosing who an offspring replaces in steady-state
+ * runs.
+ */
+
+sel_context *select_inverse_tournament_context ( int op, sel_context *sc,
+                                                population *p, char *string )
+{
+     switch ( op )
+     {
+        case SELECT_INIT:
+          sc = select_tournament_context ( SELECT_INIT, NULL, p, string );
+          sc->select_method = select_inverse_tournament;
+          sc->context_method = select_inverse_tournament_context;
+          return sc;
+          break;
+
+        case SELECT_CLEAN:
+          return select_tournament_context ( SELECT_CLEAN, sc, p, string );
+          break;
+     }
+
+     return NULL;
+}
+
+/* select_inverse_tournament()
+ *
+ * does an inverse tournament:  the worst of (size) uniformly chosen
+ * individuals is selected.
+ */
+
+int select_inverse_tournament ( sel_context *sc )
+{
+     int i, j, k;
+     tournament_data *td;
+     population *p;
+
+     td = (tournament_data *)(sc->data);
+     p = sc->p;
+
+     j = -1;
+     for ( i = 0; i < td->count; ++i )
+     {
+          k = random_int ( p->size );
+          if ( j == -1 || p->ind[k].a_fitness < p->ind[j].a_fitness )
+               j = k;
+     }
+
+     return j;
+}
+
 
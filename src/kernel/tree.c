@@ -35,8 +35,16 @@
  * sets up this pointer, then passes the address of that pointer [that's
  * an (lnode **)] to the recursive part.
  *
- * the first function in this file [tree_size()] is commented in detail,
- * others (which are just variations on this theme) are rather glossed over.
+ * the counting, searching and copying kernels that breeding and the
+ * statistics lean on [tree_nodes(), tree_depth(), tree_size(),
+ * get_subtree(), copy_tree_replace_many() and friends] don't recurse.
+ * they scan the prefix layout with a treewalk instead:  a small explicit
+ * stack holding, for every nonterminal whose children are still being
+ * visited, a countdown of the children left.  the stack lives on the C
+ * stack and only moves to the heap for very deep trees.  when no function
+ * set has EXPR functions there are no skip nodes, and the kernels that
+ * don't need depth get by with a single countdown:  the number of
+ * subtrees still to be read, to which each node adds (arity-1).
  *
  * note:  when I refer to a tree's "size" I almost always mean "how many
  * lnodes the tree takes to store", NOT how many nodes are in the tree.
@@ -44,157 +52,302 @@
  * which returns the node count.)
  */
 
-/*
- * tree_nodes:  return the number of nodes in the tree.
+/* walk_begin()
+ *
+ * starts a treewalk at the root of a tree.  frame zero stands for the
+ * (imaginary) parent of the root, with one child left.
  */
 
-int tree_nodes ( lnode *tree )
+static void walk_begin ( treewalk *w, lnode *data )
 {
-     lnode *l = tree;
-     return tree_nodes_recurse ( &l );
+     w->p = data;
+     w->depth = 0;
+     w->top = 0;
+     w->size = WALK_STACKSIZE;
+     w->stack = w->local;
+     w->stack[0].left = 1;
+     w->stack[0].expr = 0;
+     w->stack[0].save = -1;
 }
 
-int tree_nodes_recurse ( lnode **l )
+/* walk_end()
+ *
+ * releases the heap stack, if the walk needed one.
+ */
+
+static void walk_end ( treewalk *w )
 {
-     /*
-      *  *l always points at a function node here; save the function.
-      */
-     function *f = (**l).f;
-     int i, j = 1;
+     if ( w->stack != w->local )
+          FREE ( w->stack );
+}
 
-     /* step the pointer over the function. */
-     ++*l;
+/* walk_push()
+ *
+ * pushes a frame for the children of nonterminal f.
+ */
 
-     /* if the function is a terminal, then the recursion bottoms out. */
+static void walk_push ( treewalk *w, function *f )
+{
+     walkframe *fr;
+
+     if ( ++w->top == w->size )
+     {
+          /* deeper than the local stack; move to the heap. */
+          if ( w->stack == w->local )
+          {
+               w->stack = (walkframe *)MALLOC ( 2 * w->size *
+                                               sizeof ( walkframe ) );
+               memcpy ( w->stack, w->local, w->size * sizeof ( walkframe ) );
+          }
+          else
+               w->stack = (walkframe *)REALLOC ( w->stack, 2 * w->size *
+                                                sizeof ( walkframe ) );
+          w->size *= 2;
+     }
+
+     fr = w->stack + w->top;
+     fr->left = f->arity;
+     fr->expr = ( f->type == FUNC_EXPR || f->type == EVAL_EXPR );
+     fr->save = -1;
+}
+
+/* walk_next()
+ *
+ * returns the address of the next node in preorder and steps over it
+ * (and its ERC, if it has one), or returns NULL once the whole tree has
+ * been visited.  w->depth is set to the depth of the returned node, and
+ * w->p is left pointing just past the tree at the end.
+ */
+
+static lnode *walk_next ( treewalk *w )
+{
+     walkframe *fr = w->stack + w->top;
+     function *f;
+     lnode *l;
+
+     /* pop the nonterminals whose children are all done. */
+     while ( fr->left == 0 )
+     {
+          if ( w->top == 0 )
+               return NULL;
+          fr = w->stack + --w->top;
+     }
+
+     --fr->left;
+     /* children of EXPR functions are preceded by a skip node. */
+     if ( fr->expr )
+          ++w->p;
+
+     l = w->p++;
+     w->depth = w->top;
+     f = LNODE_F(*l);
      if ( f->arity == 0 )
      {
-          /* skip the pointer over the ERC value if this node has one. */
           if ( f->ephem_gen )
-               ++*l;
-
-          /* return this subtree size. */
-          return 1;
+               ++w->p;
      }
      else
+          walk_push ( w, f );
+
+     return l;
+}
+
+/* scan_subtree()
+ *
+ * returns the address just past the subtree at l, using the stackless
+ * countdown.  only valid when !fset_has_expr.
+ */
+
+static lnode *scan_subtree ( lnode *l )
+{
+     function *f;
+     int left = 1;
+
+     do
      {
-          /* function is not a terminal, so add up its subtrees and return
-           * the total.
-           */
+          f = LNODE_F(*l);
+          l += f->ephem_gen ? 2 : 1;
+          left += f->arity - 1;
+     }
+     while ( left );
 
-          switch ( f->type )
+     return l;
+}
+
+/*
+ * tree_shape:  fills in the lnode count, node count, depth, and internal
+ *     and external node counts of a tree in a single pass.
+ */
+
+void tree_shape ( lnode *data, treeshape *s )
+{
+     treewalk w;
+     lnode *l;
+
+     s->nodes = s->depth = s->internal = s->external = 0;
+
+     walk_begin ( &w, data );
+     while ( ( l = walk_next ( &w ) ) != NULL )
+     {
+          ++s->nodes;
+          if ( LNODE_F(*l)->arity == 0 )
           {
-             case FUNC_DATA:
-             case EVAL_DATA:
-               for ( i = 0; i < f->arity; ++i )
-                    j += tree_nodes_recurse ( l );
-               break;
-               
-             case FUNC_EXPR:
-             case EVAL_EXPR:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    /* skip the pointer over the skipsize node. */
-                    ++*l;
-                    /* add this subtree's size to the total. */
-                    j += tree_nodes_recurse ( l );
-               }
-               break;
+               ++s->external;
+               /* the deepest node is always a terminal. */
+               if ( w.depth > s->depth )
+                    s->depth = w.depth;
           }
+          else
+               ++s->internal;
      }
-     
-     return j;
+     walk_end ( &w );
+
+     s->size = w.p - data;
 }
 
-/*
- * tree_nodes_internal:  return number of internal (function) nodes in the
- *     tree.
+/* hash_word()
+ *
+ * folds a word into a hash.
  */
 
-int tree_nodes_internal ( lnode *data )
+static uint64_t hash_word ( uint64_t h, uint64_t v )
 {
-     lnode *l = data;
-     return tree_nodes_internal_recurse ( &l );
+     h ^= v + 0x9e3779b97f4a7c15ULL + ( h << 6 ) + ( h >> 2 );
+     h *= 0xbf58476d1ce4e5b9ULL;
+     return h ^ ( h >> 31 );
 }
 
-int tree_nodes_internal_recurse ( lnode **l )
+/*
+ * tree_hash:  folds a tree into the two 64-bit hashes at h:  each node's
+ *     function (by its index in function_table) and the value of each
+ *     ERC, in preorder.  the result depends only on what the tree
+ *     computes as written, not on where it is stored or how its ERCs
+ *     are held.
+ */
+
+void tree_hash ( lnode *data, uint64_t *h )
 {
-     function *f = (**l).f;
-     int i, j = 1;
+     treewalk w;
+     lnode *l;
+     function *f;
+     DATATYPE d;
+     uint64_t bits;
 
-     ++*l;
-     
-     if ( f->arity == 0 )
+     walk_begin ( &w, data );
+     while ( ( l = walk_next ( &w ) ) != NULL )
      {
+          f = LNODE_F(*l);
+          h[0] = hash_word ( h[0], f->id );
+          h[1] = hash_word ( h[1] ^ 0x94d049bb133111ebULL, f->id );
           if ( f->ephem_gen )
-               ++*l;
-          return 0;
+          {
+               d = ERC_VALUE(l[1]);
+               bits = 0;
+               memcpy ( &bits, &d, sizeof ( DATATYPE ) < 8 ? sizeof ( DATATYPE ) : 8 );
+               h[0] = hash_word ( h[0], bits );
+               h[1] = hash_word ( h[1] ^ 0x94d049bb133111ebULL, bits );
+          }
      }
-     else
+     walk_end ( &w );
+}
+
+/*
+ * tree_nodes:  return the number of nodes in the tree.
+ */
+
+int tree_nodes ( lnode *tree )
+{
+     treewalk w;
+     function *f;
+     lnode *l = tree;
+     int j = 0, left = 1;
+
+     if ( !fset_has_expr )
      {
-          switch ( f->type )
+          do
           {
-             case FUNC_DATA:
-             case EVAL_DATA:
-               for ( i = 0; i < f->arity; ++i )
-                    j += tree_nodes_internal_recurse ( l );
-               break;
-             case FUNC_EXPR:
-             case EVAL_EXPR:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    ++*l;
-                    j += tree_nodes_internal_recurse ( l );
-               }
-               break;
+               f = LNODE_F(*l);
+               l += f->ephem_gen ? 2 : 1;
+               left += f->arity - 1;
+               ++j;
           }
+          while ( left );
+          return j;
      }
 
+     walk_begin ( &w, tree );
+     while ( walk_next ( &w ) != NULL )
+          ++j;
+     walk_end ( &w );
+
      return j;
 }
 
 /*
- * tree_nodes_external:  return number of external (terminal) nodes in the
+ * tree_nodes_internal:  return number of internal (function) nodes in the
  *     tree.
  */
 
-int tree_nodes_external ( lnode *data )
+int tree_nodes_internal ( lnode *data )
 {
+     treewalk w;
+     function *f;
      lnode *l = data;
-     return tree_nodes_external_recurse ( &l );
+     int j = 0, left = 1;
+
+     if ( !fset_has_expr )
+     {
+          do
+          {
+               f = LNODE_F(*l);
+               l += f->ephem_gen ? 2 : 1;
+               left += f->arity - 1;
+               j += ( f->arity != 0 );
+          }
+          while ( left );
+          return j;
+     }
+
+     walk_begin ( &w, data );
+     while ( ( l = walk_next ( &w ) ) != NULL )
+          if ( LNODE_F(*l)->arity != 0 )
+               ++j;
+     walk_end ( &w );
+
+     return j;
 }
 
-int tree_nodes_external_recurse ( lnode **l )
+/*
+ * tree_nodes_external:  return number of external (terminal) nodes in the
+ *     tree.
+ */
+
+int tree_nodes_external ( lnode *data )
 {
-     function *f = (**l).f;
-     int i, j = 0;
+     treewalk w;
+     function *f;
+     lnode *l = data;
+     int j = 0, left = 1;
 
-     ++*l;
-     
-     if ( f->arity == 0 )
+     if ( !fset_has_expr )
      {
-          if ( f->ephem_gen )
-               ++*l;
-          return 1;
-     }
-     else
-     {
-          switch ( f->type )
+          do
           {
-             case FUNC_DATA:
-             case EVAL_DATA:
-               for ( i = 0; i < f->arity; ++i )
-                    j += tree_nodes_external_recurse ( l ) ;
-               break;
-             case FUNC_EXPR:
-             case EVAL_EXPR:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    ++*l;
-                    j += tree_nodes_external_recurse ( l ) ;
-               }
-               break;
+               f = LNODE_F(*l);
+               l += f->ephem_gen ? 2 : 1;
+               left += f->arity - 1;
+               j += ( f->arity == 0 );
           }
+          while ( left );
+          return j;
      }
+
+     walk_begin ( &w, data );
+     while ( ( l = walk_next ( &w ) ) != NULL )
+          if ( LNODE_F(*l)->arity == 0 )
+               ++j;
+     walk_end ( &w );
+
      return j;
 }
 
@@ -212,7 +365,7 @@ void print_tree_array ( lnode *data )
 
 void print_tree_array_recurse ( lnode **l, int *index )
 {
-     function *f = (**l).f;
+     function *f = LNODE_F(**l);
      int i;
 
      printf ( "%3d: function: \"%s\"\n", *index, f->string );
@@ -224,7 +377,7 @@ void print_tree_array_recurse ( lnode **l, int *index )
      {
           if ( f->ephem_gen )
           {
-               printf ( "%3d:    value: %s\n", *index, (f->ephem_str)((**l).d->d) );
+               printf ( "%3d:    value: %s\n", *index, (f->ephem_str)(ERC_VALUE(**l)) );
                ++*l;
                ++*index;
           }
@@ -270,7 +423,7 @@ void print_tree_recurse ( lnode **l, FILE *fil )
      function *f;
      int i;
 
-     f = (**l).f;
+     f = LNODE_F(**l);
 
      fprintf ( fil, " " );
      if ( f->arity != 0 )
@@ -279,9 +432,10 @@ void print_tree_recurse ( lnode **l, FILE *fil )
      ++*l;
      if ( f->ephem_gen )
      {
-          fprintf ( fil, "%s", (f->ephem_str)((**l).d->d) );
+          fprintf ( fil, "%s", (f->ephem_str)(ERC_VALUE(**l)) );
 #ifdef DEBUG
-          fprintf ( fil, " <%d>", (**l).d->refcount );
+          if ( !ephem_inline )
+               fprintf ( fil, " <%d>", LNODE_D(**l)->refcount );
 #endif
           ++*l;
      }
@@ -332,18 +486,18 @@ void generate_random_full_tree ( int space, int depth, function_set *fset )
            */
           
           i = random_int(fset->terminal_count)+(fset->function_count);
-          gensp_next(space)->f = (fset->cset)+i;
+          LNODE_SETF ( *gensp_next(space), (fset->cset)+i );
 
           /* if this terminal is an ERC, then generate one and store it. */
           if ( (fset->cset)[i].ephem_gen )
-               gensp_next(space)->d = new_ephemeral_const ( (fset->cset)+i );
+               new_ephem_node ( gensp_next(space), (fset->cset)+i );
 
           return;
      }
 
      /* we're not a depth 0, so generate a non-terminal node. */
      i = random_int(fset->function_count);
-     gensp_next(space)->f = (fset->cset)+i;
+     LNODE_SETF ( *gensp_next(space), (fset->cset)+i );
 
      /* now generate the node's children. */
           switch ( (fset->cset)[i].type )
@@ -393,17 +547,17 @@ void generate_random_grow_tree ( int space, int depth, function_set *fset )
      if ( depth == 0 )
      {
           i = random_int(fset->terminal_count)+(fset->function_count);
-          gensp_next(space)->f = (fset->cset)+i;
+          LNODE_SETF ( *gensp_next(space), (fset->cset)+i );
 
           if ( (fset->cset)[i].ephem_gen )
-               gensp_next(space)->d = new_ephemeral_const ( (fset->cset)+i );
+               new_ephem_node ( gensp_next(space), (fset->cset)+i );
           
           return;
      }
 
      /* note that here we can generate a terminal node. */
      i = random_int(fset->function_count+fset->terminal_count);
-     gensp_next(space)->f = (fset->cset)+i;
+     LNODE_SETF ( *gensp_next(space), (fset->cset)+i );
      
      if ( (fset->cset)[i].arity )
      {
@@ -428,7 +582,7 @@ void generate_random_grow_tree ( int space, int depth, function_set *fset )
      else
      {
           if ( (fset->cset)[i].ephem_gen )
-               gensp_next(space)->d = new_ephemeral_const ( (fset->cset)+i );
+               new_ephem_node ( gensp_next(space), (fset->cset)+i );
      }
      return;
 }
@@ -440,52 +594,16 @@ void generate_random_grow_tree ( int space, int depth, function_set *fset )
 
 int tree_depth ( lnode *data )
 {
-     lnode *l = data;
-     return tree_depth_recurse ( &l );
-}
-
-int tree_depth_recurse ( lnode **l )
-{
-
-     function *f = (**l).f;
-     int i, j, k = 0;
+     treewalk w;
+     int k = 0;
 
-     ++*l;
-     if ( f->arity == 0 )
-     {
-          /* a terminal node; advance the pointer and return 0. */
-          
-          if ( f->ephem_gen )
-               ++*l;
-          return 0;
-     }
+     walk_begin ( &w, data );
+     while ( walk_next ( &w ) != NULL )
+          if ( w.depth > k )
+               k = w.depth;
+     walk_end ( &w );
 
-     /* a nonterminal; find the deepest child and return its depth plus one. */
-     
-          switch ( f->type )
-          {
-             case FUNC_DATA:
-             case EVAL_DATA:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    j = tree_depth_recurse ( l );
-                    if ( j > k )
-                         k = j;
-               }
-               break;
-             case FUNC_EXPR:
-             case EVAL_EXPR:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    ++*l;
-                    j = tree_depth_recurse ( l );
-                    if ( j > k )
-                         k = j;
-               }
-               break;
-          }
-     
-     return k+1;
+     return k;
 }
 
 int tree_depth_to_subtree ( lnode *data, lnode *sub )
@@ -496,7 +614,7 @@ int tree_depth_to_subtree ( lnode *data, lnode *sub )
 
 int tree_depth_to_subtree_recurse ( lnode **l, lnode *sub, int depth )
 {
-     function *f = (**l).f;
+     function *f = LNODE_F(**l);
      int i, j;
 
      if ( *l == sub )
@@ -538,201 +656,110 @@ int tree_depth_to_subtree_recurse ( lnode **l, lnode *sub, int depth )
      
 
 /*
- * get_subtree:  returns the start'th subtree of the tree, where start
- *     ranges from 0..(nodecount-1).  the zeroth subtree is the tree itself.
- *     the subtrees are returned in preorder.
+ * tree_subtrees:  lists every subtree of the tree in preorder:  its
+ *     address, node count and depth.  the arrays must have room for the
+ *     tree's node count.  the node counts are summed from the last node
+ *     back, since a node's children all follow it.
  */
 
-lnode *get_subtree ( lnode *data, int start )
-{
-     lnode *l = data;
-     /* initialize a counter with start.  the counter is passed by address,
-      * and so is shared across all recursive calls.  it is decremented once
-      * for every node in the tree -- the current node when it reaches zero
-      * is returned.
-      */
-     int c = start;
-     
-     return get_subtree_recurse ( &l, &c );
-}
-
-lnode *get_subtree_recurse ( lnode **l, int *c )
+void tree_subtrees ( lnode *data, lnode **node, int *nodes, int *depth )
 {
-     function *f = (**l).f;
-     lnode *r;
-     int i;
-
-     /* if the counter is zero, return the current subtree. */
-     if ( *c == 0 )
-          return *l;
-
-     ++*l;
-     --*c;
+     treewalk w;
+     lnode *l;
+     int n = 0;
+     int i, j, c, a;
 
-     if ( f->arity == 0 )
+     walk_begin ( &w, data );
+     while ( ( l = walk_next ( &w ) ) != NULL )
      {
-          /* skip over the terminal nodes. */
-          if ( f->ephem_gen )
-               ++*l;
+          node[n] = l;
+          depth[n++] = w.depth;
      }
-     else
+     walk_end ( &w );
+
+     for ( i = n - 1; i >= 0; --i )
      {
-          /* recurse into this node's children.  if one of them returns
-           * non-NULL, it means that the subtree has been found and the
-           * return value is immediately propagated up the call chain.
-           * if all of them return NULL, then the desired subtree is
-           * not in this subtree and we return NULL. */
-          
-          switch ( f->type )
-          {
-             case FUNC_DATA:
-             case EVAL_DATA:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    r = get_subtree_recurse ( l, c );
-                    if ( r != NULL )
-                         return r;
-               }
-               break;
-             case FUNC_EXPR:
-             case EVAL_EXPR:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    ++*l;
-                    r = get_subtree_recurse ( l, c );
-                    if ( r != NULL )
-                         return r;
-               }
-               break;
-          }
+          nodes[i] = 1;
+          a = LNODE_F(*node[i])->arity;
+          for ( c = 0, j = i + 1; c < a; ++c, j += nodes[j] )
+               nodes[i] += nodes[j];
      }
-
-     return NULL;
 }
 
 /*
- * get_subtree_internal:  just like get_subtree, but only selects nonterminal
- *     points.  start should range from 0..(internalnodecount-1).
+ * find_subtree:  returns the start'th node of the tree, in preorder,
+ *     counting only internal nodes, only external nodes, or both.  returns
+ *     NULL if there are not that many.
  */
 
-lnode *get_subtree_internal ( lnode *data, int start )
+static lnode *find_subtree ( lnode *data, int start, int internal,
+                            int external )
 {
+     treewalk w;
+     function *f;
      lnode *l = data;
-     int c = start;
-     return get_subtree_internal_recurse ( &l, &c );
-}
-
-lnode *get_subtree_internal_recurse ( lnode **l, int *c )
-{
-     function *f = (**l).f;
-     int i;
-     lnode *r;
+     int c = start, left = 1;
 
-     /* if the current subtree is a terminal node, skip it immediately. */
-     if ( f->arity == 0 )
+     if ( !fset_has_expr )
      {
-          if ( f->ephem_gen )
-               ++*l;
-          ++*l;
-     }
-     else
-     {
-          if ( *c == 0 )
-               return *l;
-
-          ++*l;
-          --*c;
-
-          switch ( f->type )
+          do
           {
-             case FUNC_DATA:
-             case EVAL_DATA:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    r = get_subtree_internal_recurse ( l, c );
-                    if ( r != NULL )
-                         return r;
-               }
-               break;
-             case FUNC_EXPR:
-             case EVAL_EXPR:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    ++*l;
-                    r = get_subtree_internal_recurse ( l, c );
-                    if ( r != NULL )
-                         return r;
-               }
-               break;
+               f = LNODE_F(*l);
+               if ( ( f->arity ? internal : external ) && c-- == 0 )
+                    return l;
+               l += f->ephem_gen ? 2 : 1;
+               left += f->arity - 1;
           }
+          while ( left );
+          return NULL;
      }
 
-     return NULL;
+     walk_begin ( &w, data );
+     while ( ( l = walk_next ( &w ) ) != NULL )
+          if ( LNODE_F(*l)->arity ? internal : external )
+               if ( c-- == 0 )
+                    break;
+     walk_end ( &w );
+
+     return l;
 }
 
 /*
- * get_subtree_external:  just like get_subtree, but only selects terminal
- *     nodes (that is, 1-node subtrees).  start ranges from
- *     0..(externalnodecount-1).
+ * get_subtree:  returns the start'th subtree of the tree, where start
+ *     ranges from 0..(nodecount-1).  the zeroth subtree is the tree itself.
+ *     the subtrees are returned in preorder.
  */
 
-lnode *get_subtree_external ( lnode *data, int start )
+lnode *get_subtree ( lnode *data, int start )
 {
-     lnode *l = data;
-     int c = start;
-     return get_subtree_external_recurse ( &l, &c );
+     return find_subtree ( data, start, 1, 1 );
 }
 
-lnode *get_subtree_external_recurse ( lnode **l, int *c )
-{
-     function *f = (**l).f;
-     int i;
-     lnode *r;
-
-     if ( f->arity == 0 )
-     {
-          if ( *c == 0 )
-               return *l;
-
-          ++*l;
-          --*c;
+/*
+ * get_subtree_internal:  just like get_subtree, but only selects nonterminal
+ *     points.  start should range from 0..(internalnodecount-1).
+ */
 
-          if ( f->ephem_gen )
-               ++*l;
-     }
-     else
-     {
-          ++*l;
+lnode *get_subtree_internal ( lnode *data, int start )
+{
+     return find_subtree ( data, start, 1, 0 );
+}
 
-          switch ( f->type )
-          {
-             case FUNC_DATA:
-             case EVAL_DATA:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    r = get_subtree_external_recurse ( l, c );
-                    if ( r != NULL )
-                         return r;
-               }
-               break;
-             case FUNC_EXPR:
-             case EVAL_EXPR:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    ++*l;
-                    r = get_subtree_external_recurse ( l, c );
-                    if ( r != NULL )
-                         return r;
-               }
-               break;
-          }
-     }
+/*
+ * get_subtree_external:  just like get_subtree, but only selects terminal
+ *     nodes (that is, 1-node subtrees).  start ranges from
+ *     0..(externalnodecount-1).
+ */
 
-     return NULL;
+lnode *get_subtree_external ( lnode *data, int start )
+{
+     return find_subtree ( data, start, 0, 1 );
 }
 
 /*
- * copy_tree:  allocates space for and makes a copy of a tree.
+ * copy_tree:  allocates space for and makes a copy of a tree.  the copy
+ *     remembers its source, so that breeding can tell unchanged copies
+ *     from new trees.
  */
 
 void copy_tree ( tree *to, tree *from )
@@ -740,6 +767,10 @@ void copy_tree ( tree *to, tree *from )
      to->data = (lnode *)MALLOC ( from->size * sizeof ( lnode ) );
      to->size = from->size;
      to->nodes = from->nodes;
+     to->depth = from->depth;
+     to->internal = from->internal;
+     to->external = from->external;
+     to->copyof = from;
      memcpy ( to->data, from->data, from->size * sizeof ( lnode ) );
 }
 
@@ -753,6 +784,10 @@ void free_tree ( tree *t )
      t->data = NULL;
      t->size = -1;
      t->nodes = -1;
+     t->depth = -1;
+     t->internal = -1;
+     t->external = -1;
+     t->copyof = NULL;
 }
 
 /*
@@ -764,47 +799,8 @@ void free_tree ( tree *t )
 int tree_size ( lnode *data )
 {
      lnode *l = data;
-     return tree_size_recurse ( &l );
-}
-
-int tree_size_recurse ( lnode **l )
-{
-     function *f = (**l).f;
-     int i, j = 1;
-
-     ++*l;
-
-     if ( f->arity == 0 )
-     {
-          if ( f->ephem_gen )
-          {
-               ++*l;
-               ++j;
-          }
-     }
-     else
-     {
-          switch ( f->type )
-          {
-             case FUNC_DATA:
-             case EVAL_DATA:
-               for ( i = 0; i < f->arity; ++i )
-                    j += tree_size_recurse ( l );
-               break;
-             case FUNC_EXPR:
-             case EVAL_EXPR:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    ++*l;
-                    ++j;
-                    j += tree_size_recurse ( l );
-               }
-               break;
-          }
-     }
-
-     return j;
-
+     skip_over_subtree ( &l );
+     return l - data;
 }
 
 /*
@@ -830,95 +826,116 @@ int tree_size_recurse ( lnode **l )
 void copy_tree_replace_many ( int space, lnode *parent, lnode **replace,
                             lnode **with, int count, int *repcount )
 {
-     lnode *lp = parent;
+     treewalk w;
+     walkframe *fr;
+     function *f;
+     lnode *r;
+     int i, n;
 
      gensp_reset ( space );
      *repcount = 0;
-     copy_tree_replace_many_recurse ( space, &lp, replace,
-                                     with, count, repcount );
-}
 
-void copy_tree_replace_many_recurse ( int space, lnode **lp, lnode **lr,
-                                    lnode **lw, int count, int *repcount )
-{
-     function *f = (**lp).f;
-     int i;
-     int save;
-     lnode *new;
-
-     /* only do the comparison if the lr is non-NULL. */
-     if ( lr )
+     if ( !fset_has_expr )
      {
-          /* check the current subtree against everything in the lr array. */
-          for ( i = 0; i < count; ++i )
-               if ( *lp == lr[i] )
-               {
-                    /* we have a match! */
-
-                    /* increment the replacement count. */
-                    ++*repcount;
-                    
-                    /* copy the new tree into the destination.  note that the
-                     * lr and lw arguments are passed as NULL to prevent
-                     * further replacement within the replacement tree.
-                     */
-                    new = lw[i];
-                    copy_tree_replace_many_recurse ( space, &new, NULL,
-                                                    NULL, count, repcount );
-                    
-                    /* now skip the lp pointer over the lr subtree. */
-                    skip_over_subtree ( lp );
-
-                    return;
-               }
+          /* with no skip nodes, every subtree is a self-contained block of
+           * lnodes.  copy the parent a block at a time, up to the nearest
+           * replacement point, then the replacement, then carry on past
+           * the replaced subtree.  points inside an already replaced
+           * subtree are passed over, just as in the general case. */
+          lnode *from = parent, *end = scan_subtree ( parent ), *next;
+          int k;
+
+          while ( 1 )
+          {
+               next = end;
+               k = -1;
+               for ( i = 0; replace && i < count; ++i )
+                    if ( replace[i] >= from && replace[i] < next )
+                    {
+                         next = replace[i];
+                         k = i;
+                    }
+
+               memcpy ( gensp_next_block ( space, next-from ), from,
+                        (next-from) * sizeof ( lnode ) );
+               if ( k == -1 )
+                    break;
+
+               ++*repcount;
+               n = scan_subtree ( with[k] ) - with[k];
+               memcpy ( gensp_next_block ( space, n ), with[k],
+                        n * sizeof ( lnode ) );
+               from = scan_subtree ( next );
+          }
+          return;
      }
 
-     /* copy the node from the parent to the destination. */
+     walk_begin ( &w, parent );
+     while ( 1 )
+     {
+          fr = w.stack + w.top;
 
-     gensp_next(space)->f = (**lp).f;
-     ++*lp;
+          /* we can't just copy the skip values, since replacement within
+           * a subtree may change its size.  each one's position is saved
+           * when the child is started and filled in once the walk comes
+           * back up to the parent. */
+          if ( fr->save != -1 )
+          {
+               gensp[space].data[fr->save].s =
+                    gensp[space].used - fr->save - 1;
+               fr->save = -1;
+          }
+          
+          if ( fr->left == 0 )
+          {
+               if ( w.top == 0 )
+                    break;
+               --w.top;
+               continue;
+          }
 
-     if ( f->arity == 0 )
-     {
-          if ( f->ephem_gen )
+          --fr->left;
+          if ( fr->expr )
           {
-               /* copy the ERC pointer. */
+               fr->save = gensp_next_int ( space );
+               ++w.p;
+          }
 
-               gensp_next(space)->d = (**lp).d;
-               ++*lp;
+          /* check the current subtree against everything in the replace
+           * array. */
+          for ( i = 0; replace && i < count; ++i )
+               if ( w.p == replace[i] )
+                    break;
+
+          if ( replace && i < count )
+          {
+               /* we have a match!  skip values are relative, so the
+                * replacement is copied as a block, without looking for
+                * further replacements within it. */
+               ++*repcount;
+               r = with[i];
+               n = tree_size ( r );
+               memcpy ( gensp_next_block ( space, n ), r,
+                        n * sizeof ( lnode ) );
+
+               /* now skip the source pointer over the replaced subtree. */
+               skip_over_subtree ( &w.p );
+               continue;
           }
-     }
-     else
-     {
-          switch ( f->type )
+
+          /* copy the node (and its ERC pointer or value) from the parent
+           * to the destination. */
+          f = LNODE_F(*w.p);
+          *gensp_next(space) = *w.p++;
+          if ( f->arity == 0 )
           {
-             case FUNC_DATA:
-             case EVAL_DATA:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    copy_tree_replace_many_recurse ( space, lp, lr, lw,
-                                                    count, repcount );
-               }
-               break;
-             case FUNC_EXPR:
-             case EVAL_EXPR:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    /* note that we just can't copy the skip value, since
-                     * replacement within the subtree may change it.  we
-                     * have to save where it is needed and fill it in 
-                     * afterwards, just like generate_random_full_tree(). */
-                    
-                    save = gensp_next_int ( space );
-                    ++*lp;
-                    copy_tree_replace_many_recurse ( space, lp, lr, lw,
-                                                    count, repcount );
-                    gensp[space].data[save].s = gensp[space].used-save-1;
-               }
-               break;
+               if ( f->ephem_gen )
+                    *gensp_next(space) = *w.p++;
           }
+          else
+               walk_push ( &w, f );
      }
-     return;
+     walk_end ( &w );
 }
 
 /*
@@ -928,35 +945,20 @@ void copy_tree_replace_many_recurse ( int space, lnode **lp, lnode **lr,
 
 void skip_over_subtree ( lnode **l )
 {
-     function *f = (**l).f;
-     int i;
+     treewalk w;
 
-     ++*l;
-     if ( f->arity == 0 )
-     {
-          if ( f->ephem_gen )
-               ++*l;
-     }
-     else
+     if ( !fset_has_expr )
      {
-          switch ( f->type )
-          {
-             case FUNC_DATA:
-             case EVAL_DATA:
-               for ( i = 0; i < f->arity; ++i )
-                    skip_over_subtree ( l );
-               break;
-             case FUNC_EXPR:
-             case EVAL_EXPR:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    ++*l;
-                    skip_over_subtree ( l );
-               }
-               break;
-          }
+          *l = scan_subtree ( *l );
+          return;
      }
-     return;
+
+     walk_begin ( &w, *l );
+     while ( walk_next ( &w ) != NULL )
+          ;
+     walk_end ( &w );
+
+     *l = w.p;
 }
 
 /*
@@ -966,50 +968,51 @@ void skip_over_subtree ( lnode **l )
 
 void reference_ephem_constants ( lnode *data, int count )
 {
-     lnode *l = data;
-     reference_ephem_constants_recurse ( &l, count );
-}
-
-void reference_ephem_constants_recurse ( lnode **l, int count )
-{
-     function *f = (**l).f;
-     int i;
+     treewalk w;
+     function *f;
+     lnode *l;
+     ephem_const *e;
+     int left = 1;
 
-     ++*l;
+     /* nothing to count if no function set has an ERC terminal, or
+	if the ERCs are stored as values. */
+     if ( !fset_has_ercs || ephem_inline || count == 0 )
+          return;
 
-     if ( f->arity == 0 )
+     if ( !fset_has_expr )
      {
-          if ( f->ephem_gen )
+          l = data;
+          do
           {
-               if ( (**l).d )
+               f = LNODE_F(*l);
+               if ( f->ephem_gen )
                {
-                    (**l).d->refcount += count;
-                    ++*l;
+                    if ( ( e = LNODE_D(l[1]) ) == NULL )
+                         error ( E_FATAL_ERROR, "aarg: this can't happen." );
+                    e->refcount += count;
+                    if ( e->refcount == 0 )
+                         ephem_release ( e );
+                    l += 2;
                }
                else
-                    error ( E_FATAL_ERROR, "aarg: this can't happen." );
+                    ++l;
+               left += f->arity - 1;
           }
+          while ( left );
+          return;
      }
-     else
+
+     walk_begin ( &w, data );
+     while ( ( l = walk_next ( &w ) ) != NULL )
      {
-          switch ( f->type )
-          {
-             case FUNC_DATA:
-             case EVAL_DATA:
-               for ( i = 0; i < f->arity; ++i )
-                    reference_ephem_constants_recurse ( l, count );
-               break;
-             case FUNC_EXPR:
-             case EVAL_EXPR:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    ++*l;
-                    reference_ephem_constants_recurse ( l, count );
-               }
-               break;
-          }
+          if ( !LNODE_F(*l)->ephem_gen )
+               continue;
+
+          if ( ( e = LNODE_D(l[1]) ) == NULL )
+               error ( E_FATAL_ERROR, "aarg: this can't happen." );
+          e->refcount += count;
+          if ( e->refcount == 0 )
+               ephem_release ( e );
      }
-
+     walk_end ( &w );
 }
-
-
@@ -40,6 +40,9 @@ typedef struct
      int type;
      int evaltree;
      int index;
+     int prim;         /* PRIM_* code, for the jit */
+     int input;        /* input vector index, for PRIM_INPUT terminals */
+     int id;           /* index in function_table */
 } function;
 
 typedef struct
@@ -51,26 +54,37 @@ typedef struct
      int size;
 } function_set;
 
-/* holds one ERC.  contains the data, reference count, and pointer for
-   building a linked list. */
+/* holds one ERC.  contains the data, reference count, and the record's
+   index in the ERC pool. */
 
 typedef struct _ephem_const
 {
-     int refcount;
-     struct _ephem_const *next;
      DATATYPE d;
      function *f;
+     int refcount;
+     int index;
 } ephem_const;
 
 /* the basic building block of the tree structure.  can be a function pointer,
-   a skip value, or a pointer to an ERC. */
+   a skip value, a pointer to an ERC, or (with inline_ercs) the value of an
+   ERC itself.  with COMPACT_TREES, functions and ERCs are instead stored
+   as indices in w.  use the LNODE_* macros to get at functions and ERCs. */
 
+#ifdef COMPACT_TREES
+typedef union
+{
+     int s;
+     unsigned int w;
+} lnode;
+#else
 typedef union
 {
      int s;
      function *f;
      ephem_const *d;
+     DATATYPE v;
 } lnode;
+#endif
 
 /* one tree -- consists of an array of lnodes.  the size and node counts are
    cached here for speed improvement. */
@@ -80,6 +94,11 @@ typedef struct _tree
      lnode *data;
      int size;         /* the lnode count */
      int nodes;        /* the actual node count */
+     int depth;
+     int internal;     /* nonterminal count */
+     int external;     /* terminal count */
+     struct _tree *copyof;  /* tree this is an unchanged copy of, if any */
+     int copies;       /* unchanged copies made during breeding */
 } tree;
 
 /* the arguments passed to the function (terminal) code.  can be either a
@@ -102,6 +121,7 @@ typedef struct
      int hits;
      int evald;
      int flags;
+     void *errors;     /* per-case errors, if kept (lexicase.c) */
 } individual;
 
 /* struct for doing a binary search of successive real-valued intervals. */
@@ -121,6 +141,18 @@ typedef struct
      int next;
 } population;
 
+/* an offspring handed to the evaluation threads, with the slot of the
+   subpopulation it will replace. */
+
+typedef struct
+{
+     individual ind;
+     int sub;
+     int slot;
+     int gen;
+     int next;
+} async_job;
+
 typedef int (*select_func_ptr)();
 typedef struct _sel_context * (*select_context_func_ptr)();
 
@@ -130,6 +162,7 @@ typedef struct _sel_context
      select_func_ptr select_method;
      select_context_func_ptr context_method;
      void *data;
+     int changed;      /* the individual just replaced, for SELECT_UPDATE */
 } sel_context;
 
 typedef struct
@@ -164,6 +197,7 @@ typedef struct
      void (*operator_start)();
      void (*operator_end)();
      void (*operator_operate)();
+     void (*operator_update)();
 } breedphase;
 
 typedef struct
@@ -179,6 +213,8 @@ typedef struct
      double total;
      reverse_index *ri;
      int count;
+     double cutoff;        /* fitness_overselect options, kept for */
+     double proportion;    /* rebuilding the table */
 } interval_data;
 
 typedef struct
@@ -186,6 +222,152 @@ typedef struct
      int i;
      ephem_const *e;
 } ephem_index;
+
+/* what the simplifier knows about a subtree. */
+typedef struct
+{
+     int constant;     /* subtree is a constant... */
+     DATATYPE value;   /* ...with this value */
+     int finite;       /* value is always finite */
+     int pure;         /* subtree is made only of primitives */
+} simplify_info;
+
+/* a nonterminal whose children are still being visited by a treewalk:
+   how many children are left, whether each is preceded by a skip node,
+   and (for copy_tree_replace_many()) where the current child's skip
+   node was written. */
+typedef struct
+{
+     int left;
+     int expr;
+     int save;
+} walkframe;
+
+/* state of an iterative preorder scan of a tree. */
+typedef struct
+{
+     lnode *p;          /* next lnode to read */
+     int depth;         /* depth of the node last returned */
+     int top;
+     int size;
+     walkframe *stack;
+     walkframe local[WALK_STACKSIZE];
+} treewalk;
+
+/* everything tree_shape() learns about a tree in one pass. */
+typedef struct
+{
+     int size;          /* lnodes used to store the tree */
+     int nodes;
+     int depth;
+     int internal;
+     int external;
+} treeshape;
+
+/* the fitness cases, as registered by the application.  input[i][c] is
+   input i of case c, and target[c] the value wanted for it.  (the
+   streaming engine points these at one chunk of the dataset at a time.) */
+typedef struct
+{
+     int cases;
+     int inputs;
+     DATATYPE **input;
+     DATATYPE *target;
+} caseset;
+
+/* the header of a binary dataset for the streaming engine.  the rows
+   follow:  each is inputs+1 doubles, the inputs and then the target. */
+typedef struct
+{
+     char magic[8];
+     int32_t inputs;
+     int32_t reserved;
+     int64_t rows;
+} stream_header;
+
+/* the header of a fitness cache file.  slots entries follow it. */
+typedef struct
+{
+     char magic[8];
+     int32_t slots;
+     int32_t entrysize;
+     uint64_t clock;        /* bumped on every use, for eviction */
+} fitcache_header;
+
+/* one cached fitness.  key is the hash of the individual and the
+   problem it was scored on; {0,0} is an empty entry.  seq is odd while
+   the entry is being written, so readers in other processes can tell
+   a torn read. */
+typedef struct
+{
+     uint32_t seq;
+     uint32_t stamp;        /* clock at last use */
+     uint64_t key[2];
+     double r_fitness;
+     double s_fitness;
+     double a_fitness;
+     double extra;          /* whatever the app keeps with a fitness */
+     int32_t hits;
+     int32_t pad;
+} fitcache_entry;
+
+/* the header of a checkpoint's binary population section
+   ("checkpoint.format = binary").  each subpopulation follows as its
+   size and next fields (two int32_ts) and its individuals. */
+typedef struct
+{
+     char magic[8];
+     int32_t functions;     /* function_table_size of the writer */
+     int32_t trees;
+     int32_t subpops;
+     int32_t reserved;
+     int64_t bytes;         /* of the whole section */
+} ckpop_header;
+
+/* an individual in the binary population section.  each of its trees
+   follows as a ckpop_tree and then an int64_t per lnode:  a function's
+   id, -1-n for a skip of n, and after an ERC function the ERC's number
+   in the checkpoint (or its value, with inline ERCs). */
+typedef struct
+{
+     int32_t evald;
+     int32_t flags;
+     int32_t hits;
+     int32_t reserved;
+     double r_fitness;
+     double s_fitness;
+     double a_fitness;
+} ckpop_individual;
+
+typedef struct
+{
+     int32_t size;
+     int32_t nodes;
+     int32_t depth;
+     int32_t internal;
+     int32_t external;
+     int32_t reserved;
+} ckpop_tree;
+
+/* one node of the evaluation DAG. */
+typedef struct
+{
+     function *f;
+     int child[MAXARGS];
+     DATATYPE value;   /* for constants */
+     unsigned int hash;
+} dagnode;
+
+/* one instruction of a tiled-engine program:  a tree in postfix, with
+   ERC values copied in. */
+typedef struct
+{
+     function *f;
+     DATATYPE value;
+} tileop;
+
+/* a compiled individual:  takes the current case's inputs. */
+typedef DATATYPE (*jit_function)( const DATATYPE * );
      
 typedef struct _parameter
 {
@@ -214,6 +396,53 @@ typedef struct _popstats
      saved_ind **best;
 } popstats;
 
+/* one generation record, as written to the binary .rec stream.  every
+   field is fixed-width so the file can be read back without knowing
+   anything about the machine that wrote it except byte order.  subpop
+   0 is the whole population. */
+
+typedef struct
+{
+     int32_t gen, subpop, size;
+     int32_t maxnodes, minnodes, totalnodes, bestnodes, worstnodes;
+     int32_t maxdepth, mindepth, totaldepth, bestdepth, worstdepth;
+     int32_t maxhits, minhits, totalhits, besthits, worsthits;
+     int32_t bestgen, worstgen, bestpop, worstpop;
+     double bestfit, worstfit, totalfit;
+     double eval_time, breed_time;
+} genrecord;
+
+/* one profiling counter.  times are in nanoseconds. */
+
+typedef struct
+{
+     char name[PROF_NAMELENGTH];
+     int trace;
+     uint64_t start;
+     uint64_t last;
+     uint64_t gen_ns, run_ns;
+     long gen_calls, run_calls;
+} profcounter;
+
+/* an evaluation thread's share of the profile, kept apart while it
+   works and added in by the main thread. */
+
+typedef struct
+{
+     uint64_t ns[PROF_MAXCOUNTERS];
+     long calls[PROF_MAXCOUNTERS];
+     long hist[PROF_HISTBUCKETS];
+} profshare;
+
+/* header at the start of the binary .rec stream. */
+
+typedef struct
+{
+     char magic[8];
+     int32_t version;
+     int32_t recsize;
+} genrecord_header;
+
 typedef struct 
 {
      lnode *data;